@@ -11,4 +11,12 @@ workspace "UtopiaApp"
 outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
 
 include "Build-Utopia-External.lua"
-include "UtopiaApp/Build-Utopia-App.lua"
\ No newline at end of file
+include "UtopiaApp/Build-Utopia-App.lua"
+
+group "Benchmarks"
+   include "UtopiaBenchmarks/Build-Utopia-Benchmarks.lua"
+group ""
+
+group "Tests"
+   include "UtopiaTests/Build-Utopia-Tests.lua"
+group ""
\ No newline at end of file
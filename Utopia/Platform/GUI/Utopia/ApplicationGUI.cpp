@@ -2,6 +2,7 @@
 
 #include "Utopia/UI/UI.hpp"
 #include "Utopia/Core/Log.hpp"
+#include "Utopia/Vulkan/OffscreenTarget.hpp"
 
 //
 // Adapted from Dear ImGui Vulkan example
@@ -23,8 +24,13 @@
 #include "ImGui/ImGuiTheme.hpp"
 
 #include "stb_image.h"
+#include "stb_image_write.h"
 
 #include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <latch>
+#include <optional>
 
 // Emedded font
 #include "ImGui/Roboto-Regular.embed"
@@ -40,7 +46,6 @@ extern bool g_ApplicationRunning;
 #pragma comment(lib, "legacy_stdio_definitions")
 #endif
 
-//#define IMGUI_UNLIMITED_FRAME_RATE
 #ifdef _DEBUG
 #define IMGUI_VULKAN_DEBUG_REPORT
 #endif
@@ -52,18 +57,43 @@ static VkDevice                 g_Device = VK_NULL_HANDLE;
 static uint32_t                 g_QueueFamily = (uint32_t)-1;
 static VkQueue                  g_Queue = VK_NULL_HANDLE;
 static VkDebugReportCallbackEXT g_DebugReport = VK_NULL_HANDLE;
-static VkPipelineCache          g_PipelineCache = VK_NULL_HANDLE;
 static VkDescriptorPool         g_DescriptorPool = VK_NULL_HANDLE;
+static bool                     g_TimelineSemaphoreSupported = false;
 
 static ImGui_ImplVulkanH_Window g_MainWindowData;
 static int                      g_MinImageCount = 2;
-static bool                     g_SwapChainRebuild = false;
+static std::atomic<bool>        g_SwapChainRebuild = false; // Set by the render thread when pipelined
+static std::optional<Utopia::PresentMode> g_PendingPresentMode; // Main thread, applied by RebuildSwapChain()
 
 // Per-frame-in-flight
-static std::vector<std::vector<VkCommandBuffer>> s_AllocatedCommandBuffers;
-static std::vector<std::vector<std::function<void()>>> s_ResourceFreeQueue;
-
-static VkCommandBuffer s_ActiveCommandBuffer = nullptr;
+static std::vector<std::vector<Utopia::InplaceFunction<void()>>> s_ResourceFreeQueue;
+static Utopia::MemoryAllocator s_MemoryAllocator;
+static Utopia::DeletionQueue s_DeletionQueue;
+
+// One-off command buffers (Application::GetCommandBuffer) and batched uploads
+static Utopia::UploadContext s_UploadContext;
+static Utopia::StagingRing s_StagingRing;
+
+// Frames in flight limit and frame rate cap
+static Utopia::FramePacer s_FramePacer;
+
+// Replaces g_MainWindowData's swapchain in offscreen mode
+static Utopia::OffscreenTarget s_OffscreenTarget;
+
+// Per thread, layers rendering in parallel record into secondary command buffers
+static thread_local VkCommandBuffer s_ActiveCommandBuffer = nullptr;
+static Utopia::SecondaryCommandRecorder s_SecondaryRecorder;
+static Utopia::PipelineCache s_PipelineCache;
+static Utopia::GpuProfiler s_GpuProfiler;
+// CPU time FrameRender() spent recording the last frame, in ms. Pipelined, written by the
+// render thread and read by the main thread while it is idle.
+static float s_RenderCpuTime = 0.0f;
+
+// ApplicationSpecification::PipelinedRendering: FrameRender()/FramePresent() run on the render
+// thread, from a copy of the ImGui draw data, while the main thread builds the next frame
+static bool s_PipelinedRendering = false;
+// Locked around every submission and present when the render thread is running
+static std::mutex s_QueueMutex;
 
 // Unlike g_MainWindowData.FrameIndex, this is not the the swapchain image index
 // and is always guaranteed to increase (eg. 0, 1, 2, 0, 1, 2)
@@ -91,14 +121,22 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL debug_report(VkDebugReportFlagsEXT flags,
 }
 #endif // IMGUI_VULKAN_DEBUG_REPORT
 
-static void SetupVulkan(const char** extensions, uint32_t extensions_count)
+// Without presentation (offscreen mode) neither surface nor swapchain extensions are required
+static void SetupVulkan(const char** extensions, uint32_t extensions_count, bool presentation)
 {
 	VkResult err;
 
 	// Create Vulkan Instance
 	{
+		// Vulkan 1.2 for timeline semaphores; the device-level feature is still checked below
+		VkApplicationInfo app_info = {};
+		app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+		app_info.pEngineName = "Utopia";
+		app_info.apiVersion = VK_API_VERSION_1_2;
+
 		VkInstanceCreateInfo create_info = {};
 		create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+		create_info.pApplicationInfo = &app_info;
 		create_info.enabledExtensionCount = extensions_count;
 		create_info.ppEnabledExtensionNames = extensions;
 #ifdef IMGUI_VULKAN_DEBUG_REPORT
@@ -187,7 +225,32 @@ static void SetupVulkan(const char** extensions, uint32_t extensions_count)
 
 	// Create Logical Device (with 1 queue)
 	{
-		int device_extension_count = 1;
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(g_PhysicalDevice, &properties);
+		const bool vulkan12 = properties.apiVersion >= VK_API_VERSION_1_2;
+
+		VkPhysicalDeviceVulkan12Features supported_features12 = {};
+		supported_features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		if (vulkan12)
+		{
+			VkPhysicalDeviceFeatures2 features2 = {};
+			features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			features2.pNext = &supported_features12;
+			vkGetPhysicalDeviceFeatures2(g_PhysicalDevice, &features2);
+		}
+		g_TimelineSemaphoreSupported = supported_features12.timelineSemaphore == VK_TRUE;
+
+		VkPhysicalDeviceVulkan12Features features12 = {};
+		features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		features12.timelineSemaphore = g_TimelineSemaphoreSupported ? VK_TRUE : VK_FALSE;
+
+		// BC1/BC3/BC7 images from .dds/.ktx2 files, see Image::IsFormatSupported()
+		VkPhysicalDeviceFeatures supported_features = {};
+		vkGetPhysicalDeviceFeatures(g_PhysicalDevice, &supported_features);
+		VkPhysicalDeviceFeatures features = {};
+		features.textureCompressionBC = supported_features.textureCompressionBC;
+
+		int device_extension_count = presentation ? 1 : 0;
 		const char* device_extensions[] = { "VK_KHR_swapchain" };
 		const float queue_priority[] = { 1.0f };
 		VkDeviceQueueCreateInfo queue_info[1] = {};
@@ -197,6 +260,8 @@ static void SetupVulkan(const char** extensions, uint32_t extensions_count)
 		queue_info[0].pQueuePriorities = queue_priority;
 		VkDeviceCreateInfo create_info = {};
 		create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		create_info.pNext = vulkan12 ? &features12 : nullptr;
+		create_info.pEnabledFeatures = &features;
 		create_info.queueCreateInfoCount = sizeof(queue_info) / sizeof(queue_info[0]);
 		create_info.pQueueCreateInfos = queue_info;
 		create_info.enabledExtensionCount = device_extension_count;
@@ -233,9 +298,23 @@ static void SetupVulkan(const char** extensions, uint32_t extensions_count)
 	}
 }
 
+// Picks the closest supported present mode and the swapchain image count that goes with it
+static void SelectPresentMode(ImGui_ImplVulkanH_Window* wd, Utopia::PresentMode mode)
+{
+	// In fallback order, FIFO support is guaranteed
+	const VkPresentModeKHR present_modes[] = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR };
+	const int first = mode == Utopia::PresentMode::Immediate ? 0 : mode == Utopia::PresentMode::Mailbox ? 1 : 2;
+	wd->PresentMode = ImGui_ImplVulkanH_SelectPresentMode(g_PhysicalDevice, wd->Surface, &present_modes[first], IM_ARRAYSIZE(present_modes) - first);
+	if (wd->PresentMode != present_modes[first])
+		UT_CORE_WARN_TAG("Application", "Requested present mode is not supported, using VkPresentModeKHR {}", (int)wd->PresentMode);
+
+	// Mailbox needs a spare image to replace, otherwise it throttles like FIFO
+	g_MinImageCount = wd->PresentMode == VK_PRESENT_MODE_MAILBOX_KHR ? 3 : 2;
+}
+
 // All the ImGui_ImplVulkanH_XXX structures/functions are optional helpers used by the demo.
 // Your real engine/app may not use them.
-static void SetupVulkanWindow(ImGui_ImplVulkanH_Window* wd, VkSurfaceKHR surface, int width, int height)
+static void SetupVulkanWindow(ImGui_ImplVulkanH_Window* wd, VkSurfaceKHR surface, int width, int height, Utopia::PresentMode presentMode)
 {
 	wd->Surface = surface;
 
@@ -254,13 +333,7 @@ static void SetupVulkanWindow(ImGui_ImplVulkanH_Window* wd, VkSurfaceKHR surface
 	wd->SurfaceFormat = ImGui_ImplVulkanH_SelectSurfaceFormat(g_PhysicalDevice, wd->Surface, requestSurfaceImageFormat, (size_t)IM_ARRAYSIZE(requestSurfaceImageFormat), requestSurfaceColorSpace);
 
 	// Select Present Mode
-#ifdef IMGUI_UNLIMITED_FRAME_RATE
-	VkPresentModeKHR present_modes[] = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_FIFO_KHR };
-#else
-	VkPresentModeKHR present_modes[] = { VK_PRESENT_MODE_FIFO_KHR };
-#endif
-	wd->PresentMode = ImGui_ImplVulkanH_SelectPresentMode(g_PhysicalDevice, wd->Surface, &present_modes[0], IM_ARRAYSIZE(present_modes));
-	//printf("[vulkan] Selected PresentMode = %d\n", wd->PresentMode);
+	SelectPresentMode(wd, presentMode);
 
 	// Create SwapChain, RenderPass, Framebuffer, etc.
 	IM_ASSERT(g_MinImageCount >= 2);
@@ -286,22 +359,254 @@ static void CleanupVulkanWindow()
 	ImGui_ImplVulkanH_DestroyWindow(g_Instance, g_Device, &g_MainWindowData, g_Allocator);
 }
 
-static void FrameRender(Utopia::Application* application, ImGui_ImplVulkanH_Window* wd, ImDrawData* draw_data)
+// Frames whose resources the GPU may still be using. Serially, a frame's resources are released
+// after waiting for its swapchain image fence. Pipelined, the main thread releases them without
+// that wait, one frame ahead of the render thread; only the frame pacer bounds the frames in
+// flight then.
+static uint32_t GetFrameResourceCount()
+{
+	if (s_PipelinedRendering)
+		return glm::max(g_MainWindowData.ImageCount, Utopia::FramePacer::MaxFramesInFlight) + 1;
+
+	return g_MainWindowData.ImageCount;
+}
+
+// Releases what the GPU is done with; once per frame, before the frame's commands are recorded
+static void BeginFrameResources()
+{
+	s_CurrentFrameIndex = (s_CurrentFrameIndex + 1) % (uint32_t)s_ResourceFreeQueue.size();
+
+	// Free resources in queue
+	for (auto& func : s_ResourceFreeQueue[s_CurrentFrameIndex])
+		func();
+	s_ResourceFreeQueue[s_CurrentFrameIndex].clear();
+
+	s_DeletionQueue.BeginFrame();
+	s_StagingRing.BeginFrame();
+
+	// Return finished one-off command buffers to the pool
+	s_UploadContext.Recycle();
+}
+
+using LayerStack = std::vector<std::shared_ptr<Utopia::Layer>>;
+
+// Deep copy of ImDrawData for the render thread, reusing its buffers from frame to frame
+struct DrawDataSnapshot
+{
+	ImDrawData DrawData;
+	ImVector<ImDrawList*> Lists;
+	// The layer stack as of the hand-off; the main thread may push layers while this is drawn
+	LayerStack Layers;
+
+	template<typename T>
+	static void CopyVector(ImVector<T>& destination, const ImVector<T>& source)
+	{
+		// Unlike ImVector::operator=, keeps the capacity
+		destination.resize(source.Size);
+		if (source.Size)
+			memcpy(destination.Data, source.Data, (size_t)source.size_in_bytes());
+	}
+
+	void Copy(const ImDrawData* source)
+	{
+		for (int i = source->CmdListsCount; i < Lists.Size; i++)
+			IM_DELETE(Lists[i]);
+
+		const int previousSize = Lists.Size;
+		Lists.resize(source->CmdListsCount);
+		for (int i = previousSize; i < Lists.Size; i++)
+			Lists[i] = IM_NEW(ImDrawList)(nullptr);
+
+		for (int i = 0; i < Lists.Size; i++)
+		{
+			const ImDrawList* list = source->CmdLists[i];
+			CopyVector(Lists[i]->CmdBuffer, list->CmdBuffer);
+			CopyVector(Lists[i]->IdxBuffer, list->IdxBuffer);
+			CopyVector(Lists[i]->VtxBuffer, list->VtxBuffer);
+			Lists[i]->Flags = list->Flags;
+		}
+
+		DrawData.Valid = source->Valid;
+		DrawData.CmdListsCount = source->CmdListsCount;
+		DrawData.TotalIdxCount = source->TotalIdxCount;
+		DrawData.TotalVtxCount = source->TotalVtxCount;
+		CopyVector(DrawData.CmdLists, Lists);
+		DrawData.DisplayPos = source->DisplayPos;
+		DrawData.DisplaySize = source->DisplaySize;
+		DrawData.FramebufferScale = source->FramebufferScale;
+		DrawData.OwnerViewport = source->OwnerViewport;
+	}
+
+	void Clear()
+	{
+		for (ImDrawList* list : Lists)
+			IM_DELETE(list);
+		Lists.clear();
+		DrawData.Clear();
+		Layers.clear();
+	}
+};
+
+// Built by the main thread into one while the render thread draws the other
+static DrawDataSnapshot s_DrawDataSnapshots[2];
+
+// OnRender of the layer at index in the layer stack, timed on the GPU
+static void RenderLayer(Utopia::Layer* layer, uint32_t index, VkCommandBuffer command_buffer)
+{
+	s_GpuProfiler.BeginScope(command_buffer, Utopia::GpuProfiler::FirstLayerScope + index);
+	layer->OnRender();
+	s_GpuProfiler.EndScope(command_buffer, Utopia::GpuProfiler::FirstLayerScope + index);
+}
+
+static void RenderImGui(ImDrawData* draw_data, VkCommandBuffer command_buffer)
+{
+	// Record dear imgui primitives into command buffer
+	s_GpuProfiler.BeginScope(command_buffer, Utopia::GpuProfiler::ImGuiScope);
+	ImGui_ImplVulkan_RenderDrawData(draw_data, command_buffer);
+	s_GpuProfiler.EndScope(command_buffer, Utopia::GpuProfiler::ImGuiScope);
+}
+
+// Every layer's OnRender and the ImGui draw data, inline on command_buffer
+static void RecordLayers(const LayerStack& layers, ImDrawData* draw_data, VkCommandBuffer command_buffer)
+{
+	for (size_t i = 0; i < layers.size(); i++)
+		RenderLayer(layers[i].get(), (uint32_t)i, command_buffer);
+
+	RenderImGui(draw_data, command_buffer);
+}
+
+static bool HasParallelRenderLayers(const LayerStack& layers)
+{
+	return std::any_of(layers.begin(), layers.end(), [](const std::shared_ptr<Utopia::Layer>& layer) { return layer->WantsParallelRender(); });
+}
+
+// Parallel layers of one frame still to be recorded. Claimed one at a time by pool workers and by
+// the recording thread once its own work is done, so a frame never waits for recording jobs that
+// are queued behind unrelated pool work. Shared with the workers, which may only get to it after
+// the frame has been recorded without them.
+struct ParallelLayerRecording
+{
+	struct Job
+	{
+		Utopia::Layer* Layer;
+		uint32_t Index;
+		VkCommandBuffer* Slot;
+	};
+
+	explicit ParallelLayerRecording(std::vector<Job>&& jobs)
+		: Jobs(std::move(jobs)), Recorded((std::ptrdiff_t)Jobs.size())
+	{
+	}
+
+	std::vector<Job> Jobs;
+	std::atomic<size_t> NextJob = 0;
+	std::latch Recorded;
+};
+
+// Returns false once every job has been claimed
+static bool RecordNextParallelLayer(ParallelLayerRecording& recording)
+{
+	const size_t next = recording.NextJob.fetch_add(1, std::memory_order_relaxed);
+	if (next >= recording.Jobs.size())
+		return false;
+
+	const ParallelLayerRecording::Job& job = recording.Jobs[next];
+	*job.Slot = s_SecondaryRecorder.Record([&job](VkCommandBuffer secondary)
+	{
+		s_ActiveCommandBuffer = secondary;
+		RenderLayer(job.Layer, job.Index, secondary);
+		s_ActiveCommandBuffer = nullptr;
+	});
+	recording.Recorded.count_down();
+	return true;
+}
+
+// Records every layer's OnRender and the ImGui draw data into secondary command buffers and
+// executes them in layer order. The render pass must have been begun with
+// VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, as it may not mix in inline commands.
+// Layers that want it record on the thread pool; the others are recorded on this thread in the
+// meantime, consecutive ones into a shared command buffer. Parallel layers no worker has picked
+// up by then are recorded here as well.
+static void RecordLayersInParallel(const LayerStack& layers, ImDrawData* draw_data, VkCommandBuffer command_buffer)
+{
+	Utopia::ThreadPool& threadPool = Utopia::Application::Get().GetThreadPool();
+
+	// One slot per layer plus ImGui; slots of layers sharing a command buffer stay empty
+	std::vector<VkCommandBuffer> secondaries(layers.size() + 1, VK_NULL_HANDLE);
+
+	std::vector<ParallelLayerRecording::Job> jobs;
+	for (size_t i = 0; i < layers.size(); i++)
+	{
+		if (layers[i]->WantsParallelRender())
+			jobs.push_back({ layers[i].get(), (uint32_t)i, &secondaries[i] });
+	}
+
+	// This thread takes part too, so one worker less covers the same parallelism
+	auto recording = std::make_shared<ParallelLayerRecording>(std::move(jobs));
+	const size_t workerCount = std::min<size_t>(recording->Jobs.size(), threadPool.GetThreadCount());
+	for (size_t i = 0; i < workerCount; i++)
+	{
+		threadPool.Submit([recording]()
+		{
+			while (RecordNextParallelLayer(*recording))
+				;
+		});
+	}
+
+	for (size_t i = 0; i < layers.size(); i++)
+	{
+		if (layers[i]->WantsParallelRender())
+			continue;
+
+		size_t end = i + 1;
+		while (end < layers.size() && !layers[end]->WantsParallelRender())
+			end++;
+
+		secondaries[i] = s_SecondaryRecorder.Record([&layers, i, end](VkCommandBuffer secondary)
+		{
+			s_ActiveCommandBuffer = secondary;
+			for (size_t j = i; j < end; j++)
+				RenderLayer(layers[j].get(), (uint32_t)j, secondary);
+			s_ActiveCommandBuffer = nullptr;
+		});
+		i = end - 1;
+	}
+
+	secondaries.back() = s_SecondaryRecorder.Record([draw_data](VkCommandBuffer secondary)
+	{
+		RenderImGui(draw_data, secondary);
+	});
+
+	// Only waits for layers a worker is recording right now, never for the pool to get to a job
+	while (RecordNextParallelLayer(*recording))
+		;
+	recording->Recorded.wait();
+
+	std::erase(secondaries, VK_NULL_HANDLE);
+	vkCmdExecuteCommands(command_buffer, (uint32_t)secondaries.size(), secondaries.data());
+}
+
+// Returns false if no image was available, nothing is submitted then and the frame must not be presented
+static bool FrameRender(ImGui_ImplVulkanH_Window* wd, ImDrawData* draw_data, const LayerStack& layers)
 {
 	VkResult err;
 
+	// Bounded, so a compositor holding on to every image (e.g. for a hidden window) cannot stall
+	// event handling; the frame is dropped instead
+	constexpr uint64_t acquire_timeout = 100'000'000; // 100 ms
+
 	VkSemaphore image_acquired_semaphore = wd->FrameSemaphores[wd->SemaphoreIndex].ImageAcquiredSemaphore;
 	VkSemaphore render_complete_semaphore = wd->FrameSemaphores[wd->SemaphoreIndex].RenderCompleteSemaphore;
-	err = vkAcquireNextImageKHR(g_Device, wd->Swapchain, UINT64_MAX, image_acquired_semaphore, VK_NULL_HANDLE, &wd->FrameIndex);
+	err = vkAcquireNextImageKHR(g_Device, wd->Swapchain, acquire_timeout, image_acquired_semaphore, VK_NULL_HANDLE, &wd->FrameIndex);
 	if (err == VK_ERROR_OUT_OF_DATE_KHR || err == VK_SUBOPTIMAL_KHR)
 	{
 		g_SwapChainRebuild = true;
-		return;
+		return false;
 	}
+	if (err == VK_TIMEOUT || err == VK_NOT_READY)
+		return false;
 	check_vk_result(err);
 
-	s_CurrentFrameIndex = (s_CurrentFrameIndex + 1) % g_MainWindowData.ImageCount;
-
 	ImGui_ImplVulkanH_Frame* fd = &wd->Frames[wd->FrameIndex];
 	{
 		err = vkWaitForFences(g_Device, 1, &fd->Fence, VK_TRUE, UINT64_MAX);    // wait indefinitely instead of periodically checking
@@ -311,22 +616,12 @@ static void FrameRender(Utopia::Application* application, ImGui_ImplVulkanH_Wind
 		check_vk_result(err);
 	}
 
-	{
-		// Free resources in queue
-		for (auto& func : s_ResourceFreeQueue[s_CurrentFrameIndex])
-			func();
-		s_ResourceFreeQueue[s_CurrentFrameIndex].clear();
-	}
-	{
-		// Free command buffers allocated by Application::GetCommandBuffer
-		// These use g_MainWindowData.FrameIndex and not s_CurrentFrameIndex because they're tied to the swapchain image index
-		auto& allocatedCommandBuffers = s_AllocatedCommandBuffers[wd->FrameIndex];
-		if (allocatedCommandBuffers.size() > 0)
-		{
-			vkFreeCommandBuffers(g_Device, fd->CommandPool, (uint32_t)allocatedCommandBuffers.size(), allocatedCommandBuffers.data());
-			allocatedCommandBuffers.clear();
-		}
+	// Pipelined, the main thread does this while the render thread is idle
+	if (!s_PipelinedRendering)
+		BeginFrameResources();
 
+	Utopia::Timer recordTimer;
+	{
 		err = vkResetCommandPool(g_Device, fd->CommandPool, 0);
 		check_vk_result(err);
 		VkCommandBufferBeginInfo info = {};
@@ -336,6 +631,10 @@ static void FrameRender(Utopia::Application* application, ImGui_ImplVulkanH_Wind
 		s_ActiveCommandBuffer = fd->CommandBuffer;
 		check_vk_result(err);
 	}
+	// This image's fence was waited on, so its previous timestamps are ready to be read
+	s_GpuProfiler.BeginFrame(wd->FrameIndex, fd->CommandBuffer, (uint32_t)layers.size());
+
+	const bool parallel = HasParallelRenderLayers(layers);
 	{
 		VkRenderPassBeginInfo info = {};
 		info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
@@ -345,17 +644,22 @@ static void FrameRender(Utopia::Application* application, ImGui_ImplVulkanH_Wind
 		info.renderArea.extent.height = wd->Height;
 		info.clearValueCount = 1;
 		info.pClearValues = &wd->ClearValue;
-		vkCmdBeginRenderPass(fd->CommandBuffer, &info, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(fd->CommandBuffer, &info, parallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
 	}
 
-	for (auto& layer : application->GetLayerStack())
-		layer->OnRender();
-
-	// Record dear imgui primitives into command buffer
-	ImGui_ImplVulkan_RenderDrawData(draw_data, fd->CommandBuffer);
+	if (parallel)
+	{
+		s_SecondaryRecorder.BeginFrame(wd->FrameIndex, wd->RenderPass, fd->Framebuffer);
+		RecordLayersInParallel(layers, draw_data, fd->CommandBuffer);
+	}
+	else
+	{
+		RecordLayers(layers, draw_data, fd->CommandBuffer);
+	}
 
 	// Submit command buffer
 	vkCmdEndRenderPass(fd->CommandBuffer);
+	s_GpuProfiler.EndFrame(fd->CommandBuffer);
 	{
 		VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 		VkSubmitInfo info = {};
@@ -368,12 +672,22 @@ static void FrameRender(Utopia::Application* application, ImGui_ImplVulkanH_Wind
 		info.signalSemaphoreCount = 1;
 		info.pSignalSemaphores = &render_complete_semaphore;
 
+		// Uploads recorded by layers in OnRender(). Pipelined, the upload context belongs to the
+		// main thread and OnRender() may not use it.
+		if (!s_PipelinedRendering)
+			s_UploadContext.SubmitBatch();
+
 		err = vkEndCommandBuffer(fd->CommandBuffer);
 		s_ActiveCommandBuffer = nullptr;
 		check_vk_result(err);
+		s_RenderCpuTime = recordTimer.ElapsedMillis();
+
+		std::lock_guard<std::mutex> lock(s_QueueMutex);
 		err = vkQueueSubmit(g_Queue, 1, &info, fd->Fence);
 		check_vk_result(err);
 	}
+
+	return true;
 }
 
 static void FramePresent(ImGui_ImplVulkanH_Window* wd)
@@ -388,7 +702,11 @@ static void FramePresent(ImGui_ImplVulkanH_Window* wd)
 	info.swapchainCount = 1;
 	info.pSwapchains = &wd->Swapchain;
 	info.pImageIndices = &wd->FrameIndex;
-	VkResult err = vkQueuePresentKHR(g_Queue, &info);
+	VkResult err;
+	{
+		std::lock_guard<std::mutex> lock(s_QueueMutex);
+		err = vkQueuePresentKHR(g_Queue, &info);
+	}
 	if (err == VK_ERROR_OUT_OF_DATE_KHR || err == VK_SUBOPTIMAL_KHR)
 	{
 		g_SwapChainRebuild = true;
@@ -398,6 +716,83 @@ static void FramePresent(ImGui_ImplVulkanH_Window* wd)
 	wd->SemaphoreIndex = (wd->SemaphoreIndex + 1) % wd->ImageCount; // Now we can use the next set of semaphores
 }
 
+static void RebuildSwapChain(GLFWwindow* window)
+{
+	// Pipelined, the render thread is idle here and done with the window data
+	if (g_PendingPresentMode)
+	{
+		SelectPresentMode(&g_MainWindowData, *g_PendingPresentMode);
+		g_PendingPresentMode.reset();
+		g_SwapChainRebuild = true;
+	}
+
+	if (!g_SwapChainRebuild)
+		return;
+
+	int width, height;
+	glfwGetFramebufferSize(window, &width, &height);
+	if (width > 0 && height > 0)
+	{
+		ImGui_ImplVulkan_SetMinImageCount(g_MinImageCount);
+		ImGui_ImplVulkanH_CreateOrResizeWindow(g_Instance, g_PhysicalDevice, g_Device, &g_MainWindowData, g_QueueFamily, g_Allocator, width, height, g_MinImageCount);
+		g_MainWindowData.FrameIndex = 0;
+
+		// The image count may have changed. Recreating the swapchain waited for the device
+		// to go idle, so every pending free can run now.
+		for (auto& queue : s_ResourceFreeQueue)
+		{
+			for (auto& func : queue)
+				func();
+			queue.clear();
+		}
+		s_ResourceFreeQueue.resize(GetFrameResourceCount());
+		s_CurrentFrameIndex = 0;
+
+		s_DeletionQueue.SetFramesInFlight(GetFrameResourceCount());
+		s_StagingRing.SetFramesInFlight(GetFrameResourceCount());
+		s_SecondaryRecorder.SetFrameCount(g_MainWindowData.ImageCount);
+		s_GpuProfiler.SetFrameCount(g_MainWindowData.ImageCount);
+
+		g_SwapChainRebuild = false;
+	}
+}
+
+static void OffscreenFrameRender(ImGui_ImplVulkanH_Window* wd, ImDrawData* draw_data, const LayerStack& layers)
+{
+	// One frame in flight; waiting on it takes the place of the swapchain frame fence
+	s_OffscreenTarget.Wait();
+
+	BeginFrameResources();
+
+	Utopia::Timer recordTimer;
+	VkCommandBuffer command_buffer = s_OffscreenTarget.Begin();
+	s_ActiveCommandBuffer = command_buffer;
+	s_GpuProfiler.BeginFrame(0, command_buffer, (uint32_t)layers.size());
+
+	const bool parallel = HasParallelRenderLayers(layers);
+	s_OffscreenTarget.BeginRenderPass(wd->ClearValue, parallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+
+	if (parallel)
+	{
+		s_SecondaryRecorder.BeginFrame(0, s_OffscreenTarget.GetRenderPass(), s_OffscreenTarget.GetFramebuffer());
+		RecordLayersInParallel(layers, draw_data, command_buffer);
+	}
+	else
+	{
+		RecordLayers(layers, draw_data, command_buffer);
+	}
+
+	s_OffscreenTarget.EndRenderPass();
+	s_GpuProfiler.EndFrame(command_buffer);
+
+	// Uploads recorded by layers in OnRender()
+	s_UploadContext.SubmitBatch();
+
+	s_OffscreenTarget.Submit(g_Queue);
+	s_ActiveCommandBuffer = nullptr;
+	s_RenderCpuTime = recordTimer.ElapsedMillis();
+}
+
 static void glfw_error_callback(int error, const char* description)
 {
 	fprintf(stderr, "Glfw Error %d: %s\n", error, description);
@@ -409,7 +804,7 @@ namespace Utopia {
 #include "Utopia/Embed/WindowImages.embed"
 
 	Application::Application(const ApplicationSpecification& specification)
-		: m_Specification(specification)
+		: m_Specification(specification), m_MainThreadID(std::this_thread::get_id())
 	{
 		s_Instance = this;
 
@@ -433,84 +828,59 @@ namespace Utopia {
 		// Intialize logging
 		Log::Init();
 
-		// Setup GLFW window
-		glfwSetErrorCallback(glfw_error_callback);
-		if (!glfwInit())
-		{
-			std::cerr << "Could not initalize GLFW!\n";
-			return;
-		}
-
-		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-
-		if (m_Specification.CustomTitlebar)
-		{
-			glfwWindowHint(GLFW_TITLEBAR, false);
-		}
-
-		GLFWmonitor* primaryMonitor = glfwGetPrimaryMonitor();
-		const GLFWvidmode* videoMode = glfwGetVideoMode(primaryMonitor);
-
-		int monitorX, monitorY;
-		glfwGetMonitorPos(primaryMonitor, &monitorX, &monitorY);
+		m_ThreadPool = std::make_unique<ThreadPool>();
 
-		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		if (!m_Specification.ImageDecodeCacheDirectory.empty())
+			m_ImageDecodeCache.Init(m_Specification.ImageDecodeCacheDirectory, m_Specification.ImageDecodeCacheCompression, m_Specification.ImageDecodeCacheMaxSize);
 
-		m_WindowHandle = glfwCreateWindow(m_Specification.Width, m_Specification.Height, m_Specification.Name.c_str(), NULL, NULL);
-
-		if (m_Specification.CenterWindow)
+		uint32_t extensions_count = 0;
+		const char** extensions = nullptr;
+		if (!m_Specification.Offscreen)
 		{
-			glfwSetWindowPos(m_WindowHandle,
-				monitorX + (videoMode->width - m_Specification.Width) / 2,
-				monitorY + (videoMode->height - m_Specification.Height) / 2);
+			if (!InitWindow())
+				return;
 
-			glfwSetWindowAttrib(m_WindowHandle, GLFW_RESIZABLE, m_Specification.WindowResizeable ? GLFW_TRUE : GLFW_FALSE);
+			extensions = glfwGetRequiredInstanceExtensions(&extensions_count);
 		}
 
-		glfwShowWindow(m_WindowHandle);
+		s_PipelinedRendering = m_Specification.PipelinedRendering && !m_Specification.Offscreen;
 
-		// Setup Vulkan
-		if (!glfwVulkanSupported())
+		SetupVulkan(extensions, extensions_count, !m_Specification.Offscreen);
+		// Pipelined, the render thread submits and presents concurrently with the main thread
+		s_UploadContext.Init(g_Device, g_Queue, g_QueueFamily, g_TimelineSemaphoreSupported, s_PipelinedRendering ? &s_QueueMutex : nullptr);
+		s_UploadContext.SetBatchSubmitCallback(&Image::RecordPendingUploads);
+		s_PipelineCache.Init(g_PhysicalDevice, g_Device, m_Specification.PipelineCachePath);
+
+		ImGui_ImplVulkanH_Window* wd = &g_MainWindowData;
+		if (m_Specification.Offscreen)
 		{
-			std::cerr << "GLFW: Vulkan not supported!\n";
-			return;
+			// Only the parts of the window data layers may rely on, e.g. the render pass for pipelines
+			s_OffscreenTarget.Init(g_Device, g_QueueFamily, m_Specification.Width, m_Specification.Height);
+			wd->RenderPass = s_OffscreenTarget.GetRenderPass();
+			wd->Width = (int)m_Specification.Width;
+			wd->Height = (int)m_Specification.Height;
+			wd->ImageCount = 1;
 		}
-
-		// Set icon
-		GLFWimage icon;
-		int channels;
-		if (!m_Specification.IconPath.empty())
+		else
 		{
-			std::string iconPathStr = m_Specification.IconPath.string();
-			icon.pixels = stbi_load(iconPathStr.c_str(), &icon.width, &icon.height, &channels, 4);
-			glfwSetWindowIcon(m_WindowHandle, 1, &icon);
-			stbi_image_free(icon.pixels);
+			// Create Window Surface
+			VkSurfaceKHR surface;
+			VkResult err = glfwCreateWindowSurface(g_Instance, m_WindowHandle, g_Allocator, &surface);
+			check_vk_result(err);
+
+			// Create Framebuffers
+			int w, h;
+			glfwGetFramebufferSize(m_WindowHandle, &w, &h);
+			SetupVulkanWindow(wd, surface, w, h, m_Specification.SwapchainPresentMode);
 		}
 
-		glfwSetWindowUserPointer(m_WindowHandle, this);
-		glfwSetTitlebarHitTestCallback(m_WindowHandle, [](GLFWwindow* window, int x, int y, int* hit)
-			{
-				Application* app = (Application*)glfwGetWindowUserPointer(window);
-				*hit = app->IsTitleBarHovered();
-			});
-
-		uint32_t extensions_count = 0;
-		const char** extensions = glfwGetRequiredInstanceExtensions(&extensions_count);
-		SetupVulkan(extensions, extensions_count);
-
-		// Create Window Surface
-		VkSurfaceKHR surface;
-		VkResult err = glfwCreateWindowSurface(g_Instance, m_WindowHandle, g_Allocator, &surface);
-		check_vk_result(err);
-
-		// Create Framebuffers
-		int w, h;
-		glfwGetFramebufferSize(m_WindowHandle, &w, &h);
-		ImGui_ImplVulkanH_Window* wd = &g_MainWindowData;
-		SetupVulkanWindow(wd, surface, w, h);
-
-		s_AllocatedCommandBuffers.resize(wd->ImageCount);
-		s_ResourceFreeQueue.resize(wd->ImageCount);
+		s_ResourceFreeQueue.resize(GetFrameResourceCount());
+		s_MemoryAllocator.Init(g_PhysicalDevice, g_Device);
+		s_DeletionQueue.Init(g_Device, &s_MemoryAllocator, GetFrameResourceCount());
+		s_StagingRing.Init(g_PhysicalDevice, g_Device, GetFrameResourceCount());
+		s_FramePacer.Init(g_Device, m_Specification.FramesInFlight, m_Specification.TargetFrameRate);
+		s_SecondaryRecorder.Init(g_Device, g_QueueFamily, wd->ImageCount);
+		s_GpuProfiler.Init(g_PhysicalDevice, g_Device, g_QueueFamily, wd->ImageCount);
 
 		// Setup Dear ImGui context
 		IMGUI_CHECKVERSION();
@@ -519,7 +889,8 @@ namespace Utopia {
 		io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;       // Enable Keyboard Controls
 		//io.ConfigFlags |= ImGuiConfigFlags_NavEnableGamepad;      // Enable Gamepad Controls
 		io.ConfigFlags |= ImGuiConfigFlags_DockingEnable;           // Enable Docking
-		io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;         // Enable Multi-Viewport / Platform Windows
+		if (!m_Specification.Offscreen)
+			io.ConfigFlags |= ImGuiConfigFlags_ViewportsEnable;     // Enable Multi-Viewport / Platform Windows (needs a platform backend)
 		//io.ConfigViewportsNoAutoMerge = true;
 		//io.ConfigViewportsNoTaskBarIcon = true;
 
@@ -544,7 +915,9 @@ namespace Utopia {
 		}
 
 		// Setup Platform/Renderer backends
-		ImGui_ImplGlfw_InitForVulkan(m_WindowHandle, true);
+		// Offscreen there is no platform backend, Run() feeds display size and time step instead
+		if (!m_Specification.Offscreen)
+			ImGui_ImplGlfw_InitForVulkan(m_WindowHandle, true);
 
 		ImGui_ImplVulkan_InitInfo init_info = {};
 		init_info.Instance = g_Instance;
@@ -552,7 +925,7 @@ namespace Utopia {
 		init_info.Device = g_Device;
 		init_info.QueueFamily = g_QueueFamily;
 		init_info.Queue = g_Queue;
-		init_info.PipelineCache = g_PipelineCache;
+		init_info.PipelineCache = s_PipelineCache.GetHandle();
 
 		// Descriptor pool setup
 #ifdef USE_DYNAMIC_RENDERING
@@ -565,7 +938,8 @@ namespace Utopia {
 
 		init_info.Subpass = 0;
 		init_info.MinImageCount = g_MinImageCount;
-		init_info.ImageCount = wd->ImageCount;
+		// The backend wants at least MinImageCount; offscreen has a single frame in flight
+		init_info.ImageCount = glm::max<uint32_t>(wd->ImageCount, g_MinImageCount);
 		init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
 		init_info.Allocator = g_Allocator;
 		init_info.CheckVkResultFn = check_vk_result;
@@ -601,6 +975,10 @@ namespace Utopia {
 		}
 
 		// Load images
+		{
+			const uint32_t white = 0xffffffff;
+			m_PlaceholderImage = std::make_shared<Utopia::Image>(1, 1, ImageFormat::RGBA, &white);
+		}
 		{
 			uint32_t w, h;
 			void* data = Image::Decode(g_UtopiaIcon, sizeof(g_UtopiaIcon), w, h);
@@ -634,6 +1012,72 @@ namespace Utopia {
 
 	}
 
+	bool Application::InitWindow()
+	{
+		// Setup GLFW window
+		glfwSetErrorCallback(glfw_error_callback);
+		if (!glfwInit())
+		{
+			std::cerr << "Could not initalize GLFW!\n";
+			return false;
+		}
+
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+
+		if (m_Specification.CustomTitlebar)
+		{
+			glfwWindowHint(GLFW_TITLEBAR, false);
+		}
+
+		GLFWmonitor* primaryMonitor = glfwGetPrimaryMonitor();
+		const GLFWvidmode* videoMode = glfwGetVideoMode(primaryMonitor);
+
+		int monitorX, monitorY;
+		glfwGetMonitorPos(primaryMonitor, &monitorX, &monitorY);
+
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+		m_WindowHandle = glfwCreateWindow(m_Specification.Width, m_Specification.Height, m_Specification.Name.c_str(), NULL, NULL);
+
+		if (m_Specification.CenterWindow)
+		{
+			glfwSetWindowPos(m_WindowHandle,
+				monitorX + (videoMode->width - m_Specification.Width) / 2,
+				monitorY + (videoMode->height - m_Specification.Height) / 2);
+
+			glfwSetWindowAttrib(m_WindowHandle, GLFW_RESIZABLE, m_Specification.WindowResizeable ? GLFW_TRUE : GLFW_FALSE);
+		}
+
+		glfwShowWindow(m_WindowHandle);
+
+		// Setup Vulkan
+		if (!glfwVulkanSupported())
+		{
+			std::cerr << "GLFW: Vulkan not supported!\n";
+			return false;
+		}
+
+		// Set icon
+		GLFWimage icon;
+		int channels;
+		if (!m_Specification.IconPath.empty())
+		{
+			std::string iconPathStr = m_Specification.IconPath.string();
+			icon.pixels = stbi_load(iconPathStr.c_str(), &icon.width, &icon.height, &channels, 4);
+			glfwSetWindowIcon(m_WindowHandle, 1, &icon);
+			stbi_image_free(icon.pixels);
+		}
+
+		glfwSetWindowUserPointer(m_WindowHandle, this);
+		glfwSetTitlebarHitTestCallback(m_WindowHandle, [](GLFWwindow* window, int x, int y, int* hit)
+			{
+				Application* app = (Application*)glfwGetWindowUserPointer(window);
+				*hit = app->IsTitleBarHovered();
+			});
+
+		return true;
+	}
+
 	void Application::Shutdown()
 	{
 		for (auto& layer : m_LayerStack)
@@ -641,9 +1085,22 @@ namespace Utopia {
 
 		m_LayerStack.clear();
 
+		// Finishes queued jobs
+		m_ThreadPool.reset();
+
+		// One last round for what is still queued, e.g. coroutines the finished jobs handed back
+		// to the main thread, so their frames and the images they hold are freed while the
+		// device and this Application are alive. Whatever that posts in turn is dropped.
+		m_EventQueue.Drain([](InplaceFunction<void()>& func) { func(); });
+		m_EventQueue.Clear();
+
+		// Frames of coroutines still waiting on a Delay() may own images, free them while the device is alive
+		m_DelayedCoroutines.Clear();
+
 		// Release resources
 		// NOTE: to avoid doing this manually, we shouldn't
 		//       store resources in this Application class
+		m_PlaceholderImage.reset();
 		m_AppHeaderIcon.reset();
 		m_IconClose.reset();
 		m_IconMinimize.reset();
@@ -662,15 +1119,38 @@ namespace Utopia {
 		}
 		s_ResourceFreeQueue.clear();
 
+		if (m_Specification.Offscreen)
+			s_OffscreenTarget.Shutdown();
+
+		for (DrawDataSnapshot& snapshot : s_DrawDataSnapshots)
+			snapshot.Clear();
+
+		s_DeletionQueue.Shutdown();
+		s_MemoryAllocator.Shutdown();
+		s_StagingRing.Shutdown();
+		s_UploadContext.Shutdown();
+		s_FramePacer.Shutdown();
+		s_SecondaryRecorder.Shutdown();
+		s_PipelineCache.Shutdown();
+		s_GpuProfiler.Shutdown();
+
 		ImGui_ImplVulkan_Shutdown();
-		ImGui_ImplGlfw_Shutdown();
+		if (!m_Specification.Offscreen)
+			ImGui_ImplGlfw_Shutdown();
 		ImGui::DestroyContext();
 
-		CleanupVulkanWindow();
+		// The offscreen render pass was destroyed with its target
+		if (m_Specification.Offscreen)
+			g_MainWindowData = ImGui_ImplVulkanH_Window();
+		else
+			CleanupVulkanWindow();
 		CleanupVulkan();
 
-		glfwDestroyWindow(m_WindowHandle);
-		glfwTerminate();
+		if (!m_Specification.Offscreen)
+		{
+			glfwDestroyWindow(m_WindowHandle);
+			glfwTerminate();
+		}
 
 		g_ApplicationRunning = false;
 
@@ -858,54 +1338,67 @@ namespace Utopia {
 		ImGui_ImplVulkanH_Window* wd = &g_MainWindowData;
 		ImVec4 clear_color = ImVec4(0.45f, 0.55f, 0.60f, 1.00f);
 		ImGuiIO& io = ImGui::GetIO();
+		uint32_t frameCount = 0;
+
+		wd->ClearValue.color.float32[0] = clear_color.x * clear_color.w;
+		wd->ClearValue.color.float32[1] = clear_color.y * clear_color.w;
+		wd->ClearValue.color.float32[2] = clear_color.z * clear_color.w;
+		wd->ClearValue.color.float32[3] = clear_color.w;
+
+		if (s_PipelinedRendering)
+		{
+			m_StopRenderThread = false;
+			m_RenderThread = std::thread([this]() { RenderThreadMain(); });
+		}
 
 		// Main loop
-		while (!glfwWindowShouldClose(m_WindowHandle) && m_Running)
+		while (m_Running && (m_Specification.Offscreen || !glfwWindowShouldClose(m_WindowHandle)))
 		{
+			// Waits for the GPU to be within the frames in flight limit and for the frame rate cap,
+			// so input is sampled as late as possible
+			s_FramePacer.BeginFrame();
+
 			// Poll and handle events (inputs, window resize, etc.)
 			// You can read the io.WantCaptureMouse, io.WantCaptureKeyboard flags to tell if dear imgui wants to use your inputs.
 			// - When io.WantCaptureMouse is true, do not dispatch mouse input data to your main application.
 			// - When io.WantCaptureKeyboard is true, do not dispatch keyboard input data to your main application.
 			// Generally you may always pass all inputs to dear imgui, and hide them from your application based on those two flags.
-			glfwPollEvents();
-
+			if (!m_Specification.Offscreen)
 			{
-				std::scoped_lock<std::mutex> lock(m_EventQueueMutex);
-
-				// Process custom event queue
-				while (m_EventQueue.size() > 0)
-				{
-					auto& func = m_EventQueue.front();
-					func();
-					m_EventQueue.pop();
-				}
+				if (m_Specification.PowerSaving)
+					WaitForEvents();
+				else
+					glfwPollEvents();
 			}
+			const FramePacer::Clock::time_point inputTime = s_FramePacer.InputPolled();
 
+			// Process custom event queue
+			// Events are taken out of the queue before any of them run, so producers never wait on the drain
+			m_EventQueue.Drain([](InplaceFunction<void()>& func) { func(); });
+			m_DelayedCoroutines.ResumeReady();
+
+			Timer updateTimer;
 			for (auto& layer : m_LayerStack)
 				layer->OnUpdate(m_TimeStep);
+			m_FrameStats.UpdateTime = updateTimer.ElapsedMillis();
 
-			// Resize swap chain?
-			if (g_SwapChainRebuild)
-			{
-				int width, height;
-				glfwGetFramebufferSize(m_WindowHandle, &width, &height);
-				if (width > 0 && height > 0)
-				{
-					ImGui_ImplVulkan_SetMinImageCount(g_MinImageCount);
-					ImGui_ImplVulkanH_CreateOrResizeWindow(g_Instance, g_PhysicalDevice, g_Device, &g_MainWindowData, g_QueueFamily, g_Allocator, width, height, g_MinImageCount);
-					g_MainWindowData.FrameIndex = 0;
-
-					// Clear allocated command buffers from here since entire pool is destroyed
-					s_AllocatedCommandBuffers.clear();
-					s_AllocatedCommandBuffers.resize(g_MainWindowData.ImageCount);
-
-					g_SwapChainRebuild = false;
-				}
-			}
+			// Resize swap chain? Pipelined, this waits until the render thread is idle.
+			if (!m_Specification.Offscreen && !s_PipelinedRendering)
+				RebuildSwapChain(m_WindowHandle);
 
 			// Start the Dear ImGui frame
+			Timer uiTimer;
 			ImGui_ImplVulkan_NewFrame();
-			ImGui_ImplGlfw_NewFrame();
+			if (m_Specification.Offscreen)
+			{
+				// What the platform backend would otherwise provide
+				io.DisplaySize = ImVec2((float)s_OffscreenTarget.GetWidth(), (float)s_OffscreenTarget.GetHeight());
+				io.DeltaTime = m_TimeStep > 0.0f ? m_TimeStep : 1.0f / 60.0f;
+			}
+			else
+			{
+				ImGui_ImplGlfw_NewFrame();
+			}
 			ImGui::NewFrame();
 
 			if (m_Specification.UseDockspace)
@@ -979,42 +1472,230 @@ namespace Utopia {
 
 			// Rendering
 			ImGui::Render();
+			m_FrameStats.UIRenderTime = uiTimer.ElapsedMillis();
 			ImDrawData* main_draw_data = ImGui::GetDrawData();
 			const bool main_is_minimized = (main_draw_data->DisplaySize.x <= 0.0f || main_draw_data->DisplaySize.y <= 0.0f);
-			wd->ClearValue.color.float32[0] = clear_color.x * clear_color.w;
-			wd->ClearValue.color.float32[1] = clear_color.y * clear_color.w;
-			wd->ClearValue.color.float32[2] = clear_color.z * clear_color.w;
-			wd->ClearValue.color.float32[3] = clear_color.w;
-			if (!main_is_minimized)
-				FrameRender(this, wd, main_draw_data);
-
-			// Update and Render additional Platform Windows
-			if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+
+			if (s_PipelinedRendering)
 			{
-				ImGui::UpdatePlatformWindows();
-				ImGui::RenderPlatformWindowsDefault();
+				SubmitPipelinedFrame(main_draw_data, inputTime, main_is_minimized);
 			}
-
-			// Present Main Platform Window
-			if (!main_is_minimized)
-				FramePresent(wd);
 			else
-				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			{
+				for (auto& layer : m_LayerStack)
+					layer->OnSnapshot();
+
+				// Async uploads recorded during the UI pass must reach the queue ahead of every window that draws them
+				s_UploadContext.SubmitBatch();
+
+				bool frameSubmitted = false;
+				if (m_Specification.Offscreen)
+					OffscreenFrameRender(wd, main_draw_data, m_LayerStack);
+				else if (!main_is_minimized)
+					frameSubmitted = FrameRender(wd, main_draw_data, m_LayerStack);
+
+				// Update and Render additional Platform Windows
+				if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+				{
+					ImGui::UpdatePlatformWindows();
+					ImGui::RenderPlatformWindowsDefault();
+				}
+
+				// Present Main Platform Window
+				if (!m_Specification.Offscreen)
+				{
+					if (frameSubmitted)
+						FramePresent(wd);
+					else if (main_is_minimized && !m_Specification.PowerSaving) // Blocks in WaitForEvents() until restored
+						std::this_thread::sleep_for(std::chrono::milliseconds(5));
+				}
+
+				s_FramePacer.EndFrame(g_Queue, inputTime);
+				PublishRenderStats();
+			}
 
 			float time = GetTime();
 			m_FrameTime = time - m_LastFrameTime;
+			m_FrameStats.FrameTime = m_FrameTime * 1000.0f;
 			m_TimeStep = glm::min<float>(m_FrameTime, 0.0333f);
 			m_LastFrameTime = time;
+
+			if (m_Specification.Offscreen && ++frameCount == m_Specification.OffscreenFrameCount)
+				m_Running = false;
+		}
+
+		if (m_Specification.Offscreen && !m_Specification.OffscreenOutputPath.empty())
+			SaveOffscreenImage(m_Specification.OffscreenOutputPath);
+
+		if (m_RenderThread.joinable())
+		{
+			WaitForRenderThread();
+			{
+				std::lock_guard<std::mutex> lock(m_RenderMutex);
+				m_StopRenderThread = true;
+			}
+			m_RenderCondition.notify_all();
+			m_RenderThread.join();
+			m_RenderFramePending = false;
+		}
+	}
+
+	void Application::SubmitPipelinedFrame(ImDrawData* drawData, FramePacer::Clock::time_point inputTime, bool minimized)
+	{
+		// Built while the render thread may still be drawing the other snapshot
+		DrawDataSnapshot& snapshot = s_DrawDataSnapshots[m_SnapshotIndex];
+		snapshot.Copy(drawData);
+		snapshot.Layers.assign(m_LayerStack.begin(), m_LayerStack.end());
+
+		// Platform windows are drawn right away, they share the ImGui context with the main thread
+		ImGuiIO& io = ImGui::GetIO();
+		if (io.ConfigFlags & ImGuiConfigFlags_ViewportsEnable)
+		{
+			ImGui::UpdatePlatformWindows();
+			std::lock_guard<std::mutex> lock(s_QueueMutex);
+			ImGui::RenderPlatformWindowsDefault();
+		}
+
+		WaitForRenderThread();
+
+		// The render thread is idle until the next hand-off, the queue and frame resources are ours
+		if (m_RenderFramePending)
+		{
+			s_FramePacer.EndFrame(g_Queue, m_RenderInputTime);
+			m_RenderFramePending = false;
+		}
+		PublishRenderStats();
+
+		for (auto& layer : m_LayerStack)
+			layer->OnSnapshot();
+
+		RebuildSwapChain(m_WindowHandle);
+
+		// Async uploads recorded during the UI pass must reach the queue ahead of the frame that draws them
+		s_UploadContext.SubmitBatch();
+
+		if (minimized)
+		{
+			if (!m_Specification.PowerSaving) // Blocks in WaitForEvents() until restored
+				std::this_thread::sleep_for(std::chrono::milliseconds(5));
+			return;
+		}
+
+		BeginFrameResources();
+
+		m_RenderInputTime = inputTime;
+		m_RenderFramePending = true;
+		m_SnapshotIndex ^= 1;
+		{
+			std::lock_guard<std::mutex> lock(m_RenderMutex);
+			m_RenderRequested = true;
+		}
+		m_RenderCondition.notify_all();
+	}
+
+	void Application::RenderThreadMain()
+	{
+		ImGui_ImplVulkanH_Window* wd = &g_MainWindowData;
+
+		std::unique_lock<std::mutex> lock(m_RenderMutex);
+		while (true)
+		{
+			m_RenderCondition.wait(lock, [this]() { return m_RenderRequested || m_StopRenderThread; });
+			if (!m_RenderRequested)
+				return;
+
+			// The main thread flipped to the other snapshot when handing this one over
+			DrawDataSnapshot& snapshot = s_DrawDataSnapshots[m_SnapshotIndex ^ 1];
+			lock.unlock();
+
+			if (FrameRender(wd, &snapshot.DrawData, snapshot.Layers))
+				FramePresent(wd);
+
+			lock.lock();
+			m_RenderRequested = false;
+			m_RenderCondition.notify_all();
+		}
+	}
+
+	void Application::WaitForRenderThread()
+	{
+		std::unique_lock<std::mutex> lock(m_RenderMutex);
+		m_RenderCondition.wait(lock, [this]() { return !m_RenderRequested; });
+	}
+
+	void Application::PublishRenderStats()
+	{
+		m_FrameStats.RenderTime = s_RenderCpuTime;
+		m_FrameStats.Latency = s_FramePacer.GetLatency() * 1000.0f;
+
+		const GpuProfiler::Results& results = s_GpuProfiler.GetResults();
+		m_FrameStats.GpuTimingSupported = s_GpuProfiler.IsSupported();
+		m_FrameStats.GpuFrameTime = results.FrameTime;
+		m_FrameStats.GpuImGuiTime = results.ImGuiTime;
+		m_FrameStats.GpuLayerTimes = results.LayerTimes;
+	}
+
+	void Application::RequestRedraw()
+	{
+		m_RedrawRequested = true;
+		WakeMainLoop();
+	}
+
+	void Application::WaitForEvents()
+	{
+		// Frames drawn after the last activity, hover states and layout changes take a couple
+		// of frames to settle in ImGui
+		static constexpr uint32_t settleFrames = 3;
+
+		if (m_IdleFrames >= settleFrames)
+		{
+			// Wake up in time for the next Delay() to expire
+			double timeout = -1.0;
+			if (auto resumeTime = m_DelayedCoroutines.GetNextResumeTime())
+			{
+				std::chrono::duration<double> remaining = *resumeTime - DelayedCoroutineQueue::Clock::now();
+				timeout = glm::max(0.0, remaining.count());
+			}
+
+			// Pairs with the fence in WakeMainLoop(): either the producer sees the flag and posts an
+			// empty event, or the check below sees its event or redraw request
+			m_WaitingForEvents.store(true);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (m_EventQueue.IsEmpty() && !m_RedrawRequested.load())
+			{
+				if (timeout < 0.0)
+					glfwWaitEvents();
+				else
+					glfwWaitEventsTimeout(timeout);
+			}
+			m_WaitingForEvents.store(false);
+
+			m_IdleFrames = 0;
 		}
 
+		glfwPollEvents();
+
+		// ImGui's GLFW callbacks queue every input event
+		const bool hasInput = ImGui::GetCurrentContext()->InputEventsQueue.Size > 0;
+		if (hasInput || !m_EventQueue.IsEmpty() || m_RedrawRequested.exchange(false))
+			m_IdleFrames = 0;
+		else
+			m_IdleFrames++;
 	}
 
-	void Application::SetMenubarCallback(const std::function<void()>& menubarCallback)
+	void Application::WakeMainLoop()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (m_WaitingForEvents.exchange(false))
+			glfwPostEmptyEvent();
+	}
+
+	void Application::SetMenubarCallback(InplaceFunction<void()> menubarCallback)
 	{
 		if (!m_Specification.UseDockspace)
 			UT_CORE_WARN_TAG("Application", "Application::SetMenubarCallback - ApplicationSpecification::UseDockspace is false to menubar will not be visible.");
 
-		m_MenubarCallback = menubarCallback;
+		m_MenubarCallback = std::move(menubarCallback);
 	}
 
 	void Application::Close()
@@ -1024,14 +1705,57 @@ namespace Utopia {
 
 	bool Application::IsMaximized() const
 	{
-		return (bool)glfwGetWindowAttrib(m_WindowHandle, GLFW_MAXIMIZED);
+		return m_WindowHandle && (bool)glfwGetWindowAttrib(m_WindowHandle, GLFW_MAXIMIZED);
 	}
 
 	float Application::GetTime()
 	{
+		if (m_Specification.Offscreen)
+			return m_AppTimer.Elapsed();
+
 		return (float)glfwGetTime();
 	}
 
+	std::shared_ptr<Image> Application::GetOffscreenImage() const
+	{
+		return m_Specification.Offscreen ? s_OffscreenTarget.GetImage() : nullptr;
+	}
+
+	bool Application::ReadOffscreenPixels(std::vector<uint8_t>& outPixels)
+	{
+		return m_Specification.Offscreen && s_OffscreenTarget.ReadPixels(outPixels);
+	}
+
+	bool Application::SaveOffscreenImage(const std::filesystem::path& path)
+	{
+		std::vector<uint8_t> pixels;
+		if (!ReadOffscreenPixels(pixels))
+		{
+			UT_CORE_ERROR_TAG("Application", "No offscreen frame to save to '{}'", path.string());
+			return false;
+		}
+
+		const int width = (int)s_OffscreenTarget.GetWidth();
+		const int height = (int)s_OffscreenTarget.GetHeight();
+		if (!stbi_write_png(path.string().c_str(), width, height, 4, pixels.data(), width * 4))
+		{
+			UT_CORE_ERROR_TAG("Application", "Failed to write '{}'", path.string());
+			return false;
+		}
+
+		return true;
+	}
+
+	void Application::SetOffscreenSize(uint32_t width, uint32_t height)
+	{
+		if (!m_Specification.Offscreen || width == 0 || height == 0)
+			return;
+
+		m_Specification.Width = width;
+		m_Specification.Height = height;
+		s_OffscreenTarget.Resize(width, height);
+	}
+
 	VkInstance Application::GetInstance()
 	{
 		return g_Instance;
@@ -1047,63 +1771,60 @@ namespace Utopia {
 		return g_Device;
 	}
 
-	VkCommandBuffer Application::GetCommandBuffer(bool begin)
+	VkPipelineCache Application::GetPipelineCache()
 	{
-		ImGui_ImplVulkanH_Window* wd = &g_MainWindowData;
-
-		// Use any command queue
-		VkCommandPool command_pool = wd->Frames[wd->FrameIndex].CommandPool;
-
-		VkCommandBufferAllocateInfo cmdBufAllocateInfo = {};
-		cmdBufAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-		cmdBufAllocateInfo.commandPool = command_pool;
-		cmdBufAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-		cmdBufAllocateInfo.commandBufferCount = 1;
-
-		VkCommandBuffer& command_buffer = s_AllocatedCommandBuffers[wd->FrameIndex].emplace_back();
-		auto err = vkAllocateCommandBuffers(g_Device, &cmdBufAllocateInfo, &command_buffer);
-
-		VkCommandBufferBeginInfo begin_info = {};
-		begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		begin_info.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-		err = vkBeginCommandBuffer(command_buffer, &begin_info);
-		check_vk_result(err);
+		return s_PipelineCache.GetHandle();
+	}
 
-		return command_buffer;
+	VkCommandBuffer Application::GetCommandBuffer(bool begin)
+	{
+		// Pooled and recycled once executed, see Vulkan/UploadContext
+		return s_UploadContext.Allocate();
 	}
 
 	void Application::FlushCommandBuffer(VkCommandBuffer commandBuffer)
 	{
-		const uint64_t DEFAULT_FENCE_TIMEOUT = 100000000000;
+		s_UploadContext.Flush(commandBuffer);
+	}
 
-		VkSubmitInfo end_info = {};
-		end_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		end_info.commandBufferCount = 1;
-		end_info.pCommandBuffers = &commandBuffer;
-		auto err = vkEndCommandBuffer(commandBuffer);
-		check_vk_result(err);
+	UploadContext& Application::GetUploadContext()
+	{
+		return s_UploadContext;
+	}
 
-		// Create fence to ensure that the command buffer has finished executing
-		VkFenceCreateInfo fenceCreateInfo = {};
-		fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-		fenceCreateInfo.flags = 0;
-		VkFence fence;
-		err = vkCreateFence(g_Device, &fenceCreateInfo, nullptr, &fence);
-		check_vk_result(err);
+	StagingRing& Application::GetStagingRing()
+	{
+		return s_StagingRing;
+	}
 
-		err = vkQueueSubmit(g_Queue, 1, &end_info, fence);
-		check_vk_result(err);
+	FramePacer& Application::GetFramePacer()
+	{
+		return s_FramePacer;
+	}
 
-		err = vkWaitForFences(g_Device, 1, &fence, VK_TRUE, DEFAULT_FENCE_TIMEOUT);
-		check_vk_result(err);
+	void Application::SetPresentMode(PresentMode mode)
+	{
+		m_Specification.SwapchainPresentMode = mode;
+		if (m_Specification.Offscreen || !g_MainWindowData.Surface) // Applied when the window is set up
+			return;
+
+		// The render thread may be presenting, so the swapchain is rebuilt at the next sync point
+		g_PendingPresentMode = mode;
+	}
 
-		vkDestroyFence(g_Device, fence, nullptr);
+	void Application::SubmitResourceFree(InplaceFunction<void()>&& func)
+	{
+		s_ResourceFreeQueue[s_CurrentFrameIndex].emplace_back(std::move(func));
 	}
 
+	DeletionQueue& Application::GetDeletionQueue()
+	{
+		return s_DeletionQueue;
+	}
 
-	void Application::SubmitResourceFree(std::function<void()>&& func)
+	MemoryAllocator& Application::GetMemoryAllocator()
 	{
-		s_ResourceFreeQueue[s_CurrentFrameIndex].emplace_back(func);
+		return s_MemoryAllocator;
 	}
 
 	ImFont* Application::GetFont(const std::string& name)
@@ -1,13 +1,30 @@
 #pragma once
 
 #include "Utopia/Layer.hpp"
+#include "Utopia/Timer.hpp"
 #include "Utopia/Image.hpp"
-
+#include "Utopia/ImageDecodeCache.hpp"
+#include "Utopia/Vulkan/DeletionQueue.hpp"
+#include "Utopia/Vulkan/MemoryAllocator.hpp"
+#include "Utopia/Vulkan/UploadContext.hpp"
+#include "Utopia/Vulkan/StagingRing.hpp"
+#include "Utopia/Vulkan/FramePacer.hpp"
+#include "Utopia/Vulkan/SecondaryCommandRecorder.hpp"
+#include "Utopia/Vulkan/PipelineCache.hpp"
+#include "Utopia/Vulkan/GpuProfiler.hpp"
+#include "Utopia/Core/MPSCQueue.hpp"
+#include "Utopia/Core/InplaceFunction.hpp"
+#include "Utopia/Core/CoroutineScheduler.hpp"
+#include "Utopia/Core/ThreadPool.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
 #include <string>
 #include <vector>
-#include <queue>
-#include <mutex>
 #include <memory>
+#include <thread>
+#include <coroutine>
 #include <functional>
 #include <filesystem>
 
@@ -21,6 +38,19 @@ struct GLFWwindow;
 
 namespace Utopia {
 
+	// Swapchain presentation mode. Unsupported modes fall back to the next one down the list.
+	enum class PresentMode : uint8_t
+	{
+		// Presents on vertical blank, no tearing. Throttles rendering to the display rate and is
+		// always supported.
+		Fifo = 0,
+		// Presents on vertical blank, but newer frames replace a queued one, so rendering is not
+		// throttled and latency is lower. No tearing.
+		Mailbox,
+		// Presents right away, lowest latency but may tear
+		Immediate
+	};
+
 	struct ApplicationSpecification
 	{
 		std::string Name = "Utopia App";
@@ -29,6 +59,17 @@ namespace Utopia {
 
 		std::filesystem::path IconPath;
 
+		// Decoded images are kept here across runs so later starts skip decoding, see
+		// ImageDecodeCache. Empty disables the cache.
+		std::filesystem::path ImageDecodeCacheDirectory;
+		bool ImageDecodeCacheCompression = true;
+		// Least recently used entries are evicted past this many bytes. 0 means no limit.
+		uint64_t ImageDecodeCacheMaxSize = 1024ull * 1024 * 1024;
+
+		// File the Vulkan pipeline cache is loaded from at startup and saved to on shutdown, see
+		// Vulkan/PipelineCache. Empty keeps it in memory for the run.
+		std::filesystem::path PipelineCachePath;
+
 		bool WindowResizeable = true;
 
 		// Uses custom Utopia titlebar instead
@@ -42,6 +83,56 @@ namespace Utopia {
 		// Window will be created in the center
 		// of primary monitor
 		bool CenterWindow = false;
+
+		// Swapchain presentation, can be changed later with Application::SetPresentMode()
+		PresentMode SwapchainPresentMode = PresentMode::Fifo;
+		// Frames the CPU may run ahead of the GPU (1-4); 1 has the lowest input latency. See
+		// Vulkan/FramePacer, which also takes later changes.
+		uint32_t FramesInFlight = 2;
+		// Frame rate cap in frames per second, 0 for none
+		float TargetFrameRate = 0.0f;
+
+		// Sleeps until something happens instead of redrawing continuously. Frames are drawn on
+		// input, QueueEvent() posts, expiring Delay()s and RequestRedraw(), each followed by a few
+		// more so ImGui can settle. Layers that animate call RequestRedraw() every frame while they do.
+		bool PowerSaving = false;
+
+		// Renders on a thread of its own. The main thread handles events, OnUpdate and OnUIRender for
+		// the next frame while the render thread records and presents the previous one from a copy
+		// of its ImGui draw data, which adds a frame of latency. OnRender then runs on the render
+		// thread: it may only record into GetActiveCommandBuffer() and read state that the layer
+		// copied in OnSnapshot(). Ignored in offscreen mode.
+		bool PipelinedRendering = false;
+
+		// Renders into an offscreen image of Width x Height instead of a window. No GLFW window,
+		// surface or swapchain is created, so this runs without a display and on software Vulkan
+		// drivers (e.g. lavapipe). Layers still get OnUpdate/OnUIRender/OnRender every frame.
+		bool Offscreen = false;
+		// Offscreen only: Run() returns after this many frames, 0 runs until Close()
+		uint32_t OffscreenFrameCount = 0;
+		// Offscreen only: the last frame is saved here as PNG when Run() returns
+		std::filesystem::path OffscreenOutputPath;
+	};
+
+	// Timings of the most recent frames, in milliseconds. CPU times are from the frame that just
+	// ended on the main thread; render and GPU times trail it, GPU times by at least one frame
+	// since timestamps are read back once the GPU is done with them.
+	struct FrameStats
+	{
+		// CPU
+		float FrameTime = 0.0f;
+		float UpdateTime = 0.0f;   // OnUpdate of all layers
+		float UIRenderTime = 0.0f; // ImGui frame: OnUIRender of all layers and ImGui::Render
+		float RenderTime = 0.0f;   // Recording the frame: OnRender of all layers and the ImGui draw
+		// Input to GPU completion, see FramePacer
+		float Latency = 0.0f;
+
+		// GPU, all 0 when the device has no timestamp support
+		bool GpuTimingSupported = false;
+		float GpuFrameTime = 0.0f; // The whole frame render pass
+		float GpuImGuiTime = 0.0f;
+		// OnRender of each layer, in layer stack order (see GpuProfiler::MaxTimedLayers)
+		std::vector<float> GpuLayerTimes;
 	};
 
 	class Application
@@ -53,7 +144,7 @@ namespace Utopia {
 		static Application& Get();
 
 		void Run();
-		void SetMenubarCallback(const std::function<void()>& menubarCallback);
+		void SetMenubarCallback(InplaceFunction<void()> menubarCallback);
 
 		template<typename T>
 		void PushLayer()
@@ -70,34 +161,111 @@ namespace Utopia {
 
 		bool IsMaximized() const;
 		std::shared_ptr<Image> GetApplicationIcon() const { return m_AppHeaderIcon; }
+		// 1x1 white image shown in place of images whose first async upload is still in flight
+		std::shared_ptr<Image> GetPlaceholderImage() const { return m_PlaceholderImage; }
 
 		float GetTime();
+		// nullptr in offscreen mode
 		GLFWwindow* GetWindowHandle() const { return m_WindowHandle; }
 		bool IsTitleBarHovered() const { return m_TitleBarHovered; }
 
 		static VkInstance GetInstance();
 		static VkPhysicalDevice GetPhysicalDevice();
 		static VkDevice GetDevice();
+		// Application-wide pipeline cache, persisted across runs when
+		// ApplicationSpecification::PipelineCachePath is set. Pass it to vkCreate*Pipelines.
+		static VkPipelineCache GetPipelineCache();
 
 		static VkCommandBuffer GetCommandBuffer(bool begin);
 		static void FlushCommandBuffer(VkCommandBuffer commandBuffer);
 
-		static void SubmitResourceFree(std::function<void()>&& func);
+		// Batched one-off submissions with completion tickets
+		static UploadContext& GetUploadContext();
+		static StagingRing& GetStagingRing();
+
+		// Frames in flight, frame rate cap and latency readout
+		static FramePacer& GetFramePacer();
+
+		// Main thread, updated once per frame
+		const FrameStats& GetFrameStats() const { return m_FrameStats; }
+
+		// The swapchain is rebuilt with the new mode on the next frame
+		void SetPresentMode(PresentMode mode);
+		PresentMode GetPresentMode() const { return m_Specification.SwapchainPresentMode; }
+
+		static void SubmitResourceFree(InplaceFunction<void()>&& func);
+
+		// Typed, thread-safe alternative to SubmitResourceFree for plain Vulkan handles
+		static DeletionQueue& GetDeletionQueue();
+
+		// Pooled device memory, see Vulkan/MemoryAllocator
+		static MemoryAllocator& GetMemoryAllocator();
 
 		static ImFont* GetFont(const std::string& name);
 
+		// Thread-safe; func is executed on the main thread at the start of the next frame
 		template<typename Func>
 		void QueueEvent(Func&& func)
 		{
-			m_EventQueue.push(func);
+			m_EventQueue.Push(std::forward<Func>(func));
+			WakeMainLoop();
 		}
 
+		// Thread-safe; makes sure another frame is drawn in power-saving mode (see
+		// ApplicationSpecification::PowerSaving). Frames are drawn continuously otherwise.
+		void RequestRedraw();
+
+		bool IsMainThread() const { return std::this_thread::get_id() == m_MainThreadID; }
+
+		// Shared worker threads for background work such as image decoding
+		ThreadPool& GetThreadPool() { return *m_ThreadPool; }
+
+		ImageDecodeCache& GetImageDecodeCache() { return m_ImageDecodeCache; }
+
+		// Offscreen mode, see ApplicationSpecification::Offscreen
+		bool IsOffscreen() const { return m_Specification.Offscreen; }
+		// Image the frames are rendered into, nullptr when rendering to a window
+		std::shared_ptr<Image> GetOffscreenImage() const;
+		// RGBA8 pixels of the last rendered frame, rows top to bottom. Waits for the GPU.
+		bool ReadOffscreenPixels(std::vector<uint8_t>& outPixels);
+		bool SaveOffscreenImage(const std::filesystem::path& path);
+		// Frames after this call render at the new size. Waits for the frame in flight; the
+		// pixels of the previous frame are no longer readable. Main thread only.
+		void SetOffscreenSize(uint32_t width, uint32_t height);
+
+		// Coroutine awaitables (see Utopia/Core/Task.hpp and Utopia/Core/CoroutineScheduler.hpp)
+		using NextFrameAwaiter = Detail::NextFrameAwaiter<Application>;
+		using DelayAwaiter = Detail::DelayAwaiter<Application>;
+		using MainThreadAwaiter = Detail::MainThreadAwaiter<Application>;
+
+		// co_await Application::NextFrame();
+		static NextFrameAwaiter NextFrame() { return {}; }
+		// co_await Application::Delay(500);
+		static DelayAwaiter Delay(uint32_t milliseconds) { return { std::chrono::milliseconds(milliseconds) }; }
+		// co_await Application::SwitchToMainThread(); - no-op when already on the main thread
+		static MainThreadAwaiter SwitchToMainThread() { return {}; }
+
 		static ImGui_ImplVulkanH_Window* GetMainWindowData();
+		// Command buffer OnRender records into, per thread: a layer rendering in parallel gets its own
+		// secondary command buffer (see Layer::WantsParallelRender)
 		static VkCommandBuffer GetActiveCommandBuffer();
 	private:
 		void Init();
+		bool InitWindow();
 		void Shutdown();
 
+		// Power-saving mode: polls while frames are still due, otherwise blocks until an event
+		void WaitForEvents();
+		// Interrupts WaitForEvents() if the main thread is blocked in it
+		void WakeMainLoop();
+
+		// Pipelined rendering, see ApplicationSpecification::PipelinedRendering
+		void SubmitPipelinedFrame(ImDrawData* drawData, FramePacer::Clock::time_point inputTime, bool minimized);
+		void RenderThreadMain();
+		void WaitForRenderThread();
+		// Copies render thread timings into m_FrameStats; the render thread must be idle
+		void PublishRenderStats();
+
 		// For custom titlebars
 		void UI_DrawTitlebar(float& outTitlebarHeight);
 		void UI_DrawMenubar();
@@ -109,18 +277,48 @@ namespace Utopia {
 		float m_TimeStep = 0.0f;
 		float m_FrameTime = 0.0f;
 		float m_LastFrameTime = 0.0f;
+		FrameStats m_FrameStats;
+		// Clock for offscreen mode, where GLFW is not initialized
+		Timer m_AppTimer;
 
 		bool m_TitleBarHovered = false;
 
 		std::vector<std::shared_ptr<Layer>> m_LayerStack;
-		std::function<void()> m_MenubarCallback;
+		InplaceFunction<void()> m_MenubarCallback;
+
+		MPSCQueue<InplaceFunction<void()>> m_EventQueue;
+
+		// Power-saving mode state, see WaitForEvents()
+		uint32_t m_IdleFrames = 0;
+		std::atomic<bool> m_RedrawRequested = false;
+		std::atomic<bool> m_WaitingForEvents = false;
+
+		// Coroutines suspended on Delay(), main thread only
+		DelayedCoroutineQueue m_DelayedCoroutines;
+		template<typename> friend struct Detail::DelayAwaiter;
+
+		// Pipelined rendering state. The render thread only reads the frame fields between
+		// SubmitPipelinedFrame() handing a frame over and WaitForRenderThread() returning.
+		std::thread m_RenderThread;
+		std::mutex m_RenderMutex;
+		std::condition_variable m_RenderCondition;
+		bool m_RenderRequested = false;
+		bool m_StopRenderThread = false;
+		// Draw data snapshot being built by the main thread, the render thread draws the other one
+		uint32_t m_SnapshotIndex = 0;
+		// Handed-over frame whose pacer fence has not been submitted yet
+		bool m_RenderFramePending = false;
+		FramePacer::Clock::time_point m_RenderInputTime;
+
+		std::thread::id m_MainThreadID;
 
-		std::mutex m_EventQueueMutex;
-		std::queue<std::function<void()>> m_EventQueue;
+		std::unique_ptr<ThreadPool> m_ThreadPool;
+		ImageDecodeCache m_ImageDecodeCache;
 
 		// Resources
 		// TODO: move out of application class since this can't be tied
 		//       to application lifetime
+		std::shared_ptr<Utopia::Image> m_PlaceholderImage;
 		std::shared_ptr<Utopia::Image> m_AppHeaderIcon;
 		std::shared_ptr<Utopia::Image> m_IconClose;
 		std::shared_ptr<Utopia::Image> m_IconMinimize;
@@ -0,0 +1,193 @@
+#include "CompressedImage.hpp"
+
+#include "ApplicationGUI.hpp"
+#include "Utopia/Utils/Mipmaps.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace Utopia {
+
+	namespace Utils {
+
+		template<typename T>
+		static T ReadValue(const uint8_t* data)
+		{
+			T value;
+			memcpy(&value, data, sizeof(T));
+			return value;
+		}
+
+		static constexpr uint32_t MakeFourCC(char a, char b, char c, char d)
+		{
+			return (uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24);
+		}
+
+		static ImageFormat DXGIFormatToImageFormat(uint32_t format)
+		{
+			switch (format)
+			{
+			case 71: case 72: return ImageFormat::BC1; // DXGI_FORMAT_BC1_UNORM(_SRGB)
+			case 77: case 78: return ImageFormat::BC3; // DXGI_FORMAT_BC3_UNORM(_SRGB)
+			case 98: case 99: return ImageFormat::BC7; // DXGI_FORMAT_BC7_UNORM(_SRGB)
+			}
+			return ImageFormat::None;
+		}
+
+		static ImageFormat VulkanFormatToImageFormat(uint32_t format)
+		{
+			switch ((VkFormat)format)
+			{
+			case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+			case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+			case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: return ImageFormat::BC1;
+			case VK_FORMAT_BC3_UNORM_BLOCK:
+			case VK_FORMAT_BC3_SRGB_BLOCK:      return ImageFormat::BC3;
+			case VK_FORMAT_BC7_UNORM_BLOCK:
+			case VK_FORMAT_BC7_SRGB_BLOCK:      return ImageFormat::BC7;
+			}
+			return ImageFormat::None;
+		}
+
+		static const char* ParseDDS(const uint8_t* data, size_t size, CompressedImageData& outImage)
+		{
+			// "DDS " + DDS_HEADER
+			constexpr size_t HeaderSize = 4 + 124;
+			if (size < HeaderSize)
+				return "truncated DDS header";
+
+			const uint32_t height = ReadValue<uint32_t>(data + 12);
+			const uint32_t width = ReadValue<uint32_t>(data + 16);
+			const uint32_t mipMapCount = ReadValue<uint32_t>(data + 28);
+			const uint32_t fourCC = ReadValue<uint32_t>(data + 84);
+
+			size_t offset = HeaderSize;
+			ImageFormat format = ImageFormat::None;
+			if (fourCC == MakeFourCC('D', 'X', 'T', '1'))
+			{
+				format = ImageFormat::BC1;
+			}
+			else if (fourCC == MakeFourCC('D', 'X', 'T', '5'))
+			{
+				format = ImageFormat::BC3;
+			}
+			else if (fourCC == MakeFourCC('D', 'X', '1', '0'))
+			{
+				// DDS_HEADER_DXT10
+				if (size < HeaderSize + 20)
+					return "truncated DDS DX10 header";
+
+				const uint32_t resourceDimension = ReadValue<uint32_t>(data + HeaderSize + 4);
+				if (resourceDimension != 3) // D3D10_RESOURCE_DIMENSION_TEXTURE2D
+					return "only 2D DDS textures are supported";
+
+				format = DXGIFormatToImageFormat(ReadValue<uint32_t>(data + HeaderSize));
+				offset += 20;
+			}
+
+			if (format == ImageFormat::None)
+				return "unsupported DDS format, expected BC1, BC3 or BC7";
+			if (width == 0 || height == 0)
+				return "invalid DDS size";
+
+			outImage.Format = format;
+			outImage.Width = width;
+			outImage.Height = height;
+			outImage.MipLevels = std::clamp(mipMapCount, 1u, Utils::CalculateMipLevelCount(width, height));
+
+			// Levels follow the header tightly packed, which is the layout we keep
+			uint64_t dataSize = 0;
+			for (uint32_t level = 0; level < outImage.MipLevels; level++)
+				dataSize += Image::GetLevelSize(format, MipLevelExtent(width, level), MipLevelExtent(height, level));
+
+			if (size - offset < dataSize)
+				return "truncated DDS data";
+
+			outImage.Data.assign(data + offset, data + offset + dataSize);
+			return nullptr;
+		}
+
+		static const char* ParseKTX2(const uint8_t* data, size_t size, CompressedImageData& outImage)
+		{
+			// Identifier, header and index; the level index follows
+			constexpr size_t HeaderSize = 12 + 36 + 32;
+			if (size < HeaderSize)
+				return "truncated KTX2 header";
+
+			const uint32_t vkFormat = ReadValue<uint32_t>(data + 12);
+			const uint32_t width = ReadValue<uint32_t>(data + 20);
+			const uint32_t height = ReadValue<uint32_t>(data + 24);
+			const uint32_t depth = ReadValue<uint32_t>(data + 28);
+			const uint32_t levelCount = std::max(ReadValue<uint32_t>(data + 40), 1u);
+			const uint32_t supercompressionScheme = ReadValue<uint32_t>(data + 44);
+
+			const ImageFormat format = VulkanFormatToImageFormat(vkFormat);
+			if (format == ImageFormat::None)
+				return "unsupported KTX2 format, expected BC1, BC3 or BC7";
+			if (supercompressionScheme != 0)
+				return "KTX2 supercompression is not supported";
+			if (width == 0 || height == 0 || depth > 1)
+				return "only 2D KTX2 textures are supported";
+			if (levelCount > Utils::CalculateMipLevelCount(width, height))
+				return "invalid KTX2 level count";
+			if (size < HeaderSize + (size_t)levelCount * 24)
+				return "truncated KTX2 level index";
+
+			outImage.Format = format;
+			outImage.Width = width;
+			outImage.Height = height;
+			outImage.MipLevels = levelCount;
+			outImage.Data.clear();
+
+			for (uint32_t level = 0; level < levelCount; level++)
+			{
+				const uint8_t* entry = data + HeaderSize + level * 24;
+				const uint64_t byteOffset = ReadValue<uint64_t>(entry);
+				const uint64_t byteLength = ReadValue<uint64_t>(entry + 8);
+
+				// A level holds every layer and face; the first image comes first
+				const uint64_t levelSize = Image::GetLevelSize(format, MipLevelExtent(width, level), MipLevelExtent(height, level));
+				if (byteLength < levelSize || byteOffset > size || size - byteOffset < levelSize)
+					return "truncated KTX2 level data";
+
+				outImage.Data.insert(outImage.Data.end(), data + byteOffset, data + byteOffset + levelSize);
+			}
+
+			return nullptr;
+		}
+
+	}
+
+	bool IsCompressedImageFile(std::string_view path)
+	{
+		auto endsWith = [path](std::string_view extension)
+		{
+			if (path.size() < extension.size())
+				return false;
+
+			return std::equal(extension.begin(), extension.end(), path.end() - extension.size(),
+				[](char a, char b) { return a == std::tolower((unsigned char)b); });
+		};
+
+		return endsWith(".dds") || endsWith(".ktx2");
+	}
+
+	const char* ParseCompressedImage(const uint8_t* data, size_t size, CompressedImageData& outImage)
+	{
+		static constexpr uint8_t KTX2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+		const char* error = "not a DDS or KTX2 file";
+		if (size >= 4 && memcmp(data, "DDS ", 4) == 0)
+			error = Utils::ParseDDS(data, size, outImage);
+		else if (size >= sizeof(KTX2Identifier) && memcmp(data, KTX2Identifier, sizeof(KTX2Identifier)) == 0)
+			error = Utils::ParseKTX2(data, size, outImage);
+
+		if (!error && !Image::IsFormatSupported(outImage.Format))
+			error = "BC texture compression is not supported by the device";
+
+		return error;
+	}
+
+}
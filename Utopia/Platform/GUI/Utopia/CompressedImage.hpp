@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Image.hpp"
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace Utopia {
+
+	// Block compressed image as stored in a DDS or KTX2 file
+	struct CompressedImageData
+	{
+		ImageFormat Format = ImageFormat::None;
+		uint32_t Width = 0, Height = 0;
+		uint32_t MipLevels = 0;
+		// Every level tightly packed, largest first (the layout Image::SetData() expects)
+		std::vector<uint8_t> Data;
+	};
+
+	// By extension: .dds or .ktx2
+	bool IsCompressedImageFile(std::string_view path);
+
+	// Reads 2D BC1/BC3/BC7 images; sRGB variants are loaded as their UNORM counterparts, which
+	// is what the UNORM swapchain expects. Only the first layer/face is kept, and KTX2
+	// supercompression is not supported. Also fails if the device can't sample the format.
+	// Returns nullptr on success, the reason otherwise.
+	const char* ParseCompressedImage(const uint8_t* data, size_t size, CompressedImageData& outImage);
+
+}
@@ -4,35 +4,95 @@
 #include "backends/imgui_impl_vulkan.h"
 
 #include "ApplicationGUI.hpp"
+#include "CompressedImage.hpp"
+#include "ImageDecodeCache.hpp"
+#include "Utopia/Core/Log.hpp"
+#include "Utopia/Core/Hash.hpp"
+#include "Utopia/Utils/FileUtils.hpp"
+#include "Utopia/Utils/Mipmaps.hpp"
+#include "Utopia/Utils/PixelConversion.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <unordered_map>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
 
 namespace Utopia {
 
 	namespace Utils {
 
-		static uint32_t GetVulkanMemoryType(VkMemoryPropertyFlags properties, uint32_t type_bits)
+		// Size of a pixel in the data passed to SetData()
+		static uint32_t BytesPerPixel(ImageFormat format)
 		{
-			VkPhysicalDeviceMemoryProperties prop;
-			vkGetPhysicalDeviceMemoryProperties(Application::GetPhysicalDevice(), &prop);
-			for (uint32_t i = 0; i < prop.memoryTypeCount; i++)
+			switch (format)
 			{
-				if ((prop.memoryTypes[i].propertyFlags & properties) == properties && type_bits & (1 << i))
-					return i;
+			case ImageFormat::RGBA:    return 4;
+			case ImageFormat::RGBA32F: return 16;
+			case ImageFormat::R8:      return 1;
+			case ImageFormat::RG8:     return 2;
+			case ImageFormat::RGB8:    return 3;
+			case ImageFormat::BGR8:    return 3;
+			case ImageFormat::BGRA8:   return 4;
+			case ImageFormat::RGBA16F: return 8;
 			}
-
-			return 0xffffffff;
+			return 0;
 		}
 
-		static uint32_t BytesPerPixel(ImageFormat format)
+		// Size of a texel on the GPU; differs where the upload converts
+		static uint32_t GPUBytesPerPixel(ImageFormat format)
 		{
 			switch (format)
 			{
-			case ImageFormat::RGBA:    return 4;
-			case ImageFormat::RGBA32F: return 16;
+			case ImageFormat::RGB8:
+			case ImageFormat::BGR8:    return 4;
 			}
-			return 0;
+			return BytesPerPixel(format);
+		}
+
+		// stb_image reads through these, so the decoder's position in the file is the progress.
+		// Everything read is hashed on the way.
+		struct ProgressReader
+		{
+			FILE* File;
+			long Size;
+			long Read;
+			std::atomic<float>& Progress;
+			uint64_t ContentHash = Hash::FNV1aOffsetBasis;
+		};
+
+		static int ProgressRead(void* user, char* data, int size)
+		{
+			ProgressReader& reader = *(ProgressReader*)user;
+			int read = (int)fread(data, 1, size, reader.File);
+			reader.Read += read;
+			reader.ContentHash = Hash::FNV1a(data, read, reader.ContentHash);
+			if (reader.Size > 0)
+				reader.Progress.store(0.95f * (float)reader.Read / (float)reader.Size, std::memory_order_relaxed);
+			return read;
+		}
+
+		static void ProgressSkip(void* user, int n)
+		{
+			// Read instead of seeking so skipped bytes are part of the hash
+			char buffer[4096];
+			while (n > 0)
+			{
+				const int read = ProgressRead(user, buffer, std::min(n, (int)sizeof(buffer)));
+				if (read <= 0)
+					break;
+				n -= read;
+			}
+		}
+
+		static int ProgressEof(void* user)
+		{
+			return feof(((ProgressReader*)user)->File);
 		}
 
 		static VkFormat UtopiaFormatToVulkanFormat(ImageFormat format)
@@ -41,45 +101,235 @@ namespace Utopia {
 			{
 			case ImageFormat::RGBA:    return VK_FORMAT_R8G8B8A8_UNORM;
 			case ImageFormat::RGBA32F: return VK_FORMAT_R32G32B32A32_SFLOAT;
+			case ImageFormat::R8:      return VK_FORMAT_R8_UNORM;
+			case ImageFormat::RG8:     return VK_FORMAT_R8G8_UNORM;
+			// 24-bit formats are rarely sampleable, they are expanded to RGBA on upload
+			case ImageFormat::RGB8:    return VK_FORMAT_R8G8B8A8_UNORM;
+			case ImageFormat::BGR8:    return VK_FORMAT_R8G8B8A8_UNORM;
+			case ImageFormat::BGRA8:   return VK_FORMAT_B8G8R8A8_UNORM;
+			case ImageFormat::RGBA16F: return VK_FORMAT_R16G16B16A16_SFLOAT;
+			case ImageFormat::BC1:     return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+			case ImageFormat::BC3:     return VK_FORMAT_BC3_UNORM_BLOCK;
+			case ImageFormat::BC7:     return VK_FORMAT_BC7_UNORM_BLOCK;
 			}
 			return (VkFormat)0;
 		}
 
+		static VkComponentMapping UtopiaFormatToComponentMapping(ImageFormat format)
+		{
+			// Grayscale instead of red
+			if (format == ImageFormat::R8)
+				return { VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_R, VK_COMPONENT_SWIZZLE_ONE };
+
+			return { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+		}
+
+		// Bytes of one level in staging memory
+		static uint64_t GPULevelSize(ImageFormat format, uint32_t width, uint32_t height)
+		{
+			if (Image::IsCompressedFormat(format))
+				return Image::GetLevelSize(format, width, height);
+
+			return (uint64_t)width * height * GPUBytesPerPixel(format);
+		}
+
+		static MipComponentType GetMipComponentType(ImageFormat format)
+		{
+			switch (format)
+			{
+			case ImageFormat::RGBA32F: return MipComponentType::Float32;
+			case ImageFormat::RGBA16F: return MipComponentType::Float16;
+			}
+			return MipComponentType::UNorm8;
+		}
+
+		static bool CanBlitMips(ImageFormat format)
+		{
+			if (Image::IsCompressedFormat(format))
+				return false;
+
+			VkFormatProperties properties;
+			vkGetPhysicalDeviceFormatProperties(Application::GetPhysicalDevice(), UtopiaFormatToVulkanFormat(format), &properties);
+
+			const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+			return (properties.optimalTilingFeatures & required) == required;
+		}
+
+		static ImageMipmaps ResolveMipmaps(ImageFormat format, ImageMipmaps mipmaps)
+		{
+			// Compressed images come with their levels
+			if (Image::IsCompressedFormat(format))
+				return ImageMipmaps::None;
+
+			if (mipmaps == ImageMipmaps::GPU && !CanBlitMips(format))
+				return ImageMipmaps::CPU;
+
+			return mipmaps;
+		}
+
+		// Every level in GPU layout, tightly packed. Level 0 is converted where the format needs it.
+		static std::vector<uint8_t> BuildMipChain(const void* data, uint32_t width, uint32_t height, ImageFormat format, uint32_t mipLevels)
+		{
+			uint64_t chainSize = 0;
+			for (uint32_t level = 0; level < mipLevels; level++)
+				chainSize += GPULevelSize(format, MipLevelExtent(width, level), MipLevelExtent(height, level));
+
+			std::vector<uint8_t> chain(chainSize);
+
+			const size_t pixelCount = (size_t)width * height;
+			switch (format)
+			{
+			case ImageFormat::RGB8: ConvertRGB8ToRGBA8(data, chain.data(), pixelCount); break;
+			case ImageFormat::BGR8: ConvertBGR8ToRGBA8(data, chain.data(), pixelCount); break;
+			default:                memcpy(chain.data(), data, pixelCount * BytesPerPixel(format)); break;
+			}
+
+			const MipComponentType componentType = GetMipComponentType(format);
+			const uint32_t channels = GPUBytesPerPixel(format) / (componentType == MipComponentType::Float32 ? 4 : componentType == MipComponentType::Float16 ? 2 : 1);
+
+			uint8_t* src = chain.data();
+			for (uint32_t level = 1; level < mipLevels; level++)
+			{
+				const uint32_t srcWidth = MipLevelExtent(width, level - 1), srcHeight = MipLevelExtent(height, level - 1);
+				uint8_t* dst = src + GPULevelSize(format, srcWidth, srcHeight);
+				DownsampleMipLevel(src, srcWidth, srcHeight, dst, channels, componentType, 0, MipLevelExtent(height, level));
+				src = dst;
+			}
+
+			return chain;
+		}
+
+		static void InsertImageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageLayout oldLayout, VkImageLayout newLayout,
+			VkAccessFlags srcAccess, VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage,
+			uint32_t baseMipLevel, uint32_t levelCount)
+		{
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = srcAccess;
+			barrier.dstAccessMask = dstAccess;
+			barrier.oldLayout = oldLayout;
+			barrier.newLayout = newLayout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = image;
+			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			barrier.subresourceRange.baseMipLevel = baseMipLevel;
+			barrier.subresourceRange.levelCount = levelCount;
+			barrier.subresourceRange.layerCount = 1;
+			vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, NULL, 0, NULL, 1, &barrier);
+		}
+
+		// Reads and parses a .dds/.ktx2 file, hashing its contents on the way
+		static const char* LoadCompressedImageFile(const std::string& path, CompressedImageData& outImage, uint64_t* outContentHash = nullptr)
+		{
+			std::vector<uint8_t> data;
+			if (!ReadFile(path, data))
+				return "failed to read file";
+
+			if (outContentHash)
+				*outContentHash = Hash::FNV1a(data.data(), data.size());
+
+			return ParseCompressedImage(data.data(), data.size(), outImage);
+		}
+
 	}
 
-	Image::Image(std::string_view path)
+	// Images with SetSubData() rectangles waiting for the upload batch. Main thread only.
+	static std::vector<Image*> s_ImagesWithPendingRegions;
+
+	Image::Image(std::string_view path, ImageMipmaps mipmaps)
 		: m_Filepath(path)
 	{
+		if (IsCompressedImageFile(m_Filepath))
+		{
+			CompressedImageData compressed;
+			if (const char* error = Utils::LoadCompressedImageFile(m_Filepath, compressed))
+			{
+				UT_CORE_ERROR_TAG("Image", "Failed to load image '{}': {}", m_Filepath, error);
+				return;
+			}
+
+			InitCompressed(compressed);
+			SetData(compressed.Data.data());
+			return;
+		}
+
 		int width, height, channels;
 		uint8_t* data = nullptr;
 
-		if (stbi_is_hdr(m_Filepath.c_str()))
+		const ImageDecodeCache& decodeCache = Application::Get().GetImageDecodeCache();
+		ImageDecodeCache::CachedImage cached;
+		if (decodeCache.Lookup(m_Filepath, cached))
 		{
-			data = (uint8_t*)stbi_loadf(m_Filepath.c_str(), &width, &height, &channels, 4);
-			m_Format = ImageFormat::RGBA32F;
+			width = (int)cached.Width;
+			height = (int)cached.Height;
+			m_Format = cached.Format;
 		}
 		else
 		{
-			data = stbi_load(m_Filepath.c_str(), &width, &height, &channels, 4);
-			m_Format = ImageFormat::RGBA;
+			// Read once, the same bytes are decoded and hashed
+			std::vector<uint8_t> file;
+			if (Utils::ReadFile(m_Filepath, file))
+			{
+				if (stbi_is_hdr_from_memory(file.data(), (int)file.size()))
+				{
+					data = (uint8_t*)stbi_loadf_from_memory(file.data(), (int)file.size(), &width, &height, &channels, 4);
+					m_Format = ImageFormat::RGBA32F;
+				}
+				else
+				{
+					data = stbi_load_from_memory(file.data(), (int)file.size(), &width, &height, &channels, 4);
+					m_Format = ImageFormat::RGBA;
+				}
+			}
+
+			if (!data)
+			{
+				UT_CORE_ERROR_TAG("Image", "Failed to load image '{}': {}", m_Filepath, file.empty() ? "failed to read file" : stbi_failure_reason());
+				return;
+			}
+
+			// Compressed and written on the thread pool
+			if (decodeCache.IsEnabled())
+				decodeCache.StoreAsync(m_Filepath, m_Format, width, height, data, Hash::FNV1a(file.data(), file.size()));
 		}
 
 		m_Width = width;
 		m_Height = height;
+		m_Mipmaps = Utils::ResolveMipmaps(m_Format, mipmaps);
+		m_MipLevels = m_Mipmaps != ImageMipmaps::None ? Utils::CalculateMipLevelCount(m_Width, m_Height) : 1;
 
-		AllocateMemory(m_Width * m_Height * Utils::BytesPerPixel(m_Format));
-		SetData(data);
+		AllocateMemory(m_Width * m_Height * Utils::GPUBytesPerPixel(m_Format));
+		SetData(data ? data : cached.Pixels);
 		stbi_image_free(data);
 	}
 
-	Image::Image(uint32_t width, uint32_t height, ImageFormat format, const void* data)
-		: m_Width(width), m_Height(height), m_Format(format)
+	Image::Image(uint32_t width, uint32_t height, ImageFormat format, const void* data, ImageMipmaps mipmaps)
+		: m_Width(width), m_Height(height), m_Format(format), m_Mipmaps(Utils::ResolveMipmaps(format, mipmaps))
 	{
-		AllocateMemory(m_Width * m_Height * Utils::BytesPerPixel(m_Format));
+		m_MipLevels = m_Mipmaps != ImageMipmaps::None ? Utils::CalculateMipLevelCount(m_Width, m_Height) : 1;
+
+		AllocateMemory(m_Width * m_Height * Utils::GPUBytesPerPixel(m_Format));
 		if (data)
 			SetData(data);
 	}
 
+	Image::Image(const CompressedImageData& compressed)
+	{
+		InitCompressed(compressed);
+		SetData(compressed.Data.data());
+	}
+
+	void Image::InitCompressed(const CompressedImageData& compressed)
+	{
+		m_Width = compressed.Width;
+		m_Height = compressed.Height;
+		m_Format = compressed.Format;
+		m_MipLevels = compressed.MipLevels;
+
+		AllocateMemory(compressed.Data.size());
+	}
+
 	Image::~Image()
 	{
 		Release();
@@ -102,24 +352,26 @@ namespace Utopia {
 			info.extent.width = m_Width;
 			info.extent.height = m_Height;
 			info.extent.depth = 1;
-			info.mipLevels = 1;
+			info.mipLevels = m_MipLevels;
 			info.arrayLayers = 1;
 			info.samples = VK_SAMPLE_COUNT_1_BIT;
 			info.tiling = VK_IMAGE_TILING_OPTIMAL;
 			info.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+			// Blits also keep the chain current after SetSubData() in CPU mode
+			m_CanBlitMips = m_MipLevels > 1 && Utils::CanBlitMips(m_Format);
+			if (m_CanBlitMips)
+				info.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+			if (m_RenderTarget)
+				info.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 			info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 			info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 			err = vkCreateImage(device, &info, nullptr, &m_Image);
 			check_vk_result(err);
 			VkMemoryRequirements req;
 			vkGetImageMemoryRequirements(device, m_Image, &req);
-			VkMemoryAllocateInfo alloc_info = {};
-			alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-			alloc_info.allocationSize = req.size;
-			alloc_info.memoryTypeIndex = Utils::GetVulkanMemoryType(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, req.memoryTypeBits);
-			err = vkAllocateMemory(device, &alloc_info, nullptr, &m_Memory);
-			check_vk_result(err);
-			err = vkBindImageMemory(device, m_Image, m_Memory, 0);
+			m_Allocation = Application::GetMemoryAllocator().Allocate(req, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryAllocator::Tiling::Optimal);
+			IM_ASSERT(m_Allocation && "Out of device memory");
+			err = vkBindImageMemory(device, m_Image, m_Allocation->Memory, m_Allocation->Offset);
 			check_vk_result(err);
 		}
 
@@ -130,8 +382,9 @@ namespace Utopia {
 			info.image = m_Image;
 			info.viewType = VK_IMAGE_VIEW_TYPE_2D;
 			info.format = vulkanFormat;
+			info.components = Utils::UtopiaFormatToComponentMapping(m_Format);
 			info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			info.subresourceRange.levelCount = 1;
+			info.subresourceRange.levelCount = m_MipLevels;
 			info.subresourceRange.layerCount = 1;
 			err = vkCreateImageView(device, &info, nullptr, &m_ImageView);
 			check_vk_result(err);
@@ -160,118 +413,316 @@ namespace Utopia {
 
 	void Image::Release()
 	{
-		Application::SubmitResourceFree([sampler = m_Sampler, imageView = m_ImageView, image = m_Image,
-			memory = m_Memory, stagingBuffer = m_StagingBuffer, stagingBufferMemory = m_StagingBufferMemory]()
-			{
-				VkDevice device = Application::GetDevice();
+		DiscardPendingRegions();
 
-				vkDestroySampler(device, sampler, nullptr);
-				vkDestroyImageView(device, imageView, nullptr);
-				vkDestroyImage(device, image, nullptr);
-				vkFreeMemory(device, memory, nullptr);
-				vkDestroyBuffer(device, stagingBuffer, nullptr);
-				vkFreeMemory(device, stagingBufferMemory, nullptr);
-			});
+		Application::GetDeletionQueue().Release(
+			DeletionQueue::DescriptorSetHandle(m_DescriptorSet),
+			DeletionQueue::SamplerHandle(m_Sampler),
+			DeletionQueue::ImageViewHandle(m_ImageView),
+			DeletionQueue::ImageHandle(m_Image),
+			DeletionQueue::AllocationHandle(m_Allocation));
 
+		m_DescriptorSet = nullptr;
 		m_Sampler = nullptr;
 		m_ImageView = nullptr;
 		m_Image = nullptr;
-		m_Memory = nullptr;
-		m_StagingBuffer = nullptr;
-		m_StagingBufferMemory = nullptr;
+		m_Allocation = nullptr;
 	}
 
 	void Image::SetData(const void* data)
 	{
-		VkDevice device = Application::GetDevice();
+		StagingRing::Allocation staging = WriteStagingBuffer(data);
 
-		size_t upload_size = m_Width * m_Height * Utils::BytesPerPixel(m_Format);
+		VkCommandBuffer command_buffer = Application::GetCommandBuffer(true);
+		RecordCopy(command_buffer, staging);
+		Application::FlushCommandBuffer(command_buffer);
 
-		VkResult err;
+		m_UploadTicket = 0;
+		m_InitialUploadTicket = 0;
+		m_HasData = true;
+	}
+
+	void Image::SetDataAsync(const void* data)
+	{
+		// Recorded ahead of this copy they would be overwritten anyway, recorded after it
+		// they would clobber the new contents
+		DiscardPendingRegions();
+
+		UploadAsync(WriteStagingBuffer(data));
+	}
+
+	void Image::UploadAsync(const StagingRing::Allocation& staging)
+	{
+		UploadContext& uploadContext = Application::GetUploadContext();
+		RecordCopy(uploadContext.BeginBatch(), staging);
 
-		if (!m_StagingBuffer)
+		m_UploadTicket = uploadContext.GetBatchTicket();
+		if (!m_HasData)
+			m_InitialUploadTicket = m_UploadTicket;
+		m_HasData = true;
+	}
+
+	void Image::SetSubData(uint32_t x, uint32_t y, uint32_t width, uint32_t height, const void* data, uint32_t rowPitch)
+	{
+		IM_ASSERT(!IsCompressedFormat(m_Format) && "SetSubData() is not supported for compressed formats");
+		IM_ASSERT(x + width <= m_Width && y + height <= m_Height && "Sub-image out of bounds");
+		if (width == 0 || height == 0)
+			return;
+
+		const uint32_t bytesPerPixel = Utils::BytesPerPixel(m_Format);
+		const uint32_t gpuBytesPerPixel = Utils::GPUBytesPerPixel(m_Format);
+		const size_t rowSize = (size_t)width * bytesPerPixel;
+		if (rowPitch == 0)
+			rowPitch = (uint32_t)rowSize;
+		IM_ASSERT(rowPitch >= rowSize);
+
+		// Regions of one copy command execute in no defined order, so an overlapping update
+		// has to go into a copy of its own after the earlier ones
+		for (const PendingRegion& pending : m_PendingRegions)
 		{
-			// Create the Upload Buffer
+			const VkOffset3D& offset = pending.Region.imageOffset;
+			const VkExtent3D& extent = pending.Region.imageExtent;
+			if (x < (uint32_t)offset.x + extent.width && (uint32_t)offset.x < x + width &&
+				y < (uint32_t)offset.y + extent.height && (uint32_t)offset.y < y + height)
 			{
-				VkBufferCreateInfo buffer_info = {};
-				buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-				buffer_info.size = upload_size;
-				buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-				buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-				err = vkCreateBuffer(device, &buffer_info, nullptr, &m_StagingBuffer);
-				check_vk_result(err);
-				VkMemoryRequirements req;
-				vkGetBufferMemoryRequirements(device, m_StagingBuffer, &req);
-				m_AlignedSize = req.size;
-				VkMemoryAllocateInfo alloc_info = {};
-				alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-				alloc_info.allocationSize = req.size;
-				alloc_info.memoryTypeIndex = Utils::GetVulkanMemoryType(VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, req.memoryTypeBits);
-				err = vkAllocateMemory(device, &alloc_info, nullptr, &m_StagingBufferMemory);
-				check_vk_result(err);
-				err = vkBindBufferMemory(device, m_StagingBuffer, m_StagingBufferMemory, 0);
-				check_vk_result(err);
+				RecordPendingRegions(Application::GetUploadContext().BeginBatch());
+				break;
 			}
+		}
+
+		StagingRing& stagingRing = Application::GetStagingRing();
+		const uint8_t* src = static_cast<const uint8_t*>(data);
 
+		PendingRegion pending;
+		pending.Region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		pending.Region.imageSubresource.layerCount = 1;
+		pending.Region.imageOffset = { (int32_t)x, (int32_t)y, 0 };
+		pending.Region.imageExtent = { width, height, 1 };
+
+		StagingRing::Allocation staging;
+		if (bytesPerPixel == gpuBytesPerPixel && rowPitch % bytesPerPixel == 0 && rowPitch - rowSize <= rowSize)
+		{
+			// Rows keep their stride in staging memory and the copy skips the gaps through
+			// bufferRowLength: one memcpy, no repacking
+			const size_t stagingSize = (size_t)(height - 1) * rowPitch + rowSize;
+			staging = stagingRing.Allocate(stagingSize, 16);
+			memcpy(staging.Data, src, stagingSize);
+			pending.Region.bufferRowLength = rowPitch / bytesPerPixel;
+		}
+		else
+		{
+			// Sparse rows (a narrow rectangle of a wide image) or formats that are converted
+			// anyway: pack row by row
+			const size_t stagingRowSize = (size_t)width * gpuBytesPerPixel;
+			staging = stagingRing.Allocate(stagingRowSize * height, 16);
+
+			uint8_t* dst = static_cast<uint8_t*>(staging.Data);
+			for (uint32_t row = 0; row < height; row++, src += rowPitch, dst += stagingRowSize)
+			{
+				switch (m_Format)
+				{
+				case ImageFormat::RGB8: Utils::ConvertRGB8ToRGBA8(src, dst, width); break;
+				case ImageFormat::BGR8: Utils::ConvertBGR8ToRGBA8(src, dst, width); break;
+				default:                memcpy(dst, src, rowSize); break;
+				}
+			}
 		}
+		stagingRing.Flush(staging);
+
+		pending.Buffer = staging.Buffer;
+		pending.Region.bufferOffset = staging.Offset;
+
+		if (std::find(s_ImagesWithPendingRegions.begin(), s_ImagesWithPendingRegions.end(), this) == s_ImagesWithPendingRegions.end())
+			s_ImagesWithPendingRegions.push_back(this);
+		m_PendingRegions.push_back(pending);
+
+		// Opening the batch here fixes its ticket; the copy itself is recorded on submission
+		UploadContext& uploadContext = Application::GetUploadContext();
+		uploadContext.BeginBatch();
+		m_UploadTicket = uploadContext.GetBatchTicket();
+		if (!m_HasData && !m_InitialUploadTicket)
+			m_InitialUploadTicket = m_UploadTicket;
+	}
+
+	void Image::RecordPendingUploads(VkCommandBuffer commandBuffer)
+	{
+		for (Image* image : s_ImagesWithPendingRegions)
+			image->RecordPendingRegions(commandBuffer);
+		s_ImagesWithPendingRegions.clear();
+	}
 
-		// Upload to Buffer
+	void Image::RecordPendingRegions(VkCommandBuffer command_buffer)
+	{
+		if (m_PendingRegions.empty())
+			return;
+
+		// Partial updates keep the rest of the image, so the contents must survive the transition
+		const VkImageLayout oldLayout = m_HasData ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED;
+		Utils::InsertImageBarrier(command_buffer, m_Image, oldLayout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, m_MipLevels);
+
+		// One copy per staging buffer; everything but oversized rectangles shares the ring buffer
+		std::vector<VkBufferImageCopy> regions;
+		regions.reserve(m_PendingRegions.size());
+		for (size_t first = 0; first < m_PendingRegions.size();)
 		{
-			char* map = NULL;
-			err = vkMapMemory(device, m_StagingBufferMemory, 0, m_AlignedSize, 0, (void**)(&map));
-			check_vk_result(err);
-			memcpy(map, data, upload_size);
-			VkMappedMemoryRange range[1] = {};
-			range[0].sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-			range[0].memory = m_StagingBufferMemory;
-			range[0].size = m_AlignedSize;
-			err = vkFlushMappedMemoryRanges(device, 1, range);
-			check_vk_result(err);
-			vkUnmapMemory(device, m_StagingBufferMemory);
+			const VkBuffer buffer = m_PendingRegions[first].Buffer;
+			regions.clear();
+
+			size_t i = first;
+			for (; i < m_PendingRegions.size() && m_PendingRegions[i].Buffer == buffer; i++)
+				regions.push_back(m_PendingRegions[i].Region);
+
+			vkCmdCopyBufferToImage(command_buffer, buffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)regions.size(), regions.data());
+			first = i;
 		}
 
+		RecordFinishUpload(command_buffer, m_CanBlitMips);
+
+		m_PendingRegions.clear();
+		m_HasData = true;
+	}
+
+	void Image::DiscardPendingRegions()
+	{
+		// Can still be registered with nothing pending after an early flush
+		m_PendingRegions.clear();
+		std::erase(s_ImagesWithPendingRegions, this);
+	}
+
+	bool Image::IsUploadComplete() const
+	{
+		return m_UploadTicket == 0 || Application::GetUploadContext().IsComplete(m_UploadTicket);
+	}
 
-		// Copy to Image
+	VkDescriptorSet Image::GetDescriptorSet() const
+	{
+		if (m_InitialUploadTicket)
 		{
-			VkCommandBuffer command_buffer = Application::GetCommandBuffer(true);
+			if (!Application::GetUploadContext().IsComplete(m_InitialUploadTicket))
+				return Application::Get().GetPlaceholderImage()->GetDescriptorSet();
+
+			m_InitialUploadTicket = 0;
+		}
+
+		return m_DescriptorSet;
+	}
 
-			VkImageMemoryBarrier copy_barrier = {};
-			copy_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-			copy_barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			copy_barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-			copy_barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-			copy_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-			copy_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-			copy_barrier.image = m_Image;
-			copy_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			copy_barrier.subresourceRange.levelCount = 1;
-			copy_barrier.subresourceRange.layerCount = 1;
-			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_HOST_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &copy_barrier);
+	StagingRing::Allocation Image::WriteStagingBuffer(const void* data, bool levelsIncluded)
+	{
+		// Shared, persistently mapped staging memory; reclaimed once the frame has retired
+		StagingRing& stagingRing = Application::GetStagingRing();
 
-			VkBufferImageCopy region = {};
+		const bool copyLevels = IsCompressedFormat(m_Format) || m_Mipmaps == ImageMipmaps::CPU;
+		if (copyLevels)
+		{
+			// Built on the calling thread: fanning the rows out to the shared pool would leave a
+			// synchronous upload waiting behind whatever else is queued there. LoadAsync() builds
+			// the chain on a worker instead.
+			std::vector<uint8_t> chain;
+			if (!levelsIncluded && m_Mipmaps == ImageMipmaps::CPU)
+			{
+				chain = Utils::BuildMipChain(data, m_Width, m_Height, m_Format, m_MipLevels);
+				data = chain.data();
+			}
+
+			uint64_t upload_size = 0;
+			for (uint32_t level = 0; level < m_MipLevels; level++)
+				upload_size += Utils::GPULevelSize(m_Format, Utils::MipLevelExtent(m_Width, level), Utils::MipLevelExtent(m_Height, level));
+
+			StagingRing::Allocation staging = stagingRing.Allocate(upload_size, 16);
+			memcpy(staging.Data, data, upload_size);
+			stagingRing.Flush(staging);
+			return staging;
+		}
+
+		const size_t pixelCount = (size_t)m_Width * m_Height;
+		size_t upload_size = pixelCount * Utils::GPUBytesPerPixel(m_Format);
+		StagingRing::Allocation staging = stagingRing.Allocate(upload_size, 16);
+
+		// Conversions write straight into the staging memory, no intermediate copy
+		switch (m_Format)
+		{
+		case ImageFormat::RGB8: Utils::ConvertRGB8ToRGBA8(data, staging.Data, pixelCount); break;
+		case ImageFormat::BGR8: Utils::ConvertBGR8ToRGBA8(data, staging.Data, pixelCount); break;
+		default:                memcpy(staging.Data, data, upload_size); break;
+		}
+		stagingRing.Flush(staging);
+
+		return staging;
+	}
+
+	void Image::RecordCopy(VkCommandBuffer command_buffer, const StagingRing::Allocation& staging)
+	{
+		// Every level is overwritten, but a refill must not start while an earlier frame still samples the image
+		const VkPipelineStageFlags srcStage = m_HasData ? VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_HOST_BIT;
+		Utils::InsertImageBarrier(command_buffer, m_Image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			0, VK_ACCESS_TRANSFER_WRITE_BIT, srcStage, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, m_MipLevels);
+
+		// Staged levels follow each other tightly packed; without them level 0 is all there is
+		const bool copyLevels = IsCompressedFormat(m_Format) || m_Mipmaps == ImageMipmaps::CPU;
+		const uint32_t levelCount = copyLevels ? m_MipLevels : 1;
+
+		VkBufferImageCopy regions[32] = {};
+		VkDeviceSize offset = staging.Offset;
+		for (uint32_t level = 0; level < levelCount; level++)
+		{
+			const uint32_t width = Utils::MipLevelExtent(m_Width, level);
+			const uint32_t height = Utils::MipLevelExtent(m_Height, level);
+
+			VkBufferImageCopy& region = regions[level];
+			region.bufferOffset = offset;
 			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.mipLevel = level;
 			region.imageSubresource.layerCount = 1;
-			region.imageExtent.width = m_Width;
-			region.imageExtent.height = m_Height;
+			region.imageExtent.width = width;
+			region.imageExtent.height = height;
 			region.imageExtent.depth = 1;
-			vkCmdCopyBufferToImage(command_buffer, m_StagingBuffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-			VkImageMemoryBarrier use_barrier = {};
-			use_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-			use_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-			use_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-			use_barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-			use_barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-			use_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-			use_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-			use_barrier.image = m_Image;
-			use_barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			use_barrier.subresourceRange.levelCount = 1;
-			use_barrier.subresourceRange.layerCount = 1;
-			vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, NULL, 0, NULL, 1, &use_barrier);
-
-			Application::FlushCommandBuffer(command_buffer);
+
+			offset += Utils::GPULevelSize(m_Format, width, height);
+		}
+		vkCmdCopyBufferToImage(command_buffer, staging.Buffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levelCount, regions);
+
+		RecordFinishUpload(command_buffer, m_Mipmaps == ImageMipmaps::GPU);
+	}
+
+	void Image::RecordFinishUpload(VkCommandBuffer command_buffer, bool generateMips)
+	{
+		uint32_t level = 0;
+		if (generateMips)
+		{
+			// Each level is blitted from the one above, which is then done and can be sampled
+			for (level = 1; level < m_MipLevels; level++)
+			{
+				Utils::InsertImageBarrier(command_buffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, level - 1, 1);
+
+				VkImageBlit blit = {};
+				blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				blit.srcSubresource.mipLevel = level - 1;
+				blit.srcSubresource.layerCount = 1;
+				blit.srcOffsets[1] = { (int32_t)Utils::MipLevelExtent(m_Width, level - 1), (int32_t)Utils::MipLevelExtent(m_Height, level - 1), 1 };
+				blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+				blit.dstSubresource.mipLevel = level;
+				blit.dstSubresource.layerCount = 1;
+				blit.dstOffsets[1] = { (int32_t)Utils::MipLevelExtent(m_Width, level), (int32_t)Utils::MipLevelExtent(m_Height, level), 1 };
+				vkCmdBlitImage(command_buffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+				Utils::InsertImageBarrier(command_buffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+					VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, level - 1, 1);
+			}
+			level--;
 		}
+
+		// Whatever is left still sits in TRANSFER_DST
+		Utils::InsertImageBarrier(command_buffer, m_Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, level, m_MipLevels - level);
+	}
+
+	uint64_t Image::GetMemorySize() const
+	{
+		return m_Allocation ? m_Allocation->Size : 0;
 	}
 
 	void Image::Resize(uint32_t width, uint32_t height)
@@ -284,8 +735,34 @@ namespace Utopia {
 		m_Width = width;
 		m_Height = height;
 
+		// Compressed images keep the level count they were loaded with, as far as the new size allows
+		if (IsCompressedFormat(m_Format))
+			m_MipLevels = std::min(m_MipLevels, Utils::CalculateMipLevelCount(m_Width, m_Height));
+		else
+			m_MipLevels = m_Mipmaps != ImageMipmaps::None ? Utils::CalculateMipLevelCount(m_Width, m_Height) : 1;
+
+		uint64_t size = 0;
+		for (uint32_t level = 0; level < m_MipLevels; level++)
+			size += Utils::GPULevelSize(m_Format, Utils::MipLevelExtent(m_Width, level), Utils::MipLevelExtent(m_Height, level));
+
 		Release();
-		AllocateMemory(m_Width * m_Height * Utils::BytesPerPixel(m_Format));
+		AllocateMemory(size);
+
+		// Contents are undefined until the next SetData()/SetDataAsync()
+		m_UploadTicket = 0;
+		m_InitialUploadTicket = 0;
+		m_HasData = false;
+	}
+
+	std::shared_ptr<Image> Image::CreateRenderTarget(uint32_t width, uint32_t height)
+	{
+		std::shared_ptr<Image> image(new Image());
+		image->m_Width = width;
+		image->m_Height = height;
+		image->m_Format = ImageFormat::RGBA;
+		image->m_RenderTarget = true;
+		image->AllocateMemory((uint64_t)width * height * 4);
+		return image;
 	}
 
 	void* Image::Decode(const void* buffer, uint64_t length, uint32_t& outWidth, uint32_t& outHeight)
@@ -303,4 +780,173 @@ namespace Utopia {
 		return data;
 	}
 
+	bool Image::IsCompressedFormat(ImageFormat format)
+	{
+		return format == ImageFormat::BC1 || format == ImageFormat::BC3 || format == ImageFormat::BC7;
+	}
+
+	bool Image::IsFormatSupported(ImageFormat format)
+	{
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(Application::GetPhysicalDevice(), Utils::UtopiaFormatToVulkanFormat(format), &properties);
+		return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+	}
+
+	uint64_t Image::GetLevelSize(ImageFormat format, uint32_t width, uint32_t height)
+	{
+		// 4x4 blocks, partial blocks at the edges still take a whole one
+		const uint64_t blocks = (uint64_t)((width + 3) / 4) * ((height + 3) / 4);
+		switch (format)
+		{
+		case ImageFormat::BC1: return blocks * 8;
+		case ImageFormat::BC3: return blocks * 16;
+		case ImageFormat::BC7: return blocks * 16;
+		}
+		return (uint64_t)width * height * Utils::BytesPerPixel(format);
+	}
+
+	// In-flight async loads by path and mipmap mode, for coalescing duplicate requests
+	static std::mutex s_PendingLoadsMutex;
+	static std::unordered_map<std::string, std::weak_ptr<ImageLoad>> s_PendingLoads;
+
+	static std::string PendingLoadKey(std::string_view path, ImageMipmaps mipmaps)
+	{
+		std::string key(path);
+		key += '|';
+		key += (char)('0' + (int)mipmaps);
+		return key;
+	}
+
+	Task<> Image::LoadAsyncTask(std::shared_ptr<ImageLoad> load, ImageMipmaps mipmaps)
+	{
+		co_await Application::Get().GetThreadPool().Schedule();
+
+		load->m_Status.store(ImageLoad::Status::Decoding, std::memory_order_release);
+
+		int width = 0, height = 0, channels;
+		void* data = nullptr;
+		ImageFormat format = ImageFormat::RGBA;
+		const char* error = "file not found";
+
+		CompressedImageData compressed;
+		std::vector<uint8_t> mipChain;
+
+		const ImageDecodeCache& decodeCache = Application::Get().GetImageDecodeCache();
+		ImageDecodeCache::CachedImage cached;
+		std::error_code sizeError;
+
+		if (IsCompressedImageFile(load->GetPath()))
+		{
+			// Nothing to decode, the file is uploaded as is
+			error = Utils::LoadCompressedImageFile(load->GetPath(), compressed, &load->m_ContentHash);
+			if (!error)
+			{
+				data = compressed.Data.data();
+				load->m_ContentSize = std::filesystem::file_size(load->GetPath(), sizeError);
+			}
+		}
+		else if (decodeCache.Lookup(load->GetPath(), cached))
+		{
+			// Decoded on an earlier run
+			data = const_cast<void*>(cached.Pixels);
+			width = (int)cached.Width;
+			height = (int)cached.Height;
+			format = cached.Format;
+			load->m_ContentHash = cached.ContentHash;
+			load->m_ContentSize = std::filesystem::file_size(load->GetPath(), sizeError);
+		}
+		else if (FILE* file = fopen(load->GetPath().c_str(), "rb"))
+		{
+			fseek(file, 0, SEEK_END);
+			Utils::ProgressReader reader = { file, ftell(file), 0, load->m_Progress };
+			fseek(file, 0, SEEK_SET);
+
+			const stbi_io_callbacks callbacks = { Utils::ProgressRead, Utils::ProgressSkip, Utils::ProgressEof };
+			if (stbi_is_hdr_from_file(file))
+			{
+				data = stbi_loadf_from_callbacks(&callbacks, &reader, &width, &height, &channels, 4);
+				format = ImageFormat::RGBA32F;
+			}
+			else
+			{
+				data = stbi_load_from_callbacks(&callbacks, &reader, &width, &height, &channels, 4);
+			}
+
+			// The decoder may stop before the end of the file; the hash covers all of it
+			char buffer[4096];
+			while (Utils::ProgressRead(&reader, buffer, sizeof(buffer)) > 0) {}
+			load->m_ContentHash = reader.ContentHash;
+			load->m_ContentSize = (uint64_t)reader.Read;
+
+			fclose(file);
+
+			// stb_image keeps the failure reason per thread
+			error = stbi_failure_reason();
+
+			if (data)
+				decodeCache.Store(load->GetPath(), format, width, height, data, load->m_ContentHash);
+		}
+
+		if (data && compressed.Format == ImageFormat::None && Utils::ResolveMipmaps(format, mipmaps) == ImageMipmaps::CPU)
+			mipChain = Utils::BuildMipChain(data, width, height, format, Utils::CalculateMipLevelCount(width, height));
+
+		co_await Application::SwitchToMainThread();
+
+		{
+			std::scoped_lock<std::mutex> lock(s_PendingLoadsMutex);
+			s_PendingLoads.erase(PendingLoadKey(load->GetPath(), mipmaps));
+		}
+
+		if (!data)
+		{
+			UT_CORE_ERROR_TAG("Image", "Failed to load image '{}': {}", load->GetPath(), error ? error : "unknown error");
+			load->m_Status.store(ImageLoad::Status::Failed, std::memory_order_release);
+			co_return;
+		}
+
+		std::shared_ptr<Image> image;
+		if (compressed.Format != ImageFormat::None)
+		{
+			image = std::shared_ptr<Image>(new Image());
+			image->InitCompressed(compressed);
+			image->UploadAsync(image->WriteStagingBuffer(compressed.Data.data()));
+		}
+		else
+		{
+			image = std::make_shared<Image>(width, height, format, nullptr, mipmaps);
+			if (!mipChain.empty())
+				image->UploadAsync(image->WriteStagingBuffer(mipChain.data(), true));
+			else
+				image->SetDataAsync(data);
+
+			if (data != cached.Pixels)
+				stbi_image_free(data);
+		}
+
+		load->m_Image = std::move(image);
+		load->m_Progress.store(1.0f, std::memory_order_relaxed);
+		load->m_Status.store(ImageLoad::Status::Ready, std::memory_order_release);
+	}
+
+	std::shared_ptr<ImageLoad> Image::LoadAsync(std::string_view path, ImageMipmaps mipmaps)
+	{
+		std::shared_ptr<ImageLoad> load;
+		{
+			std::scoped_lock<std::mutex> lock(s_PendingLoadsMutex);
+
+			std::weak_ptr<ImageLoad>& pending = s_PendingLoads[PendingLoadKey(path, mipmaps)];
+			load = pending.lock();
+			if (load)
+				return load;
+
+			load = std::make_shared<ImageLoad>();
+			load->m_Path = path;
+			pending = load;
+		}
+
+		// Detached, the coroutine owns a reference to the handle until it is done
+		LoadAsyncTask(load, mipmaps);
+		return load;
+	}
+
 }
@@ -1,54 +1,199 @@
 #pragma once
 
 #include <string>
+#include <memory>
+#include <atomic>
+#include <vector>
 
 #include "vulkan/vulkan.h"
 
+#include "Utopia/Vulkan/StagingRing.hpp"
+#include "Utopia/Core/Task.hpp"
+
 namespace Utopia {
 
+	// Layout of the data passed to SetData(). RGB8/BGR8 are expanded to RGBA on upload, everything
+	// else is uploaded as is. R8 is sampled as grayscale. For the block compressed formats the
+	// data holds every mip level, largest first.
 	enum class ImageFormat
 	{
 		None = 0,
 		RGBA,
-		RGBA32F
+		RGBA32F,
+		R8,
+		RG8,
+		RGB8,
+		BGR8,
+		BGRA8,
+		RGBA16F,
+		BC1,
+		BC3,
+		BC7
+	};
+
+	// How the mip chain of an uncompressed image is built on upload
+	enum class ImageMipmaps : uint8_t
+	{
+		None = 0,
+		// vkCmdBlitImage chain recorded after the copy. Formats the device can't blit with
+		// linear filtering fall back to CPU.
+		GPU,
+		// Box filtered before upload, on the thread that provides the pixels: the calling thread for
+		// the constructors and SetData(), the decoding worker for LoadAsync()
+		CPU
+	};
+
+	class Image;
+	struct CompressedImageData;
+
+	// Handle returned by Image::LoadAsync(). Status and progress can be polled from any thread,
+	// GetImage() from the main thread.
+	class ImageLoad
+	{
+	public:
+		enum class Status : uint8_t
+		{
+			Queued = 0,
+			Decoding,
+			Ready,
+			Failed
+		};
+
+	public:
+		const std::string& GetPath() const { return m_Path; }
+
+		Status GetStatus() const { return m_Status.load(std::memory_order_acquire); }
+		bool IsReady() const { return GetStatus() == Status::Ready; }
+		bool HasFailed() const { return GetStatus() == Status::Failed; }
+		// 0..1, bytes of the file consumed by the decoder, 1 once ready
+		float GetProgress() const { return m_Progress.load(std::memory_order_relaxed); }
+
+		// nullptr until ready. Draws a placeholder until the GPU upload has executed.
+		std::shared_ptr<Image> GetImage() const { return m_Image; }
+		// FNV-1a and size in bytes of the file contents, valid once ready
+		uint64_t GetContentHash() const { return m_ContentHash; }
+		uint64_t GetContentSize() const { return m_ContentSize; }
+
+	private:
+		std::string m_Path;
+		std::atomic<Status> m_Status = Status::Queued;
+		std::atomic<float> m_Progress = 0.0f;
+		std::shared_ptr<Image> m_Image;
+		uint64_t m_ContentHash = 0;
+		uint64_t m_ContentSize = 0;
+
+		friend class Image;
 	};
 
 	class Image
 	{
 	public:
-		Image(std::string_view path);
-		Image(uint32_t width, uint32_t height, ImageFormat format, const void* data = nullptr);
+		// .dds/.ktx2 files are loaded as block compressed images with the mip levels they contain
+		Image(std::string_view path, ImageMipmaps mipmaps = ImageMipmaps::None);
+		Image(uint32_t width, uint32_t height, ImageFormat format, const void* data = nullptr, ImageMipmaps mipmaps = ImageMipmaps::None);
+		explicit Image(const CompressedImageData& compressed);
 		~Image();
 
 		void SetData(const void* data);
 
-		VkDescriptorSet GetDescriptorSet() const { return m_DescriptorSet; }
+		// Records the upload into the shared upload batch instead of blocking on it. The batch is
+		// submitted ahead of the frame, so the image can be drawn as soon as this returns. Until the
+		// first upload into a fresh image has executed, GetDescriptorSet() returns a placeholder.
+		void SetDataAsync(const void* data);
+		bool IsUploadComplete() const;
+
+		// Uploads only the given rectangle. data points at its first pixel and rowPitch is the
+		// distance between its rows in bytes (0 = tightly packed), so a dirty region can be passed
+		// straight out of a larger CPU-side buffer. The pixels are staged right away, but the copy
+		// is recorded when the upload batch is submitted: every rectangle updated until then goes
+		// into a single vkCmdCopyBufferToImage. Lower mip levels are regenerated by blit where the
+		// format allows it and left as they are otherwise. Not available for compressed formats.
+		void SetSubData(uint32_t x, uint32_t y, uint32_t width, uint32_t height, const void* data, uint32_t rowPitch = 0);
+
+		VkDescriptorSet GetDescriptorSet() const;
 
 		void Resize(uint32_t width, uint32_t height);
 
 		uint32_t GetWidth() const { return m_Width; }
 		uint32_t GetHeight() const { return m_Height; }
+		ImageFormat GetFormat() const { return m_Format; }
+		uint32_t GetMipLevelCount() const { return m_MipLevels; }
+		// Device memory backing the image
+		uint64_t GetMemorySize() const;
 
 		static void* Decode(const void* data, uint64_t length, uint32_t& outWidth, uint32_t& outHeight);
+
+		// Decodes (and builds CPU mipmaps) on the application thread pool and uploads without
+		// blocking. Requests for a path that is already loading share the same handle.
+		static std::shared_ptr<ImageLoad> LoadAsync(std::string_view path, ImageMipmaps mipmaps = ImageMipmaps::None);
+
+		static bool IsCompressedFormat(ImageFormat format);
+		// Whether the device can sample the format
+		static bool IsFormatSupported(ImageFormat format);
+		// Bytes of one level of the given size in the data passed to SetData()
+		static uint64_t GetLevelSize(ImageFormat format, uint32_t width, uint32_t height);
+
+		// Records the copies of all pending SetSubData() rectangles. Runs as the upload context
+		// batch submit callback.
+		static void RecordPendingUploads(VkCommandBuffer commandBuffer);
+
+		// RGBA image that can also be rendered into as a color attachment and copied from, see
+		// Vulkan/OffscreenTarget. Render passes leave it in SHADER_READ_ONLY, so it can be drawn
+		// with ImGui::Image() like any other image.
+		static std::shared_ptr<Image> CreateRenderTarget(uint32_t width, uint32_t height);
+		bool IsRenderTarget() const { return m_RenderTarget; }
+
+		VkImage GetVulkanImage() const { return m_Image; }
+		VkImageView GetImageView() const { return m_ImageView; }
 	private:
+		Image() = default;
+
 		void AllocateMemory(uint64_t size);
 		void Release();
+
+		void InitCompressed(const CompressedImageData& compressed);
+
+		static Task<> LoadAsyncTask(std::shared_ptr<ImageLoad> load, ImageMipmaps mipmaps);
+
+		// Stages every level the upload copies. With levelsIncluded, data already holds the CPU
+		// mip chain in GPU layout.
+		StagingRing::Allocation WriteStagingBuffer(const void* data, bool levelsIncluded = false);
+		void UploadAsync(const StagingRing::Allocation& staging);
+		void RecordCopy(VkCommandBuffer commandBuffer, const StagingRing::Allocation& staging);
+		// Takes every level from TRANSFER_DST to SHADER_READ_ONLY, blitting the chain on the way
+		void RecordFinishUpload(VkCommandBuffer commandBuffer, bool generateMips);
+		void RecordPendingRegions(VkCommandBuffer commandBuffer);
+		void DiscardPendingRegions();
 	private:
+		struct PendingRegion
+		{
+			VkBuffer Buffer = nullptr;
+			VkBufferImageCopy Region = {};
+		};
+
 		uint32_t m_Width = 0, m_Height = 0;
 
 		VkImage m_Image = nullptr;
 		VkImageView m_ImageView = nullptr;
-		VkDeviceMemory m_Memory = nullptr;
+		MemoryAllocation* m_Allocation = nullptr;
 		VkSampler m_Sampler = nullptr;
 
 		ImageFormat m_Format = ImageFormat::None;
+		ImageMipmaps m_Mipmaps = ImageMipmaps::None;
+		uint32_t m_MipLevels = 1;
+		bool m_CanBlitMips = false;
+		bool m_RenderTarget = false;
 
-		VkBuffer m_StagingBuffer = nullptr;
-		VkDeviceMemory m_StagingBufferMemory = nullptr;
+		VkDescriptorSet m_DescriptorSet = nullptr;
 
-		size_t m_AlignedSize = 0;
+		// Upload context ticket of the last async upload, and of the one that gives a fresh
+		// image its first contents (cleared once it has completed)
+		uint64_t m_UploadTicket = 0;
+		mutable uint64_t m_InitialUploadTicket = 0;
+		bool m_HasData = false;
 
-		VkDescriptorSet m_DescriptorSet = nullptr;
+		// Staged SetSubData() rectangles whose copy has not been recorded yet
+		std::vector<PendingRegion> m_PendingRegions;
 
 		std::string m_Filepath;
 	};
@@ -0,0 +1,311 @@
+#include "ImageCache.hpp"
+#include "CompressedImage.hpp"
+#include "ApplicationGUI.hpp"
+
+#include "Utopia/Core/Log.hpp"
+#include "Utopia/Core/Hash.hpp"
+#include "Utopia/Utils/FileUtils.hpp"
+
+#include "stb_image.h"
+
+#include <filesystem>
+
+namespace Utopia {
+
+	ImageCache::ImageCache(uint64_t memoryBudget)
+		: m_MemoryBudget(memoryBudget)
+	{
+	}
+
+	std::shared_ptr<Image> ImageCache::Get(std::string_view path, ImageMipmaps mipmaps)
+	{
+		const PathKey pathKey{ std::string(path), mipmaps };
+		const std::string& key = pathKey.Path;
+		if (std::shared_ptr<Image> image = Find(pathKey))
+			return image;
+
+		m_Statistics.Misses++;
+
+		// Decoded on an earlier run; the content hash stored with it stands in for reading the file
+		const ImageDecodeCache& decodeCache = Application::Get().GetImageDecodeCache();
+		ImageDecodeCache::CachedImage cached;
+		std::error_code sizeError;
+		const uint64_t fileSize = std::filesystem::file_size(key, sizeError);
+		if (!sizeError && !IsCompressedImageFile(key) && decodeCache.Lookup(key, cached))
+		{
+			const ContentKey contentKey{ cached.ContentHash, fileSize, mipmaps };
+			auto it = m_Entries.find(contentKey);
+			if (it == m_Entries.end())
+				return Insert(pathKey, contentKey, std::make_shared<Image>(cached.Width, cached.Height, cached.Format, cached.Pixels, mipmaps));
+
+			if (IsSameContent(it->second.Paths, key, nullptr))
+			{
+				m_Statistics.ContentHits++;
+				return Insert(pathKey, contentKey, nullptr);
+			}
+
+			// Hash collision, decode from the file below
+		}
+
+		std::vector<uint8_t> file;
+		if (!Utils::ReadFile(key, file))
+		{
+			UT_CORE_ERROR_TAG("ImageCache", "Failed to read image '{}'", key);
+			return nullptr;
+		}
+
+		// Same contents under another path: no need to decode again
+		const ContentKey contentKey{ Hash::FNV1a(file.data(), file.size()), file.size(), mipmaps };
+		auto it = m_Entries.find(contentKey);
+		const bool collision = it != m_Entries.end() && !IsSameContent(it->second.Paths, key, &file);
+		if (it != m_Entries.end() && !collision)
+		{
+			m_Statistics.ContentHits++;
+			return Insert(pathKey, contentKey, nullptr);
+		}
+
+		std::shared_ptr<Image> image;
+		if (IsCompressedImageFile(key))
+		{
+			CompressedImageData compressed;
+			if (const char* error = ParseCompressedImage(file.data(), file.size(), compressed))
+			{
+				UT_CORE_ERROR_TAG("ImageCache", "Failed to load image '{}': {}", key, error);
+				return nullptr;
+			}
+
+			image = std::make_shared<Image>(compressed);
+		}
+		else
+		{
+			int width, height, channels;
+			void* data = nullptr;
+			ImageFormat format = ImageFormat::RGBA;
+			if (stbi_is_hdr_from_memory(file.data(), (int)file.size()))
+			{
+				data = stbi_loadf_from_memory(file.data(), (int)file.size(), &width, &height, &channels, 4);
+				format = ImageFormat::RGBA32F;
+			}
+			else
+			{
+				data = stbi_load_from_memory(file.data(), (int)file.size(), &width, &height, &channels, 4);
+			}
+
+			if (!data)
+			{
+				UT_CORE_ERROR_TAG("ImageCache", "Failed to decode image '{}': {}", key, stbi_failure_reason());
+				return nullptr;
+			}
+
+			decodeCache.StoreAsync(key, format, width, height, data, contentKey.Hash);
+
+			image = std::make_shared<Image>(width, height, format, data, mipmaps);
+			stbi_image_free(data);
+		}
+
+		// Handed out uncached rather than sharing another file's image
+		if (collision)
+		{
+			UT_CORE_WARN_TAG("ImageCache", "Content hash of '{}' collides with a cached image, not caching it", key);
+			return image;
+		}
+
+		return Insert(pathKey, contentKey, std::move(image));
+	}
+
+	std::shared_ptr<Image> ImageCache::GetAsync(std::string_view path, ImageMipmaps mipmaps)
+	{
+		const PathKey pathKey{ std::string(path), mipmaps };
+
+		auto comparing = m_PendingComparisons.find(pathKey);
+		if (comparing != m_PendingComparisons.end())
+		{
+			PendingComparison& pendingComparison = comparing->second;
+			if (!pendingComparison.Comparison->Done.load(std::memory_order_acquire))
+				return nullptr;
+
+			const ContentKey contentKey = pendingComparison.Key;
+			const bool isSame = pendingComparison.Comparison->IsSame;
+			std::shared_ptr<Image> image = std::move(pendingComparison.Loaded);
+			m_PendingComparisons.erase(comparing);
+
+			if (!isSame)
+			{
+				UT_CORE_WARN_TAG("ImageCache", "Content hash of '{}' collides with a cached image, not caching it", pathKey.Path);
+				return image;
+			}
+
+			// The duplicate GPU copy is dropped here
+			m_Statistics.ContentHits++;
+			return Insert(pathKey, contentKey, nullptr);
+		}
+
+		auto pending = m_PendingLoads.find(pathKey);
+		if (pending == m_PendingLoads.end())
+		{
+			if (std::shared_ptr<Image> image = Find(pathKey))
+				return image;
+
+			m_Statistics.Misses++;
+			m_PendingLoads.emplace(pathKey, Image::LoadAsync(pathKey.Path, mipmaps));
+			return nullptr;
+		}
+
+		// Failed loads stay in the pending list so they are not retried every frame
+		const std::shared_ptr<ImageLoad>& load = pending->second;
+		if (!load->IsReady())
+			return nullptr;
+
+		const ContentKey contentKey{ load->GetContentHash(), load->GetContentSize(), mipmaps };
+		std::shared_ptr<Image> image = load->GetImage();
+		m_PendingLoads.erase(pending);
+
+		auto it = m_Entries.find(contentKey);
+		if (it == m_Entries.end())
+			return Insert(pathKey, contentKey, std::move(image));
+
+		// Decoded in the background already, but reading both files to rule out a hash collision
+		// is too slow for the main thread
+		auto comparison = std::make_shared<ContentComparison>();
+		comparison->Path = pathKey.Path;
+		comparison->CachedPaths = it->second.Paths;
+
+		m_PendingComparisons.emplace(pathKey, PendingComparison{ contentKey, std::move(image), it->second.Resource, comparison });
+
+		Application::Get().GetThreadPool().Submit([comparison]()
+		{
+			comparison->IsSame = IsSameContent(comparison->CachedPaths, comparison->Path, nullptr);
+			comparison->Done.store(true, std::memory_order_release);
+		});
+
+		return nullptr;
+	}
+
+	void ImageCache::SetMemoryBudget(uint64_t memoryBudget)
+	{
+		m_MemoryBudget = memoryBudget;
+		Trim(m_MemoryBudget);
+	}
+
+	void ImageCache::Clear()
+	{
+		Trim(0);
+
+		for (auto it = m_PendingLoads.begin(); it != m_PendingLoads.end();)
+		{
+			if (it->second->HasFailed())
+				it = m_PendingLoads.erase(it);
+			else
+				++it;
+		}
+	}
+
+	const ImageCache::Statistics& ImageCache::GetStatistics()
+	{
+		m_Statistics.EntryCount = (uint32_t)m_Entries.size();
+		m_Statistics.MemoryUsage = m_MemoryUsage;
+		m_Statistics.MemoryBudget = m_MemoryBudget;
+		return m_Statistics;
+	}
+
+	std::shared_ptr<Image> ImageCache::Find(const PathKey& path)
+	{
+		auto pathIt = m_Paths.find(path);
+		if (pathIt == m_Paths.end())
+			return nullptr;
+
+		auto entryIt = m_Entries.find(pathIt->second);
+		if (entryIt == m_Entries.end())
+			return nullptr;
+
+		m_Statistics.Hits++;
+		Touch(entryIt->second);
+		return entryIt->second.Resource;
+	}
+
+	bool ImageCache::IsSameContent(const std::vector<PathKey>& cachedPaths, const std::string& path, const std::vector<uint8_t>* fileData)
+	{
+		std::vector<uint8_t> data;
+		if (!fileData)
+		{
+			if (!Utils::ReadFile(path, data))
+				return false;
+			fileData = &data;
+		}
+
+		// Any of the entry's files will do, they all had the same contents when they were added
+		std::vector<uint8_t> cachedData;
+		for (const PathKey& cachedPath : cachedPaths)
+		{
+			if (Utils::ReadFile(cachedPath.Path, cachedData))
+				return cachedData == *fileData;
+		}
+
+		return false;
+	}
+
+	std::shared_ptr<Image> ImageCache::Insert(const PathKey& path, const ContentKey& key, std::shared_ptr<Image> image)
+	{
+		m_Paths[path] = key;
+
+		auto it = m_Entries.find(key);
+		if (it != m_Entries.end())
+		{
+			Entry& entry = it->second;
+			entry.Paths.push_back(path);
+			Touch(entry);
+			return entry.Resource;
+		}
+
+		// Make room first, so the new entry itself is never a candidate
+		const uint64_t memorySize = image->GetMemorySize();
+		Trim(m_MemoryBudget > memorySize ? m_MemoryBudget - memorySize : 0);
+
+		Entry& entry = m_Entries[key];
+		entry.Resource = std::move(image);
+		entry.MemorySize = memorySize;
+		entry.Paths.push_back(path);
+		m_LRU.push_front(key);
+		entry.LRU = m_LRU.begin();
+
+		m_MemoryUsage += memorySize;
+		return entry.Resource;
+	}
+
+	void ImageCache::Touch(Entry& entry)
+	{
+		m_LRU.splice(m_LRU.begin(), m_LRU, entry.LRU);
+	}
+
+	void ImageCache::Trim(uint64_t memoryBudget)
+	{
+		for (auto it = m_LRU.rbegin(); it != m_LRU.rend() && m_MemoryUsage > memoryBudget;)
+		{
+			auto entryIt = m_Entries.find(*it);
+			Entry& entry = entryIt->second;
+
+			// Still referenced outside the cache; evicting it would not free anything
+			if (entry.Resource.use_count() > 1)
+			{
+				++it;
+				continue;
+			}
+
+			// A path can have been pointed at another entry since
+			for (const PathKey& path : entry.Paths)
+			{
+				auto pathIt = m_Paths.find(path);
+				if (pathIt != m_Paths.end() && pathIt->second == *it)
+					m_Paths.erase(pathIt);
+			}
+
+			m_MemoryUsage -= entry.MemorySize;
+			m_Statistics.Evictions++;
+
+			// Erasing through a reverse iterator: base() points one past the element
+			it = std::make_reverse_iterator(m_LRU.erase(std::next(it).base()));
+			m_Entries.erase(entryIt);
+		}
+	}
+
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include "Image.hpp"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Utopia {
+
+	// Deduplicates Image loads by path and by file contents.
+	//
+	// Entries are keyed by the size and a hash of the file contents plus the mipmap mode, so the
+	// same file reached through different paths shares one GPU copy. A content match is only
+	// trusted after comparing the bytes of both files. The cache holds a reference to every entry; those
+	// nobody else references are evicted least recently used first whenever the device memory
+	// of all cached images exceeds the budget. Images still in use are never evicted.
+	//
+	// Main thread only.
+	class ImageCache
+	{
+	public:
+		struct Statistics
+		{
+			uint64_t Hits = 0;
+			uint64_t Misses = 0;
+			// Misses by path that found the same contents already cached
+			uint64_t ContentHits = 0;
+			uint64_t Evictions = 0;
+
+			uint32_t EntryCount = 0;
+			uint64_t MemoryUsage = 0;
+			uint64_t MemoryBudget = 0;
+		};
+
+	public:
+		explicit ImageCache(uint64_t memoryBudget = 512ull * 1024 * 1024);
+
+		// Loads and uploads synchronously on a miss. Returns nullptr if the file can't be decoded.
+		std::shared_ptr<Image> Get(std::string_view path, ImageMipmaps mipmaps = ImageMipmaps::None);
+
+		// Starts an Image::LoadAsync() on a miss and returns nullptr until it has finished, so it
+		// can simply be called every frame. Failed paths are not retried until Clear(). When the
+		// loaded contents hash like a cached entry, the files are compared on the thread pool
+		// before the entry is shared, which takes a few more calls.
+		std::shared_ptr<Image> GetAsync(std::string_view path, ImageMipmaps mipmaps = ImageMipmaps::None);
+
+		void SetMemoryBudget(uint64_t memoryBudget);
+		uint64_t GetMemoryBudget() const { return m_MemoryBudget; }
+
+		// Evicts unreferenced entries until the cache is within budget
+		void Trim() { Trim(m_MemoryBudget); }
+		// Evicts every unreferenced entry and forgets failed loads
+		void Clear();
+
+		const Statistics& GetStatistics();
+
+	private:
+		struct ContentKey
+		{
+			uint64_t Hash = 0;
+			uint64_t Size = 0;
+			ImageMipmaps Mipmaps = ImageMipmaps::None;
+
+			bool operator==(const ContentKey&) const = default;
+		};
+
+		struct PathKey
+		{
+			std::string Path;
+			ImageMipmaps Mipmaps = ImageMipmaps::None;
+
+			bool operator==(const PathKey&) const = default;
+		};
+
+		struct KeyHasher
+		{
+			size_t operator()(const ContentKey& key) const { return (size_t)(key.Hash ^ (key.Size * 0x9e3779b97f4a7c15ull) ^ (uint64_t)key.Mipmaps); }
+			size_t operator()(const PathKey& key) const { return std::hash<std::string>()(key.Path) ^ (size_t)key.Mipmaps; }
+		};
+
+		struct Entry
+		{
+			std::shared_ptr<Image> Resource;
+			uint64_t MemorySize = 0;
+			std::vector<PathKey> Paths;
+			std::list<ContentKey>::iterator LRU;
+		};
+
+		// Byte comparison running on the thread pool; only sees paths, so no Image is ever released
+		// on a worker
+		struct ContentComparison
+		{
+			std::string Path;
+			std::vector<PathKey> CachedPaths;
+			bool IsSame = false;
+			std::atomic<bool> Done = false;
+		};
+
+		// A finished async load waiting for its comparison with the entry of the same hash
+		struct PendingComparison
+		{
+			ContentKey Key;
+			std::shared_ptr<Image> Loaded;
+			// Keeps the entry from being evicted and replaced while the files are compared
+			std::shared_ptr<Image> Cached;
+			std::shared_ptr<ContentComparison> Comparison;
+		};
+
+		std::shared_ptr<Image> Find(const PathKey& path);
+		// Compares the bytes of one of cachedPaths with fileData, or with the file at path if
+		// fileData is nullptr. Safe to call from any thread.
+		static bool IsSameContent(const std::vector<PathKey>& cachedPaths, const std::string& path, const std::vector<uint8_t>* fileData);
+		std::shared_ptr<Image> Insert(const PathKey& path, const ContentKey& key, std::shared_ptr<Image> image);
+		void Touch(Entry& entry);
+		void Trim(uint64_t memoryBudget);
+
+	private:
+		uint64_t m_MemoryBudget = 0;
+		uint64_t m_MemoryUsage = 0;
+
+		std::unordered_map<ContentKey, Entry, KeyHasher> m_Entries;
+		std::unordered_map<PathKey, ContentKey, KeyHasher> m_Paths;
+		// Most recently used at the front
+		std::list<ContentKey> m_LRU;
+
+		std::unordered_map<PathKey, std::shared_ptr<ImageLoad>, KeyHasher> m_PendingLoads;
+		std::unordered_map<PathKey, PendingComparison, KeyHasher> m_PendingComparisons;
+
+		Statistics m_Statistics;
+	};
+
+}
@@ -0,0 +1,359 @@
+#include "ImageDecodeCache.hpp"
+#include "ApplicationGUI.hpp"
+
+#include "Utopia/Core/Log.hpp"
+#include "Utopia/Core/Hash.hpp"
+#include "Utopia/Serialization/BufferStream.hpp"
+#include "Utopia/Serialization/FileStream.hpp"
+#include "Utopia/Utils/Compression.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+namespace Utopia {
+
+	namespace Utils {
+
+		static constexpr uint32_t DecodeCacheMagic = 0x43445455; // "UTDC"
+		static constexpr uint32_t DecodeCacheVersion = 1;
+		// Pixel data starts at a multiple of this, so it can be read in place
+		static constexpr uint64_t DecodeCacheDataAlignment = 16;
+
+		struct DecodeCacheHeader
+		{
+			uint32_t Magic = DecodeCacheMagic;
+			uint32_t Version = DecodeCacheVersion;
+			uint64_t SourceSize = 0;
+			int64_t SourceTime = 0;
+			uint64_t ContentHash = 0;
+			uint32_t Format = 0;
+			uint32_t Width = 0, Height = 0;
+			uint32_t Compressed = 0;
+			uint64_t PixelSize = 0;
+			uint64_t StoredSize = 0;
+			uint64_t PathLength = 0;
+		};
+
+		static std::string GetSourceKey(std::string_view path)
+		{
+			std::error_code error;
+			std::filesystem::path absolute = std::filesystem::absolute(std::filesystem::path(path), error);
+			return (error ? std::filesystem::path(path) : absolute).lexically_normal().generic_string();
+		}
+
+		static bool GetSourceStamp(const std::string& path, uint64_t& outSize, int64_t& outTime)
+		{
+			std::error_code error;
+			outSize = std::filesystem::file_size(path, error);
+			if (error)
+				return false;
+
+			outTime = (int64_t)std::filesystem::last_write_time(path, error).time_since_epoch().count();
+			return !error;
+		}
+
+		static uint64_t AlignUp(uint64_t value, uint64_t alignment)
+		{
+			return (value + alignment - 1) & ~(alignment - 1);
+		}
+
+	}
+
+	void ImageDecodeCache::Init(const std::filesystem::path& directory, bool compress, uint64_t maxSize)
+	{
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+		if (error)
+		{
+			UT_CORE_ERROR_TAG("ImageDecodeCache", "Failed to create cache directory '{}': {}", directory.string(), error.message());
+			return;
+		}
+
+		m_Directory = directory;
+		m_Compress = compress;
+		m_MaxSize = maxSize;
+
+		// Also counts the directory for later stores
+		if (m_MaxSize)
+			EnforceSizeLimit();
+	}
+
+	bool ImageDecodeCache::Lookup(std::string_view path, CachedImage& outImage) const
+	{
+		if (!IsEnabled())
+			return false;
+
+		const std::string sourceKey = Utils::GetSourceKey(path);
+		uint64_t sourceSize;
+		int64_t sourceTime;
+		if (!Utils::GetSourceStamp(sourceKey, sourceSize, sourceTime))
+			return false;
+
+		const std::filesystem::path entryPath = GetEntryPath(sourceKey);
+		MappedFile file;
+		if (!file.Open(entryPath))
+			return false;
+
+		// Everything is bounds checked before the stream reads it; stale or foreign files are misses
+		Utils::DecodeCacheHeader header;
+		if (file.GetSize() < sizeof(header) + sizeof(size_t))
+			return false;
+
+		BufferStreamReader reader(Buffer(file.GetData(), file.GetSize()));
+		reader.ReadRaw(header);
+
+		if (header.Magic != Utils::DecodeCacheMagic || header.Version != Utils::DecodeCacheVersion)
+			return false;
+		if (header.SourceSize != sourceSize || header.SourceTime != sourceTime || header.PathLength != sourceKey.size())
+			return false;
+
+		const uint64_t dataOffset = Utils::AlignUp(sizeof(header) + sizeof(size_t) + header.PathLength, Utils::DecodeCacheDataAlignment);
+		if (dataOffset + header.StoredSize != file.GetSize())
+			return false;
+
+		const ImageFormat format = (ImageFormat)header.Format;
+		if (Image::IsCompressedFormat(format) || header.PixelSize != Image::GetLevelSize(format, header.Width, header.Height))
+			return false;
+
+		// Two paths can hash to the same entry file. Compared in place rather than through
+		// ReadString(), which would trust a length that may be garbage.
+		size_t storedPathLength = 0;
+		reader.ReadRaw(storedPathLength);
+		if (storedPathLength != sourceKey.size() || memcmp(file.GetData() + reader.GetStreamPosition(), sourceKey.data(), sourceKey.size()) != 0)
+			return false;
+
+		const uint8_t* data = file.GetData() + dataOffset;
+		if (header.Compressed)
+		{
+			outImage.Decompressed.resize(header.PixelSize);
+			if (!Utils::DecompressLZ(data, header.StoredSize, outImage.Decompressed.data(), header.PixelSize))
+				return false;
+
+			outImage.Pixels = outImage.Decompressed.data();
+			file.Close();
+		}
+		else
+		{
+			if (header.StoredSize != header.PixelSize)
+				return false;
+
+			outImage.Pixels = data;
+		}
+
+		outImage.Format = format;
+		outImage.Width = header.Width;
+		outImage.Height = header.Height;
+		outImage.ContentHash = header.ContentHash;
+		outImage.File = std::move(file);
+
+		// Recently used as far as eviction is concerned
+		if (m_MaxSize)
+		{
+			std::error_code error;
+			std::filesystem::last_write_time(entryPath, std::filesystem::file_time_type::clock::now(), error);
+		}
+
+		return true;
+	}
+
+	void ImageDecodeCache::Store(std::string_view path, ImageFormat format, uint32_t width, uint32_t height, const void* pixels, uint64_t contentHash) const
+	{
+		EntryInfo info;
+		if (GetEntryInfo(path, format, width, height, contentHash, info))
+			Write(info, pixels);
+	}
+
+	void ImageDecodeCache::StoreAsync(std::string_view path, ImageFormat format, uint32_t width, uint32_t height, const void* pixels, uint64_t contentHash) const
+	{
+		// The source is stamped now, so an edit while the job is queued makes the entry stale
+		// rather than pairing the new file with the old pixels
+		struct PendingStore
+		{
+			EntryInfo Info;
+			std::vector<uint8_t> Pixels;
+		};
+
+		auto pending = std::make_shared<PendingStore>();
+		if (!GetEntryInfo(path, format, width, height, contentHash, pending->Info))
+			return;
+
+		const uint8_t* bytes = (const uint8_t*)pixels;
+		pending->Pixels.assign(bytes, bytes + Image::GetLevelSize(format, width, height));
+
+		Application::Get().GetThreadPool().Submit([this, pending]()
+		{
+			Write(pending->Info, pending->Pixels.data());
+		});
+	}
+
+	bool ImageDecodeCache::GetEntryInfo(std::string_view path, ImageFormat format, uint32_t width, uint32_t height, uint64_t contentHash, EntryInfo& outInfo) const
+	{
+		if (!IsEnabled())
+			return false;
+
+		outInfo.SourceKey = Utils::GetSourceKey(path);
+		if (!Utils::GetSourceStamp(outInfo.SourceKey, outInfo.SourceSize, outInfo.SourceTime))
+			return false;
+
+		outInfo.Format = format;
+		outInfo.Width = width;
+		outInfo.Height = height;
+		outInfo.ContentHash = contentHash;
+		return true;
+	}
+
+	void ImageDecodeCache::Write(const EntryInfo& info, const void* pixels) const
+	{
+		Utils::DecodeCacheHeader header;
+		header.SourceSize = info.SourceSize;
+		header.SourceTime = info.SourceTime;
+		header.ContentHash = info.ContentHash;
+		header.Format = (uint32_t)info.Format;
+		header.Width = info.Width;
+		header.Height = info.Height;
+		header.PixelSize = Image::GetLevelSize(info.Format, info.Width, info.Height);
+		header.StoredSize = header.PixelSize;
+		header.PathLength = info.SourceKey.size();
+
+		// Only worth a decompression pass on load if it saves a good part of the file
+		std::vector<uint8_t> compressed;
+		if (m_Compress)
+		{
+			const size_t compressedSize = Utils::CompressLZ(pixels, header.PixelSize, compressed);
+			if (compressedSize < header.PixelSize - header.PixelSize / 8)
+			{
+				header.Compressed = 1;
+				header.StoredSize = compressedSize;
+				pixels = compressed.data();
+			}
+		}
+
+		// Written under a unique name and renamed into place, so concurrent lookups never see a
+		// partial entry
+		static std::atomic<uint32_t> s_TempCounter = 0;
+		const std::filesystem::path entryPath = GetEntryPath(info.SourceKey);
+		std::filesystem::path tempPath = entryPath;
+		tempPath += ".tmp" + std::to_string(s_TempCounter.fetch_add(1, std::memory_order_relaxed));
+
+		bool written = false;
+		uint64_t fileSize = 0;
+		{
+			FileStreamWriter writer(tempPath);
+			if (writer)
+			{
+				writer.WriteRaw(header);
+				writer.WriteString(info.SourceKey);
+				writer.WriteZero(Utils::AlignUp(writer.GetStreamPosition(), Utils::DecodeCacheDataAlignment) - writer.GetStreamPosition());
+				written = writer.WriteData((const char*)pixels, header.StoredSize) && writer.IsStreamGood();
+				fileSize = writer.GetStreamPosition();
+			}
+		}
+
+		std::error_code error;
+		uint64_t replacedSize = std::filesystem::file_size(entryPath, error);
+		if (error)
+			replacedSize = 0;
+
+		error.clear();
+		if (written)
+			std::filesystem::rename(tempPath, entryPath, error);
+
+		// Also covers an entry that is mapped elsewhere and can't be replaced right now
+		if (!written || error)
+		{
+			std::filesystem::remove(tempPath, error);
+			return;
+		}
+
+		if (!m_MaxSize)
+			return;
+
+		// Approximate between scans; EnforceSizeLimit() recounts the directory
+		const uint64_t delta = fileSize - replacedSize;
+		if (m_DirectorySize.fetch_add(delta, std::memory_order_relaxed) + delta > m_MaxSize)
+			EnforceSizeLimit();
+	}
+
+	void ImageDecodeCache::EnforceSizeLimit() const
+	{
+		// One scan at a time; a store that finds it busy leaves the eviction to it
+		std::unique_lock<std::mutex> lock(m_EvictionMutex, std::try_to_lock);
+		if (!lock)
+			return;
+
+		struct EntryFile
+		{
+			std::filesystem::path Path;
+			std::filesystem::file_time_type LastUsed;
+			uint64_t Size;
+		};
+
+		std::vector<EntryFile> entries;
+		uint64_t totalSize = 0;
+		std::error_code error;
+		for (const auto& entry : std::filesystem::directory_iterator(m_Directory, error))
+		{
+			if (entry.path().extension() != ".utdc")
+				continue;
+
+			std::error_code entryError;
+			const uint64_t size = entry.file_size(entryError);
+			const auto lastUsed = entry.last_write_time(entryError);
+			if (entryError)
+				continue;
+
+			entries.push_back({ entry.path(), lastUsed, size });
+			totalSize += size;
+		}
+
+		// Well below the limit, so not every store ends up scanning the directory
+		const uint64_t targetSize = m_MaxSize - m_MaxSize / 4;
+		uint32_t evicted = 0;
+		if (totalSize > m_MaxSize)
+		{
+			std::sort(entries.begin(), entries.end(), [](const EntryFile& a, const EntryFile& b) { return a.LastUsed < b.LastUsed; });
+			for (const EntryFile& entry : entries)
+			{
+				if (totalSize <= targetSize)
+					break;
+
+				if (std::filesystem::remove(entry.Path, error))
+				{
+					totalSize -= entry.Size;
+					evicted++;
+				}
+			}
+		}
+
+		m_DirectorySize.store(totalSize, std::memory_order_relaxed);
+
+		if (evicted)
+			UT_CORE_INFO_TAG("ImageDecodeCache", "Evicted {} entries, {} MB left", evicted, totalSize / (1024 * 1024));
+	}
+
+	void ImageDecodeCache::Clear()
+	{
+		if (!IsEnabled())
+			return;
+
+		std::error_code error;
+		for (const auto& entry : std::filesystem::directory_iterator(m_Directory, error))
+		{
+			if (entry.path().extension() == ".utdc")
+				std::filesystem::remove(entry.path(), error);
+		}
+
+		m_DirectorySize.store(0, std::memory_order_relaxed);
+	}
+
+	std::filesystem::path ImageDecodeCache::GetEntryPath(const std::string& sourceKey) const
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.utdc", (unsigned long long)Hash::FNV1a(sourceKey.data(), sourceKey.size()));
+		return m_Directory / name;
+	}
+
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Image.hpp"
+#include "Utopia/Core/MappedFile.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Utopia {
+
+	// Decoded pixels of image files, kept on disk across runs.
+	//
+	// One file per source path, written with FileStreamWriter and validated against the source
+	// file's size and modification time on lookup, so edited images are simply decoded again.
+	// Hits are memory mapped: uncompressed entries go from the page cache straight into staging
+	// memory without decoding or copying. Entries can optionally be LZ compressed, which costs a
+	// fast decompression pass but keeps the directory small for icon-heavy apps.
+	//
+	// With a size limit, entries are evicted least recently used first once the directory grows
+	// past it. A hit refreshes the entry file's modification time, which is what eviction sorts by.
+	//
+	// Lookup and Store are thread-safe (decoding workers use them); Init/Clear are not.
+	class ImageDecodeCache
+	{
+	public:
+		struct CachedImage
+		{
+			ImageFormat Format = ImageFormat::None;
+			uint32_t Width = 0, Height = 0;
+			// FNV-1a of the source file, as Image::LoadAsync() reports it
+			uint64_t ContentHash = 0;
+			// Valid as long as this object is
+			const void* Pixels = nullptr;
+
+			MappedFile File;
+			std::vector<uint8_t> Decompressed;
+		};
+
+	public:
+		// maxSize in bytes, 0 for no limit
+		void Init(const std::filesystem::path& directory, bool compress, uint64_t maxSize = 0);
+		bool IsEnabled() const { return !m_Directory.empty(); }
+
+		bool Lookup(std::string_view path, CachedImage& outImage) const;
+		// Compresses and writes on the calling thread
+		void Store(std::string_view path, ImageFormat format, uint32_t width, uint32_t height, const void* pixels, uint64_t contentHash) const;
+		// Copies the pixels and leaves compressing and writing to the application thread pool
+		void StoreAsync(std::string_view path, ImageFormat format, uint32_t width, uint32_t height, const void* pixels, uint64_t contentHash) const;
+
+		// Deletes every entry
+		void Clear();
+
+	private:
+		// What Store() knows about an image before writing it
+		struct EntryInfo
+		{
+			std::string SourceKey;
+			uint64_t SourceSize = 0;
+			int64_t SourceTime = 0;
+			ImageFormat Format = ImageFormat::None;
+			uint32_t Width = 0, Height = 0;
+			uint64_t ContentHash = 0;
+		};
+
+		bool GetEntryInfo(std::string_view path, ImageFormat format, uint32_t width, uint32_t height, uint64_t contentHash, EntryInfo& outInfo) const;
+		void Write(const EntryInfo& info, const void* pixels) const;
+		// Evicts least recently used entries down to 3/4 of the limit
+		void EnforceSizeLimit() const;
+
+		std::filesystem::path GetEntryPath(const std::string& sourcePath) const;
+
+	private:
+		std::filesystem::path m_Directory;
+		bool m_Compress = false;
+		uint64_t m_MaxSize = 0;
+
+		// Bytes of all entry files; an estimate between scans, as writes race with each other
+		mutable std::atomic<uint64_t> m_DirectorySize = 0;
+		mutable std::mutex m_EvictionMutex;
+	};
+
+}
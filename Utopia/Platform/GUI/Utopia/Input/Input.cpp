@@ -8,7 +8,11 @@ namespace Utopia {
 
     bool Input::IsKeyDown(KeyCode keycode)
     {
+        // No window in offscreen mode, so nothing is ever pressed
         GLFWwindow* windowHandle = Application::Get().GetWindowHandle();
+        if (!windowHandle)
+            return false;
+
         int state = glfwGetKey(windowHandle, static_cast<int>(keycode));
         return (state == GLFW_PRESS || state == GLFW_REPEAT);
     }
@@ -16,6 +20,9 @@ namespace Utopia {
     bool Input::IsMouseButtonDown(MouseButton button)
     {
         GLFWwindow* windowHandle = Application::Get().GetWindowHandle();
+        if (!windowHandle)
+            return false;
+
         int state = glfwGetMouseButton(windowHandle, static_cast<int>(button));
         return (state == GLFW_PRESS);
     }
@@ -25,13 +32,17 @@ namespace Utopia {
         GLFWwindow* windowHandle = Application::Get().GetWindowHandle();
         double xPos = 0.0;
         double yPos = 0.0;
-        glfwGetCursorPos(windowHandle, &xPos, &yPos);
+        if (windowHandle)
+            glfwGetCursorPos(windowHandle, &xPos, &yPos);
         return glm::vec2(static_cast<float>(xPos), static_cast<float>(yPos));
     }
 
     void Input::SetCursorMode(CursorMode mode)
     {
         GLFWwindow* windowHandle = Application::Get().GetWindowHandle();
+        if (!windowHandle)
+            return;
+
         // The + (int)mode offset is a trick to map:
         //    CursorMode::Normal -> GLFW_CURSOR_NORMAL (0)
         //    CursorMode::Hidden -> GLFW_CURSOR_HIDDEN (1)
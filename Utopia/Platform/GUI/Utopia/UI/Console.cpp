@@ -1,22 +1,262 @@
 #include "Console.hpp"
 
 #include "Utopia/ApplicationGUI.hpp"
+#include "Utopia/ImGui/ImGuiTheme.hpp"
 #include "misc/cpp/imgui_stdlib.h"
 
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
 namespace Utopia::UI {
 
-    Console::Console(std::string_view title)
-        : m_Title(title)
+    Console::Console(std::string_view title, size_t messageCapacity, size_t textCapacity)
+        : m_Title(title), m_History(messageCapacity, textCapacity), m_IncomingCountLimit(messageCapacity), m_IncomingSizeLimit(textCapacity)
+    {
+    }
+
+    Console::~Console()
     {
+        if (m_SearchJob)
+        {
+            m_SearchJob->Cancelled = true;
+            m_CancelledJobs.push_back(std::move(m_SearchJob));
+        }
+
+        // Running searches stop at their next batch. Queued ones are claimed here and skipped by
+        // the worker, so this never waits for the thread pool to get to them.
+        for (const std::shared_ptr<SearchJob>& job : m_CancelledJobs)
+        {
+            if (job->Started.exchange(true, std::memory_order_acq_rel))
+                job->Done.wait(false);
+        }
     }
 
     void Console::ClearLog()
     {
-        m_MessageHistory.clear();
+        // Filter results drop their rows of cleared messages on the next update
+        std::lock_guard<std::mutex> lock(m_HistoryMutex);
+        m_History.Clear();
+        m_Index.Evict(m_History.GetFirstSequence());
+    }
+
+    bool Console::SetSpillPath(const std::filesystem::path& path)
+    {
+        std::lock_guard<std::mutex> lock(m_HistoryMutex);
+        return m_History.SetSpillPath(path);
+    }
+
+    void Console::AddRawMessage(std::string_view tag, std::string_view message, uint32_t color, bool italic, Log::Level level)
+    {
+        PendingMessage pending;
+        pending.Text.reserve(tag.size() + message.size());
+        pending.Text.append(tag).append(message);
+        pending.TagLength = (uint32_t)tag.size();
+        pending.Color = color;
+        pending.Italic = italic;
+        pending.Level = level;
+        Push(std::move(pending));
+    }
+
+    void Console::Enqueue(std::string_view tag, uint32_t color, bool italic, std::string_view fmt, std::format_args args)
+    {
+        PendingMessage pending;
+        pending.Text.reserve(tag.size() + fmt.size());
+        pending.Text.append(tag);
+        std::vformat_to(std::back_inserter(pending.Text), fmt, args);
+        pending.TagLength = (uint32_t)tag.size();
+        pending.Color = color;
+        pending.Italic = italic;
+        Push(std::move(pending));
+    }
+
+    void Console::Push(PendingMessage&& pending)
+    {
+        // Nobody has drained for a whole history's worth of messages, i.e. the console isn't
+        // drawn. Older queued messages would be evicted by these anyway, so keep the queue bounded.
+        if (m_IncomingCount.load(std::memory_order_relaxed) >= m_IncomingCountLimit || m_IncomingSize.load(std::memory_order_relaxed) >= m_IncomingSizeLimit)
+        {
+            m_DroppedCount.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        m_IncomingCount.fetch_add(1, std::memory_order_relaxed);
+        m_IncomingSize.fetch_add(pending.Text.size(), std::memory_order_relaxed);
+        m_Incoming.Push(std::move(pending));
+    }
+
+    void Console::DrainIncoming()
+    {
+        if (m_Incoming.IsEmpty() && m_DroppedCount.load(std::memory_order_relaxed) == 0)
+            return;
+
+        std::lock_guard<std::mutex> lock(m_HistoryMutex);
+
+        auto add = [this](std::string_view tag, std::string_view message, uint32_t color, bool italic, Log::Level level)
+        {
+            const uint64_t sequence = m_History.Add(tag, message, color, italic, level);
+
+            // Indexes the stored text, which may have been truncated
+            const ConsoleHistory::Message& entry = m_History.Get(sequence);
+            m_Index.Add(sequence, m_History.GetTagText(entry), m_History.GetMessageText(entry), entry.Level);
+        };
+
+        m_Incoming.Drain([this, &add](PendingMessage& pending)
+        {
+            const std::string_view text = pending.Text;
+            add(text.substr(0, pending.TagLength), text.substr(pending.TagLength), pending.Color, pending.Italic, pending.Level);
+
+            m_IncomingCount.fetch_sub(1, std::memory_order_relaxed);
+            m_IncomingSize.fetch_sub(pending.Text.size(), std::memory_order_relaxed);
+        });
+
+        if (const uint64_t dropped = m_DroppedCount.exchange(0, std::memory_order_relaxed))
+            add({}, std::format("{} messages dropped while the console was not drawn", dropped), 0xffffffff, true, Log::Level::Warn);
+
+        m_Index.Evict(m_History.GetFirstSequence());
+    }
+
+    void Console::SelectFilter()
+    {
+        if (m_SearchJob)
+        {
+            m_SearchJob->Cancelled = true;
+            m_CancelledJobs.push_back(std::move(m_SearchJob));
+        }
+
+        auto it = std::find_if(m_FilterResults.begin(), m_FilterResults.end(), [this](const FilterResult& result) { return result.FilterText == m_FilterInput; });
+        if (it != m_FilterResults.end())
+        {
+            m_FilterResults.splice(m_FilterResults.begin(), m_FilterResults, it);
+            return;
+        }
+
+        FilterResult& result = m_FilterResults.emplace_front();
+        result.FilterText = m_FilterInput;
+        result.Query = std::make_shared<const ConsoleQuery>(ConsoleQuery::Parse(m_FilterInput));
+        result.FilteredSequence = m_History.GetFirstSequence();
+
+        if (m_FilterResults.size() > FilterCacheSize)
+            m_FilterResults.pop_back();
+    }
+
+    void Console::UpdateFilteredRows()
+    {
+        std::erase_if(m_CancelledJobs, [](const std::shared_ptr<SearchJob>& job) { return job->Done.load(std::memory_order_acquire); });
+
+        if (m_FilterResults.empty() || m_FilterResults.front().FilterText != m_FilterInput)
+            SelectFilter();
+
+        FilterResult& result = m_FilterResults.front();
+        if (m_SearchJob && m_SearchJob->Done.load(std::memory_order_acquire))
+        {
+            result.Rows.insert(result.Rows.end(), m_SearchJob->Rows.begin(), m_SearchJob->Rows.end());
+            result.FilteredSequence = m_SearchJob->End;
+            m_SearchJob.reset();
+        }
+
+        // Rows are in message order, so the evicted ones are all at the front
+        const uint64_t firstSequence = m_History.GetFirstSequence();
+        while (result.FirstRow < result.Rows.size() && result.Rows[result.FirstRow].Message < firstSequence)
+            result.FirstRow++;
+
+        if (result.FirstRow > 1024 && result.FirstRow * 2 > result.Rows.size())
+        {
+            result.Rows.erase(result.Rows.begin(), result.Rows.begin() + result.FirstRow);
+            result.FirstRow = 0;
+        }
+
+        result.FilteredSequence = std::max(result.FilteredSequence, firstSequence);
+
+        if (m_SearchJob)
+            return;
+
+        // A few new messages are filtered right away, a backlog (new filter, or one that has not
+        // been shown for a while) on the thread pool
+        const uint64_t endSequence = m_History.GetEndSequence();
+        if (endSequence - result.FilteredSequence > InlineFilterLimit)
+        {
+            StartSearch(result);
+            return;
+        }
+
+        for (; result.FilteredSequence < endSequence; result.FilteredSequence++)
+        {
+            const ConsoleHistory::Message& entry = m_History.Get(result.FilteredSequence);
+            const std::string_view message = m_History.GetMessageText(entry);
+            if (result.Query->Matches(m_History.GetTagText(entry), message, entry.Level))
+                AppendRows(result.FilteredSequence, message, result.Rows);
+        }
+    }
+
+    void Console::StartSearch(FilterResult& result)
+    {
+        m_SearchJob = std::make_shared<SearchJob>();
+        m_SearchJob->Query = result.Query;
+        m_SearchJob->Begin = result.FilteredSequence;
+        m_SearchJob->End = m_History.GetEndSequence();
+
+        Application::Get().GetThreadPool().Submit([this, job = m_SearchJob]()
+        {
+            // Otherwise the Console is gone already
+            if (!job->Started.exchange(true, std::memory_order_acq_rel))
+                RunSearch(*job);
+        });
+    }
+
+    void Console::RunSearch(SearchJob& job)
+    {
+        constexpr uint64_t blockSize = ConsoleSearchIndex::BlockSize;
+
+        uint64_t sequence = job.Begin;
+        while (sequence < job.End && !job.Cancelled.load(std::memory_order_relaxed))
+        {
+            // Released between batches, so the UI thread is never held up for long
+            std::lock_guard<std::mutex> lock(m_HistoryMutex);
+
+            // Messages evicted meanwhile are skipped, rows found for them earlier are dropped by
+            // UpdateFilteredRows()
+            sequence = std::max(sequence, m_History.GetFirstSequence());
+            const uint64_t batchEnd = std::min(job.End, (sequence / blockSize + SearchBatchBlocks) * blockSize);
+            while (sequence < batchEnd)
+            {
+                const uint64_t blockEnd = std::min(batchEnd, (sequence / blockSize + 1) * blockSize);
+                const ConsoleSearchIndex::Summary* block = m_Index.GetBlock(sequence);
+                if (block && !job.Query->MayMatch(*block))
+                {
+                    sequence = blockEnd;
+                    continue;
+                }
+
+                for (; sequence < blockEnd; sequence++)
+                {
+                    const ConsoleHistory::Message& entry = m_History.Get(sequence);
+                    const std::string_view message = m_History.GetMessageText(entry);
+                    if (job.Query->Matches(m_History.GetTagText(entry), message, entry.Level))
+                        AppendRows(sequence, message, job.Rows);
+                }
+            }
+        }
+
+        job.Done.store(true, std::memory_order_release);
+        job.Done.notify_all();
+    }
+
+    void Console::AppendRows(uint64_t sequence, std::string_view message, std::vector<Row>& rows)
+    {
+        rows.push_back({ sequence, 0 });
+        for (const char* newline = message.data(); (newline = (const char*)memchr(newline, '\n', message.data() + message.size() - newline)); )
+        {
+            newline++;
+            rows.push_back({ sequence, (uint32_t)(newline - message.data()) });
+        }
     }
 
     void Console::OnUIRender()
     {
+        // Also while the window is hidden, so the queue never grows past one frame of messages
+        DrainIncoming();
+
         ImGui::SetNextWindowSize(ImVec2(520.0f, 600.0f), ImGuiCond_FirstUseEver);
         if (!ImGui::Begin(m_Title.c_str()))
         {
@@ -24,10 +264,16 @@ namespace Utopia::UI {
             return;
         }
 
+        UpdateFilteredRows();
+        const FilterResult& filtered = m_FilterResults.front();
+
         // Options popup
         if (ImGui::BeginPopup("Options"))
         {
             ImGui::Checkbox("Auto-scroll", &m_AutoScroll);
+            ImGui::Text("%zu / %zu messages", m_History.GetCount(), m_History.GetMessageCapacity());
+            if (!m_History.GetSpillPath().empty())
+                ImGui::Text("%llu spilled to %s", (unsigned long long)m_History.GetSpilledCount(), m_History.GetSpillPath().string().c_str());
             ImGui::EndPopup();
         }
 
@@ -38,7 +284,19 @@ namespace Utopia::UI {
         ImGui::SameLine();
         ImGui::TextUnformatted("Search");
         ImGui::SameLine();
-        m_Filter.Draw("##search", 180.0f);
+        ImGui::SetNextItemWidth(280.0f);
+        ImGui::InputTextWithHint("##search", "word -word tag:Name level:warn /regex/", &m_FilterInput);
+
+        if (!filtered.Query->GetError().empty())
+        {
+            ImGui::SameLine();
+            ImGui::TextColored(ImColor(Colors::Theme::textError), "%s", filtered.Query->GetError().c_str());
+        }
+        else if (m_SearchJob)
+        {
+            ImGui::SameLine();
+            ImGui::TextDisabled("Searching...");
+        }
         ImGui::Separator();
 
         // Reserve space for the input text at the bottom
@@ -55,38 +313,54 @@ namespace Utopia::UI {
         ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(4, 1)); // Tight spacing
         const float textPadding = 8.0f;
 
-        // Render messages
+        // Only the visible rows are submitted. Text goes straight into the draw list with the font
+        // and color of each row, so no font or style color is pushed per message.
+        ImFont* regularFont = ImGui::GetFont();
+        ImFont* boldFont = Application::GetFont("Bold");
+        ImFont* italicFont = Application::GetFont("Italic");
+        const float fontSize = ImGui::GetFontSize();
+        const float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+        ImDrawList* drawList = ImGui::GetWindowDrawList();
+
         ImGui::SetCursorPosY(ImGui::GetCursorPosY() + textPadding);
-        for (auto& entry : m_MessageHistory)
+        ImGuiListClipper clipper;
+        clipper.Begin((int)(filtered.Rows.size() - filtered.FirstRow), rowHeight);
+        while (clipper.Step())
         {
-            if (!m_Filter.PassFilter(entry.Message.c_str()))
-                continue;
-
-            ImGui::SetCursorPosX(ImGui::GetCursorPosX() + textPadding);
-
-            // Set color
-            ImGui::PushStyleColor(ImGuiCol_Text, ImColor(entry.Color).Value);
-
-            // If there's a tag, show it in bold
-            if (!entry.Tag.empty())
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
             {
-                ImGui::PushFont(Application::GetFont("Bold"));
-                ImGui::TextUnformatted(entry.Tag.c_str());
-                ImGui::PopFont();
-                ImGui::SameLine(0.0f, textPadding);
-            }
+                const Row& row = filtered.Rows[filtered.FirstRow + i];
+                const ConsoleHistory::Message& entry = m_History.Get(row.Message);
+                const std::string_view tag = m_History.GetTagText(entry);
+                const std::string_view message = m_History.GetMessageText(entry);
+
+                const ImVec2 rowPos = ImGui::GetCursorScreenPos();
+                ImVec2 textPos(rowPos.x + textPadding, rowPos.y);
 
-            // Italic font if requested
-            if (entry.Italic)
-                ImGui::PushFont(Application::GetFont("Italic"));
+                // Tag in bold; follow-up lines of the message are aligned with its first line
+                if (!tag.empty())
+                {
+                    const char* tagEnd = tag.data() + tag.size();
+                    if (row.LineOffset == 0)
+                        drawList->AddText(boldFont, fontSize, textPos, entry.Color, tag.data(), tagEnd);
+                    textPos.x += boldFont->CalcTextSizeA(fontSize, FLT_MAX, 0.0f, tag.data(), tagEnd).x + textPadding;
+                }
 
-            ImGui::TextUnformatted(entry.Message.c_str());
+                const char* lineBegin = message.data() + row.LineOffset;
+                const char* messageEnd = message.data() + message.size();
+                const char* lineEnd = (const char*)memchr(lineBegin, '\n', messageEnd - lineBegin);
+                if (!lineEnd)
+                    lineEnd = messageEnd;
 
-            if (entry.Italic)
-                ImGui::PopFont();
+                ImFont* font = entry.Italic ? italicFont : regularFont;
+                drawList->AddText(font, fontSize, textPos, entry.Color, lineBegin, lineEnd);
+                const float lineWidth = font->CalcTextSizeA(fontSize, FLT_MAX, 0.0f, lineBegin, lineEnd).x;
 
-            ImGui::PopStyleColor();
+                // Extends the scroll region, which also drives the horizontal scrollbar
+                ImGui::Dummy(ImVec2(textPos.x - rowPos.x + lineWidth, ImGui::GetTextLineHeight()));
+            }
         }
+        clipper.End();
 
         // Auto-scroll
         if (m_ScrollToBottom || (m_AutoScroll && ImGui::GetScrollY() >= ImGui::GetScrollMaxY()))
@@ -5,93 +5,184 @@
 #include <string_view>
 #include <format>
 #include <functional>
+#include <filesystem>
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
 
-#include <imgui.h>
+#include "ConsoleHistory.hpp"
+#include "ConsoleSearch.hpp"
+#include "Utopia/Core/MPSCQueue.hpp"
 
 namespace Utopia::UI {
 
+    // Dockable log window with a command line.
+    //
+    // AddMessage() and friends may be called from any thread: messages are formatted by the
+    // caller and handed over through a lock-free queue that the UI thread drains once per frame
+    // into a bounded ConsoleHistory. Old messages are evicted once the capacities are reached
+    // (see SetSpillPath() to keep them on disk). While the console isn't drawn, at most a
+    // history's worth of messages is queued; further ones are dropped and reported as a count.
+    //
+    // The search box takes ConsoleQuery syntax (words, -exclusions, tag:, level:, /regex/).
+    // Messages are indexed as they arrive; a new filter is run over the backlog on the thread
+    // pool, and the results of the last few filters are kept and updated as messages come in.
     class Console
     {
     public:
         using MessageSendCallback = std::function<void(std::string_view)>;
 
+        static constexpr size_t DefaultMessageCapacity = 100000;
+        static constexpr size_t DefaultTextCapacity = 16 * 1024 * 1024;
+
     public:
-        explicit Console(std::string_view title = "Utopia Console");
-        ~Console() = default;
+        explicit Console(std::string_view title = "Utopia Console", size_t messageCapacity = DefaultMessageCapacity, size_t textCapacity = DefaultTextCapacity);
+        // Cancels background searches, waiting only for those already running
+        ~Console();
 
+        // UI thread only. Messages still queued by other threads show up afterwards.
         void ClearLog();
 
         template<typename... Args>
         void AddMessage(std::string_view fmt, Args&&... args)
         {
-            std::string msgString = std::vformat(fmt, std::make_format_args(args...));
-            m_MessageHistory.emplace_back(msgString);
+            Enqueue({}, 0xffffffff, false, fmt, std::make_format_args(args...));
         }
 
         template<typename... Args>
         void AddItalicMessage(std::string_view fmt, Args&&... args)
         {
-            std::string msgString = std::vformat(fmt, std::make_format_args(args...));
-            MessageInfo info(msgString);
-            info.Italic = true;
-            m_MessageHistory.push_back(info);
+            Enqueue({}, 0xffffffff, true, fmt, std::make_format_args(args...));
         }
 
         template<typename... Args>
         void AddTaggedMessage(std::string_view tag, std::string_view fmt, Args&&... args)
         {
-            std::string msgString = std::vformat(fmt, std::make_format_args(args...));
-            m_MessageHistory.emplace_back(std::string(tag), msgString);
+            Enqueue(tag, 0xffffffff, false, fmt, std::make_format_args(args...));
         }
 
         template<typename... Args>
         void AddMessageWithColor(uint32_t color, std::string_view fmt, Args&&... args)
         {
-            std::string msgString = std::vformat(fmt, std::make_format_args(args...));
-            m_MessageHistory.emplace_back(msgString, color);
+            Enqueue({}, color, false, fmt, std::make_format_args(args...));
         }
 
         template<typename... Args>
         void AddItalicMessageWithColor(uint32_t color, std::string_view fmt, Args&&... args)
         {
-            std::string msgString = std::vformat(fmt, std::make_format_args(args...));
-            MessageInfo info(msgString, color);
-            info.Italic = true;
-            m_MessageHistory.push_back(info);
+            Enqueue({}, color, true, fmt, std::make_format_args(args...));
         }
 
         template<typename... Args>
         void AddTaggedMessageWithColor(uint32_t color, std::string_view tag, std::string_view fmt, Args&&... args)
         {
-            std::string msgString = std::vformat(fmt, std::make_format_args(args...));
-            m_MessageHistory.emplace_back(std::string(tag), msgString, color);
+            Enqueue(tag, color, false, fmt, std::make_format_args(args...));
         }
 
+        // Unformatted text, for forwarding messages that are already formatted. Thread-safe.
+        void AddRawMessage(std::string_view tag, std::string_view message, uint32_t color = 0xffffffff, bool italic = false, Log::Level level = Log::Level::Info);
+
         void OnUIRender();
 
         void SetMessageSendCallback(const MessageSendCallback& callback);
 
+        // Messages evicted from the history are appended to this text file. Empty disables it.
+        // UI thread only.
+        bool SetSpillPath(const std::filesystem::path& path);
+
     private:
-        struct MessageInfo
+        // Formatted on the producer thread; tag and message share one allocation
+        struct PendingMessage
         {
-            std::string Tag;
-            std::string Message;
-            bool Italic = false;
+            std::string Text;
+            uint32_t TagLength = 0;
             uint32_t Color = 0xffffffff;
+            bool Italic = false;
+            Log::Level Level = Log::Level::Info;
+        };
 
-            explicit MessageInfo(const std::string& msg, uint32_t color_ = 0xffffffff)
-                : Message(msg), Color(color_) {
-            }
+        // One line of a message that passes the filter. Messages with line breaks take several
+        // rows, so every row has the same height and the list can be clipped.
+        struct Row
+        {
+            uint64_t Message;
+            uint32_t LineOffset;
+        };
 
-            MessageInfo(const std::string& tag, const std::string& msg, uint32_t color_ = 0xffffffff)
-                : Tag(tag), Message(msg), Color(color_) {
-            }
+        // Rows of the messages that pass one filter
+        struct FilterResult
+        {
+            std::string FilterText;
+            std::shared_ptr<const ConsoleQuery> Query;
+
+            // Live rows start at FirstRow; the evicted ones in front are erased in bulk
+            std::vector<Row> Rows;
+            size_t FirstRow = 0;
+            // Next message to run through the filter
+            uint64_t FilteredSequence = 0;
         };
 
+        // Filters messages [Begin, End) on the thread pool
+        struct SearchJob
+        {
+            std::shared_ptr<const ConsoleQuery> Query;
+            uint64_t Begin = 0;
+            uint64_t End = 0;
+            std::vector<Row> Rows;
+
+            std::atomic<bool> Cancelled = false;
+            // Claimed by whoever gets there first: the worker that runs the job, or ~Console(),
+            // which then doesn't wait for a job still queued behind other pool work
+            std::atomic<bool> Started = false;
+            std::atomic<bool> Done = false;
+        };
+
+        // Filter results kept for going back to an earlier filter
+        static constexpr size_t FilterCacheSize = 4;
+        // More new messages than this are filtered in the background
+        static constexpr uint64_t InlineFilterLimit = 4096;
+        // Index blocks a search scans before letting the UI thread add messages again
+        static constexpr uint64_t SearchBatchBlocks = 16;
+
+        void Enqueue(std::string_view tag, uint32_t color, bool italic, std::string_view fmt, std::format_args args);
+        void Push(PendingMessage&& pending);
+
+        // Moves queued messages into the history and the search index
+        void DrainIncoming();
+
+        // Switches to the results for the current filter text, or makes new ones
+        void SelectFilter();
+        // Takes finished search results, drops rows of evicted messages and filters new messages
+        void UpdateFilteredRows();
+        void StartSearch(FilterResult& result);
+        void RunSearch(SearchJob& job);
+
+        static void AppendRows(uint64_t sequence, std::string_view message, std::vector<Row>& rows);
+
         std::string m_Title;
         std::string m_MessageBuffer;
-        std::vector<MessageInfo> m_MessageHistory;
-        ImGuiTextFilter m_Filter;
+        ConsoleHistory m_History;
+        ConsoleSearchIndex m_Index;
+        // Held by the UI thread while it changes the history or index and by searches while they
+        // read them. The UI thread reads without it, nobody else writes.
+        std::mutex m_HistoryMutex;
+        MPSCQueue<PendingMessage> m_Incoming;
+        // Queued messages and their text size, checked against the history capacities
+        std::atomic<size_t> m_IncomingCount = 0;
+        std::atomic<size_t> m_IncomingSize = 0;
+        const size_t m_IncomingCountLimit;
+        const size_t m_IncomingSizeLimit;
+        // Messages dropped since the last drain
+        std::atomic<uint64_t> m_DroppedCount = 0;
+
+        std::string m_FilterInput;
+        // Most recently used first, the front one is displayed
+        std::list<FilterResult> m_FilterResults;
+        // Search for the front result, if running
+        std::shared_ptr<SearchJob> m_SearchJob;
+        // Cancelled searches that may still be reading the history
+        std::vector<std::shared_ptr<SearchJob>> m_CancelledJobs;
         bool m_AutoScroll = true;
         bool m_ScrollToBottom = false;
 
@@ -0,0 +1,85 @@
+#include "ConsoleHistory.hpp"
+
+#include "Utopia/Core/Log.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Utopia::UI {
+
+    ConsoleHistory::ConsoleHistory(size_t messageCapacity, size_t textCapacity)
+        : m_Messages(std::max<size_t>(messageCapacity, 1)), m_Text(new char[std::max<size_t>(textCapacity, 1)]), m_TextCapacity(std::max<size_t>(textCapacity, 1))
+    {
+    }
+
+    uint64_t ConsoleHistory::Add(std::string_view tag, std::string_view message, uint32_t color, bool italic, Log::Level level)
+    {
+        // Truncated to fit the arena, message text first
+        tag = tag.substr(0, m_TextCapacity);
+        message = message.substr(0, m_TextCapacity - tag.size());
+        const size_t length = tag.size() + message.size();
+
+        // Text is never split across the end of the arena, so it can be handed out as one view
+        uint64_t offset = m_TextHead;
+        const size_t position = (size_t)(offset % m_TextCapacity);
+        if (position + length > m_TextCapacity)
+            offset += m_TextCapacity - position;
+
+        while (GetCount() == m_Messages.size() || (GetCount() && offset + length - Get(m_FirstSequence).TextOffset > m_TextCapacity))
+            EvictOldest();
+
+        char* text = m_Text.get() + offset % m_TextCapacity;
+        memcpy(text, tag.data(), tag.size());
+        memcpy(text + tag.size(), message.data(), message.size());
+        m_TextHead = offset + length;
+
+        Message& record = m_Messages[m_EndSequence % m_Messages.size()];
+        record.TextOffset = offset;
+        record.TagLength = (uint32_t)tag.size();
+        record.MessageLength = (uint32_t)message.size();
+        record.Color = color;
+        record.Italic = italic;
+        record.Level = level;
+
+        return m_EndSequence++;
+    }
+
+    void ConsoleHistory::Clear()
+    {
+        m_FirstSequence = m_EndSequence;
+    }
+
+    bool ConsoleHistory::SetSpillPath(const std::filesystem::path& path)
+    {
+        m_Spill.close();
+        m_SpillPath = path;
+        if (path.empty())
+            return true;
+
+        m_Spill.open(path, std::ios::binary | std::ios::app);
+        if (!m_Spill)
+        {
+            UT_CORE_ERROR_TAG("Console", "Failed to open spill file '{}'", path.string());
+            m_SpillPath.clear();
+            return false;
+        }
+
+        return true;
+    }
+
+    void ConsoleHistory::EvictOldest()
+    {
+        const Message& oldest = Get(m_FirstSequence);
+        if (m_Spill.is_open())
+        {
+            const std::string_view tag = GetTagText(oldest);
+            if (!tag.empty())
+                m_Spill << '[' << tag << "] ";
+            m_Spill << GetMessageText(oldest) << '\n';
+            m_SpilledCount++;
+        }
+
+        m_FirstSequence++;
+    }
+
+} // namespace Utopia::UI
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Utopia/Core/Log.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace Utopia::UI {
+
+    // Bounded message storage behind UI::Console.
+    //
+    // Message records live in a fixed-capacity ring, their text in a circular byte arena, so
+    // memory use is capped no matter how long the session runs. When either fills up the oldest
+    // messages are evicted, and optionally appended to a spill file as plain text lines so
+    // nothing is lost. Messages are identified by sequence numbers that keep increasing across
+    // evictions (and are not reset by Clear()).
+    //
+    // Not thread-safe; Console feeds it from its ingestion queue on the UI thread.
+    class ConsoleHistory
+    {
+    public:
+        struct Message
+        {
+            // Position of tag + message text in the arena, monotonically increasing
+            uint64_t TextOffset = 0;
+            uint32_t TagLength = 0;
+            uint32_t MessageLength = 0;
+            uint32_t Color = 0xffffffff;
+            bool Italic = false;
+            Log::Level Level = Log::Level::Info;
+        };
+
+    public:
+        ConsoleHistory(size_t messageCapacity, size_t textCapacity);
+
+        // Text longer than the arena is truncated. Returns the new message's sequence number.
+        uint64_t Add(std::string_view tag, std::string_view message, uint32_t color, bool italic, Log::Level level = Log::Level::Info);
+        // Drops every message without spilling it
+        void Clear();
+
+        // Retained messages are [GetFirstSequence(), GetEndSequence())
+        uint64_t GetFirstSequence() const { return m_FirstSequence; }
+        uint64_t GetEndSequence() const { return m_EndSequence; }
+        size_t GetCount() const { return (size_t)(m_EndSequence - m_FirstSequence); }
+        bool Contains(uint64_t sequence) const { return sequence >= m_FirstSequence && sequence < m_EndSequence; }
+
+        const Message& Get(uint64_t sequence) const { return m_Messages[sequence % m_Messages.size()]; }
+        std::string_view GetTagText(const Message& message) const { return { GetTextAt(message.TextOffset), message.TagLength }; }
+        std::string_view GetMessageText(const Message& message) const { return { GetTextAt(message.TextOffset) + message.TagLength, message.MessageLength }; }
+
+        // Evicted messages are appended to this file from now on. Empty stops spilling.
+        bool SetSpillPath(const std::filesystem::path& path);
+        const std::filesystem::path& GetSpillPath() const { return m_SpillPath; }
+        uint64_t GetSpilledCount() const { return m_SpilledCount; }
+
+        size_t GetMessageCapacity() const { return m_Messages.size(); }
+        size_t GetTextCapacity() const { return m_TextCapacity; }
+
+    private:
+        const char* GetTextAt(uint64_t offset) const { return m_Text.get() + offset % m_TextCapacity; }
+
+        void EvictOldest();
+
+    private:
+        std::vector<Message> m_Messages;
+        uint64_t m_FirstSequence = 0;
+        uint64_t m_EndSequence = 0;
+
+        std::unique_ptr<char[]> m_Text;
+        size_t m_TextCapacity = 0;
+        // Arena write position, monotonically increasing like TextOffset
+        uint64_t m_TextHead = 0;
+
+        std::filesystem::path m_SpillPath;
+        std::ofstream m_Spill;
+        uint64_t m_SpilledCount = 0;
+    };
+
+} // namespace Utopia::UI
@@ -0,0 +1,233 @@
+#include "ConsoleSearch.hpp"
+
+#include "Utopia/Core/Hash.hpp"
+
+#include <algorithm>
+#include <format>
+
+namespace Utopia::UI {
+
+    namespace Utils {
+
+        static char ToLower(char c)
+        {
+            return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+        }
+
+        static std::string ToLower(std::string_view text)
+        {
+            std::string result(text);
+            for (char& c : result)
+                c = ToLower(c);
+            return result;
+        }
+
+        static bool EqualsIgnoreCase(std::string_view text, std::string_view lowercase)
+        {
+            return text.size() == lowercase.size() && std::equal(text.begin(), text.end(), lowercase.begin(), [](char a, char b) { return ToLower(a) == b; });
+        }
+
+        static bool ContainsIgnoreCase(std::string_view text, std::string_view lowercase)
+        {
+            return std::search(text.begin(), text.end(), lowercase.begin(), lowercase.end(), [](char a, char b) { return ToLower(a) == b; }) != text.end();
+        }
+
+        static std::optional<Log::Level> ParseLevel(std::string_view text)
+        {
+            static constexpr std::pair<std::string_view, Log::Level> levels[] = {
+                { "trace", Log::Level::Trace },
+                { "info",  Log::Level::Info },
+                { "warn",  Log::Level::Warn },
+                { "error", Log::Level::Error },
+                { "fatal", Log::Level::Fatal },
+            };
+
+            for (const auto& [name, level] : levels)
+            {
+                if (EqualsIgnoreCase(text, name))
+                    return level;
+            }
+
+            return std::nullopt;
+        }
+
+    } // namespace Utils
+
+    void ConsoleSearchIndex::Add(uint64_t sequence, std::string_view tag, std::string_view message, Log::Level level)
+    {
+        const uint64_t block = sequence / BlockSize;
+        if (m_Blocks.empty())
+            m_FirstBlock = block;
+        while (m_FirstBlock + m_Blocks.size() <= block)
+            m_Blocks.emplace_back();
+
+        Summary& summary = m_Blocks[block - m_FirstBlock];
+        AddTrigrams(summary, message);
+        summary.Tags |= GetTagBit(tag);
+        summary.Levels |= GetLevelBit(level);
+    }
+
+    void ConsoleSearchIndex::Evict(uint64_t firstSequence)
+    {
+        while (!m_Blocks.empty() && (m_FirstBlock + 1) * BlockSize <= firstSequence)
+        {
+            m_Blocks.pop_front();
+            m_FirstBlock++;
+        }
+    }
+
+    const ConsoleSearchIndex::Summary* ConsoleSearchIndex::GetBlock(uint64_t sequence) const
+    {
+        const uint64_t block = sequence / BlockSize;
+        if (block < m_FirstBlock || block - m_FirstBlock >= m_Blocks.size())
+            return nullptr;
+
+        return &m_Blocks[block - m_FirstBlock];
+    }
+
+    void ConsoleSearchIndex::AddTrigrams(Summary& summary, std::string_view text)
+    {
+        for (size_t i = 0; i + 3 <= text.size(); i++)
+        {
+            const uint32_t trigram = (uint8_t)Utils::ToLower(text[i]) | ((uint8_t)Utils::ToLower(text[i + 1]) << 8) | ((uint8_t)Utils::ToLower(text[i + 2]) << 16);
+            // Fibonacci hashing, the top bits select the filter bit
+            const uint32_t bit = (trigram * 0x9E3779B1u) >> (32 - 12);
+            static_assert(TrigramBits == 1u << 12);
+            summary.Trigrams[bit / 64] |= 1ull << (bit % 64);
+        }
+    }
+
+    uint64_t ConsoleSearchIndex::GetTagBit(std::string_view tag)
+    {
+        const std::string lowercase = Utils::ToLower(tag);
+        return 1ull << (Hash::FNV1a(lowercase.data(), lowercase.size()) % 64);
+    }
+
+    ConsoleQuery ConsoleQuery::Parse(std::string_view text)
+    {
+        ConsoleQuery query;
+        query.m_Required.Levels = ~0u;
+
+        size_t position = 0;
+        while (position < text.size())
+        {
+            if (text[position] == ' ')
+            {
+                position++;
+                continue;
+            }
+
+            // A regex runs to its closing slash and may contain spaces
+            if (text[position] == '/')
+            {
+                size_t end = text.find('/', position + 1);
+                if (end == std::string_view::npos)
+                    end = text.size();
+
+                const std::string pattern(text.substr(position + 1, end - position - 1));
+                position = end + 1;
+                if (pattern.empty())
+                    continue;
+
+                if (query.m_Regex)
+                {
+                    query.m_Error = "Only one regular expression is supported";
+                    continue;
+                }
+
+                try
+                {
+                    query.m_Regex.emplace(pattern, std::regex::ECMAScript | std::regex::icase | std::regex::optimize);
+                }
+                catch (const std::regex_error& e)
+                {
+                    query.m_Error = e.what();
+                }
+                continue;
+            }
+
+            size_t end = text.find(' ', position);
+            if (end == std::string_view::npos)
+                end = text.size();
+
+            const std::string_view term = text.substr(position, end - position);
+            position = end;
+
+            if (term.starts_with("tag:") && term.size() > 4)
+            {
+                query.m_Tags.push_back(Utils::ToLower(term.substr(4)));
+                query.m_Required.Tags |= ConsoleSearchIndex::GetTagBit(term.substr(4));
+            }
+            else if (term.starts_with("level:") && term.size() > 6)
+            {
+                const std::optional<Log::Level> level = Utils::ParseLevel(term.substr(6));
+                if (!level)
+                {
+                    query.m_Error = std::format("Unknown level '{}'", term.substr(6));
+                    continue;
+                }
+
+                query.m_MinLevel = *level;
+                query.m_Required.Levels = ~0u << (uint32_t)*level;
+            }
+            else if (term.starts_with('-') && term.size() > 1)
+            {
+                query.m_Exclude.push_back(Utils::ToLower(term.substr(1)));
+            }
+            else
+            {
+                query.m_Include.push_back(Utils::ToLower(term));
+                ConsoleSearchIndex::AddTrigrams(query.m_Required, term);
+            }
+        }
+
+        return query;
+    }
+
+    bool ConsoleQuery::MayMatch(const ConsoleSearchIndex::Summary& block) const
+    {
+        if (!m_Error.empty())
+            return false;
+
+        if (m_Required.Tags && !(block.Tags & m_Required.Tags))
+            return false;
+
+        if (!(block.Levels & m_Required.Levels))
+            return false;
+
+        for (size_t i = 0; i < block.Trigrams.size(); i++)
+        {
+            if ((block.Trigrams[i] & m_Required.Trigrams[i]) != m_Required.Trigrams[i])
+                return false;
+        }
+
+        return true;
+    }
+
+    bool ConsoleQuery::Matches(std::string_view tag, std::string_view message, Log::Level level) const
+    {
+        if (!m_Error.empty() || level < m_MinLevel)
+            return false;
+
+        if (!m_Tags.empty() && std::none_of(m_Tags.begin(), m_Tags.end(), [tag](const std::string& name) { return Utils::EqualsIgnoreCase(tag, name); }))
+            return false;
+
+        for (const std::string& term : m_Include)
+        {
+            if (!Utils::ContainsIgnoreCase(message, term))
+                return false;
+        }
+
+        for (const std::string& term : m_Exclude)
+        {
+            if (Utils::ContainsIgnoreCase(message, term))
+                return false;
+        }
+
+        if (m_Regex && !std::regex_search(message.data(), message.data() + message.size(), *m_Regex))
+            return false;
+
+        return true;
+    }
+
+} // namespace Utopia::UI
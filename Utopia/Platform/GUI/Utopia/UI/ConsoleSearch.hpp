@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Utopia/Core/Log.hpp"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Utopia::UI {
+
+    // Coarse search index over the messages of a ConsoleHistory.
+    //
+    // Messages are grouped into blocks of BlockSize consecutive sequence numbers. Each block keeps
+    // a summary: a bloom filter of the (lowercase) trigrams of its message text plus bit masks of
+    // its tags and levels. A query rules out every block whose summary lacks one of its required
+    // bits, so searching for a rare word or tag only scans the few blocks that may contain it.
+    // Summaries are about 16 bytes per message and are dropped along with evicted messages.
+    //
+    // Block size and filter width are checked with UtopiaBenchmarks (ConsoleSearchBenchmark): over
+    // 64 messages of ~100 varied characters a 4096 bit filter is ~70% full and rules out few blocks.
+    // 32 messages keep it at ~50% there and below 20% for typical templated log lines.
+    //
+    // Not thread-safe; Console guards it with the same lock as its history.
+    class ConsoleSearchIndex
+    {
+    public:
+        static constexpr uint64_t BlockSize = 32;
+        static constexpr uint32_t TrigramBits = 4096;
+
+        struct Summary
+        {
+            std::array<uint64_t, TrigramBits / 64> Trigrams{};
+            uint64_t Tags = 0;
+            uint32_t Levels = 0;
+        };
+
+    public:
+        void Add(uint64_t sequence, std::string_view tag, std::string_view message, Log::Level level);
+        // Drops the blocks that only hold messages before firstSequence
+        void Evict(uint64_t firstSequence);
+
+        // Summary of the block holding sequence, nullptr if it is not indexed
+        const Summary* GetBlock(uint64_t sequence) const;
+
+        static void AddTrigrams(Summary& summary, std::string_view text);
+        static uint64_t GetTagBit(std::string_view tag);
+        static uint32_t GetLevelBit(Log::Level level) { return 1u << (uint32_t)level; }
+
+    private:
+        std::deque<Summary> m_Blocks;
+        // Block number of m_Blocks.front()
+        uint64_t m_FirstBlock = 0;
+    };
+
+    // Parsed Console filter text. Terms are separated by spaces and must all match, case-insensitive:
+    //
+    //     word         the message contains word
+    //     -word        the message does not contain word
+    //     tag:Name     the message has this tag (several tag: terms match any of them)
+    //     level:warn   the message level is at least warn (trace, info, warn, error, fatal)
+    //     /regex/      the message matches the ECMAScript regular expression
+    //
+    // Immutable once parsed, so it can be shared with background searches.
+    class ConsoleQuery
+    {
+    public:
+        static ConsoleQuery Parse(std::string_view text);
+
+        // Set when the filter text is invalid (bad regex or level); such a query matches nothing
+        const std::string& GetError() const { return m_Error; }
+
+        // False if no message in a block with this summary can match
+        bool MayMatch(const ConsoleSearchIndex::Summary& block) const;
+        bool Matches(std::string_view tag, std::string_view message, Log::Level level) const;
+
+    private:
+        std::vector<std::string> m_Include;
+        std::vector<std::string> m_Exclude;
+        std::vector<std::string> m_Tags;
+        Log::Level m_MinLevel = Log::Level::Trace;
+        std::optional<std::regex> m_Regex;
+        std::string m_Error;
+
+        // Bits a block must have for one of its messages to match
+        ConsoleSearchIndex::Summary m_Required;
+    };
+
+} // namespace Utopia::UI
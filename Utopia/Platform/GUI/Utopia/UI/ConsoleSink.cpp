@@ -0,0 +1,68 @@
+#include "ConsoleSink.hpp"
+
+#include "Console.hpp"
+#include "Utopia/ImGui/ImGuiTheme.hpp"
+
+#include <string_view>
+
+namespace Utopia::UI {
+
+    namespace Utils {
+
+        static uint32_t LevelToColor(spdlog::level::level_enum level)
+        {
+            switch (level)
+            {
+            case spdlog::level::trace:
+            case spdlog::level::debug:    return Colors::Theme::textDarker;
+            case spdlog::level::info:     return Colors::Theme::text;
+            case spdlog::level::warn:     return Colors::Theme::accent;
+            case spdlog::level::err:      return Colors::Theme::textError;
+            case spdlog::level::critical: return Colors::Theme::error;
+            default:                      return Colors::Theme::text;
+            }
+        }
+
+        static Log::Level ToLogLevel(spdlog::level::level_enum level)
+        {
+            switch (level)
+            {
+            case spdlog::level::trace:
+            case spdlog::level::debug:    return Log::Level::Trace;
+            case spdlog::level::warn:     return Log::Level::Warn;
+            case spdlog::level::err:      return Log::Level::Error;
+            case spdlog::level::critical: return Log::Level::Fatal;
+            default:                      return Log::Level::Info;
+            }
+        }
+
+    } // namespace Utils
+
+    ConsoleSink::ConsoleSink(std::shared_ptr<Console> console)
+        : m_Console(std::move(console))
+    {
+    }
+
+    void ConsoleSink::log(const spdlog::details::log_msg& message)
+    {
+        if (!m_Console || !should_log(message.level))
+            return;
+
+        std::string_view text(message.payload.data(), message.payload.size());
+        std::string_view tag(message.logger_name.data(), message.logger_name.size());
+
+        // Tagged macros log "[tag] message"
+        if (text.starts_with('['))
+        {
+            const size_t end = text.find("] ");
+            if (end != std::string_view::npos && text.find('\n') > end)
+            {
+                tag = text.substr(1, end - 1);
+                text.remove_prefix(end + 2);
+            }
+        }
+
+        m_Console->AddRawMessage(tag, text, Utils::LevelToColor(message.level), message.level == spdlog::level::critical, Utils::ToLogLevel(message.level));
+    }
+
+} // namespace Utopia::UI
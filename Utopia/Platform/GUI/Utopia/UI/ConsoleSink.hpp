@@ -0,0 +1,36 @@
+#pragma once
+
+#include <spdlog/sinks/sink.h>
+
+#include <memory>
+
+namespace Utopia::UI {
+
+    class Console;
+
+    // spdlog sink that shows log records in a Console.
+    //
+    // A "[tag] " prefix on the record (as written by the tagged log macros) goes into the
+    // console's bold tag column, otherwise the logger name does; the level picks the color.
+    // Records are handed over through the console's lock-free ingestion queue without taking
+    // any lock, so logging threads never wait on the UI thread. Patterns and formatters are
+    // ignored, the console has its own layout.
+    //
+    //     Log::AddSink(std::make_shared<UI::ConsoleSink>(console));
+    class ConsoleSink final : public spdlog::sinks::sink
+    {
+    public:
+        explicit ConsoleSink(std::shared_ptr<Console> console);
+
+        void log(const spdlog::details::log_msg& message) override;
+        void flush() override {}
+        void set_pattern(const std::string&) override {}
+        void set_formatter(std::unique_ptr<spdlog::formatter>) override {}
+
+        const std::shared_ptr<Console>& GetConsole() const { return m_Console; }
+
+    private:
+        std::shared_ptr<Console> m_Console;
+    };
+
+} // namespace Utopia::UI
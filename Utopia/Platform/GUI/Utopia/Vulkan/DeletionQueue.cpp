@@ -0,0 +1,140 @@
+#include "DeletionQueue.hpp"
+
+#include "backends/imgui_impl_vulkan.h"
+
+namespace Utopia {
+
+	namespace Utils {
+
+		static uint32_t NextPowerOfTwo(uint32_t value)
+		{
+			uint32_t result = 1;
+			while (result < value)
+				result <<= 1;
+			return result;
+		}
+
+	}
+
+	void DeletionQueue::Init(VkDevice device, MemoryAllocator* allocator, uint32_t framesInFlight, uint32_t initialCapacity)
+	{
+		m_Device = device;
+		m_Allocator = allocator;
+		m_FramesInFlight = framesInFlight;
+
+		m_Ring.resize(Utils::NextPowerOfTwo(initialCapacity));
+		m_Retired.reserve(m_Ring.size());
+		m_Head = 0;
+		m_Tail = 0;
+		m_FrameNumber = 0;
+	}
+
+	void DeletionQueue::Shutdown()
+	{
+		Flush();
+
+		m_Ring.clear();
+		m_Ring.shrink_to_fit();
+		m_Retired.clear();
+		m_Retired.shrink_to_fit();
+		m_Device = nullptr;
+		m_Allocator = nullptr;
+	}
+
+	void DeletionQueue::BeginFrame()
+	{
+		{
+			std::scoped_lock<std::mutex> lock(m_Mutex);
+
+			m_FrameNumber++;
+
+			// Entries are pushed in frame order, so stop at the first one that is still in flight
+			const uint64_t mask = m_Ring.size() - 1;
+			m_Retired.clear();
+			while (m_Head != m_Tail)
+			{
+				const Entry& entry = m_Ring[m_Head & mask];
+				if (entry.Frame + m_FramesInFlight > m_FrameNumber)
+					break;
+
+				m_Retired.push_back(entry);
+				m_Head++;
+			}
+		}
+
+		Destroy(m_Retired);
+	}
+
+	void DeletionQueue::SetFramesInFlight(uint32_t framesInFlight)
+	{
+		std::scoped_lock<std::mutex> lock(m_Mutex);
+		m_FramesInFlight = framesInFlight;
+	}
+
+	void DeletionQueue::Flush()
+	{
+		{
+			std::scoped_lock<std::mutex> lock(m_Mutex);
+
+			const uint64_t mask = m_Ring.size() - 1;
+			m_Retired.clear();
+			for (; m_Head != m_Tail; m_Head++)
+				m_Retired.push_back(m_Ring[m_Head & mask]);
+		}
+
+		Destroy(m_Retired);
+		m_Retired.clear();
+	}
+
+	uint32_t DeletionQueue::GetPendingCount()
+	{
+		std::scoped_lock<std::mutex> lock(m_Mutex);
+		return (uint32_t)(m_Tail - m_Head);
+	}
+
+	void DeletionQueue::Push(Entry entry)
+	{
+		if (entry.Handle == 0)
+			return;
+
+		IM_ASSERT(m_Device && "DeletionQueue::Release called after Shutdown");
+		if (m_Tail - m_Head == m_Ring.size())
+			Grow();
+
+		entry.Frame = m_FrameNumber;
+		m_Ring[m_Tail & (m_Ring.size() - 1)] = entry;
+		m_Tail++;
+	}
+
+	void DeletionQueue::Grow()
+	{
+		const uint64_t count = m_Tail - m_Head;
+		const uint64_t oldMask = m_Ring.size() - 1;
+
+		std::vector<Entry> ring(m_Ring.empty() ? 64 : m_Ring.size() * 2);
+		for (uint64_t i = 0; i < count; i++)
+			ring[i] = m_Ring[(m_Head + i) & oldMask];
+
+		m_Ring = std::move(ring);
+		m_Head = 0;
+		m_Tail = count;
+	}
+
+	void DeletionQueue::Destroy(const std::vector<Entry>& entries)
+	{
+		for (const Entry& entry : entries)
+		{
+			switch (entry.Type)
+			{
+			case ResourceType::Sampler:       vkDestroySampler(m_Device, (VkSampler)entry.Handle, nullptr); break;
+			case ResourceType::ImageView:     vkDestroyImageView(m_Device, (VkImageView)entry.Handle, nullptr); break;
+			case ResourceType::Image:         vkDestroyImage(m_Device, (VkImage)entry.Handle, nullptr); break;
+			case ResourceType::Buffer:        vkDestroyBuffer(m_Device, (VkBuffer)entry.Handle, nullptr); break;
+			case ResourceType::DeviceMemory:  vkFreeMemory(m_Device, (VkDeviceMemory)entry.Handle, nullptr); break;
+			case ResourceType::DescriptorSet: ImGui_ImplVulkan_RemoveTexture((VkDescriptorSet)entry.Handle); break;
+			case ResourceType::Allocation:    m_Allocator->Free((MemoryAllocation*)(uintptr_t)entry.Handle); break;
+			}
+		}
+	}
+
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include "MemoryAllocator.hpp"
+
+#include <cstdint>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+namespace Utopia {
+
+	// Deferred destruction of Vulkan objects that may still be referenced by frames in flight.
+	//
+	// Handles are stored as plain (handle, type, frame) records in a preallocated ring and
+	// destroyed in one batch once the frame they were released in can no longer be executing
+	// on the GPU. Release() may be called from any thread.
+	class DeletionQueue
+	{
+	public:
+		enum class ResourceType : uint8_t
+		{
+			Sampler = 0,
+			ImageView,
+			Image,
+			Buffer,
+			DeviceMemory,
+			DescriptorSet, // ImGui texture descriptor set from ImGui_ImplVulkan_AddTexture
+			Allocation     // MemoryAllocator sub-allocation
+		};
+
+		// Handle tagged with what it is. On 32-bit platforms every non-dispatchable handle is a
+		// plain uint64_t, so the type can't be told from the handle's C++ type.
+		template<ResourceType Type>
+		struct TaggedHandle
+		{
+			uint64_t Value;
+
+			template<typename T>
+			explicit TaggedHandle(T handle)
+			{
+				if constexpr (std::is_pointer_v<T>)
+					Value = (uint64_t)(uintptr_t)handle;
+				else
+					Value = (uint64_t)handle;
+			}
+		};
+
+		using SamplerHandle = TaggedHandle<ResourceType::Sampler>;
+		using ImageViewHandle = TaggedHandle<ResourceType::ImageView>;
+		using ImageHandle = TaggedHandle<ResourceType::Image>;
+		using BufferHandle = TaggedHandle<ResourceType::Buffer>;
+		using DeviceMemoryHandle = TaggedHandle<ResourceType::DeviceMemory>;
+		using DescriptorSetHandle = TaggedHandle<ResourceType::DescriptorSet>;
+		using AllocationHandle = TaggedHandle<ResourceType::Allocation>;
+
+	public:
+		void Init(VkDevice device, MemoryAllocator* allocator, uint32_t framesInFlight, uint32_t initialCapacity = 1024);
+		void Shutdown();
+
+		// Null handles are ignored. All handles of one call are recorded under a single lock, e.g.
+		// Release(DeletionQueue::BufferHandle(buffer), DeletionQueue::DeviceMemoryHandle(memory)).
+		// Nothing can be released anymore after Shutdown().
+		template<ResourceType... Types>
+		void Release(TaggedHandle<Types>... handles)
+		{
+			std::scoped_lock<std::mutex> lock(m_Mutex);
+			(Push({ handles.Value, 0, Types }), ...);
+		}
+
+		// Main thread, once per frame after waiting on that frame's fence. Destroys everything
+		// released at least framesInFlight frames ago.
+		void BeginFrame();
+
+		// Swapchain image count can change when the swapchain is rebuilt
+		void SetFramesInFlight(uint32_t framesInFlight);
+
+		// Destroys everything immediately. Device must be idle.
+		void Flush();
+
+		uint32_t GetPendingCount();
+
+	private:
+		struct Entry
+		{
+			uint64_t Handle;
+			uint64_t Frame;
+			ResourceType Type;
+		};
+
+		void Push(Entry entry);
+		void Grow();
+		void Destroy(const std::vector<Entry>& entries);
+
+	private:
+		VkDevice m_Device = nullptr;
+		MemoryAllocator* m_Allocator = nullptr;
+		uint32_t m_FramesInFlight = 0;
+
+		std::mutex m_Mutex;
+
+		// Power-of-two sized ring, m_Head/m_Tail are monotonically increasing
+		std::vector<Entry> m_Ring;
+		uint64_t m_Head = 0;
+		uint64_t m_Tail = 0;
+		uint64_t m_FrameNumber = 0;
+
+		// Entries taken out of the ring this frame; destroyed outside the lock. Main thread only.
+		std::vector<Entry> m_Retired;
+	};
+
+}
@@ -0,0 +1,160 @@
+#include "FramePacer.hpp"
+
+#include "Utopia/ApplicationGUI.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#ifdef UT_PLATFORM_WINDOWS
+	#include <Windows.h>
+
+	#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+		#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+	#endif
+#endif
+
+namespace Utopia {
+
+	void FramePacer::Init(VkDevice device, uint32_t framesInFlight, float targetFrameRate)
+	{
+		m_Device = device;
+		SetFramesInFlight(framesInFlight);
+		SetTargetFrameRate(targetFrameRate);
+
+		VkFenceCreateInfo fenceInfo = {};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		for (Frame& frame : m_Frames)
+		{
+			VkResult err = vkCreateFence(m_Device, &fenceInfo, nullptr, &frame.Fence);
+			check_vk_result(err);
+		}
+
+#ifdef UT_PLATFORM_WINDOWS
+		// High resolution timers need Windows 10 1803, older versions get a regular one
+		m_Timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+		if (!m_Timer)
+			m_Timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+#endif
+	}
+
+	void FramePacer::Shutdown()
+	{
+		for (Frame& frame : m_Frames)
+		{
+			vkDestroyFence(m_Device, frame.Fence, nullptr);
+			frame.Fence = nullptr;
+		}
+
+		m_FirstFrame = 0;
+		m_PendingFrames = 0;
+
+#ifdef UT_PLATFORM_WINDOWS
+		if (m_Timer)
+			CloseHandle((HANDLE)m_Timer);
+#endif
+		m_Timer = nullptr;
+	}
+
+	void FramePacer::SetFramesInFlight(uint32_t framesInFlight)
+	{
+		m_FramesInFlight = std::clamp<uint32_t>(framesInFlight, 1, MaxFramesInFlight);
+	}
+
+	void FramePacer::SetTargetFrameRate(float framesPerSecond)
+	{
+		m_TargetFrameRate = std::max(framesPerSecond, 0.0f);
+	}
+
+	void FramePacer::BeginFrame()
+	{
+		// Frames that have finished since the last call
+		const Clock::time_point now = Clock::now();
+		while (m_PendingFrames > 0 && vkGetFenceStatus(m_Device, m_Frames[m_FirstFrame].Fence) == VK_SUCCESS)
+			RetireOldestFrame(now);
+
+		while (m_PendingFrames >= m_FramesInFlight)
+		{
+			VkResult err = vkWaitForFences(m_Device, 1, &m_Frames[m_FirstFrame].Fence, VK_TRUE, UINT64_MAX);
+			check_vk_result(err);
+			RetireOldestFrame(Clock::now());
+		}
+
+		if (m_TargetFrameRate > 0.0f)
+		{
+			const auto interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_TargetFrameRate));
+			SleepUntil(m_NextFrameTime);
+
+			// A frame that ran late starts a new schedule rather than being caught up on in a burst
+			const Clock::time_point frameTime = Clock::now();
+			m_NextFrameTime = frameTime - m_NextFrameTime < interval ? m_NextFrameTime + interval : frameTime + interval;
+		}
+	}
+
+	FramePacer::Clock::time_point FramePacer::InputPolled()
+	{
+		return Clock::now();
+	}
+
+	void FramePacer::EndFrame(VkQueue queue, Clock::time_point inputTime)
+	{
+		// BeginFrame() keeps this below the limit, unless it was skipped
+		if (m_PendingFrames == MaxFramesInFlight)
+		{
+			VkResult err = vkWaitForFences(m_Device, 1, &m_Frames[m_FirstFrame].Fence, VK_TRUE, UINT64_MAX);
+			check_vk_result(err);
+			RetireOldestFrame(Clock::now());
+		}
+
+		Frame& frame = m_Frames[(m_FirstFrame + m_PendingFrames) % MaxFramesInFlight];
+		frame.InputTime = inputTime;
+
+		VkResult err = vkResetFences(m_Device, 1, &frame.Fence);
+		check_vk_result(err);
+
+		// An empty submission signals its fence once all work submitted before it has completed
+		err = vkQueueSubmit(queue, 0, nullptr, frame.Fence);
+		check_vk_result(err);
+
+		m_PendingFrames++;
+	}
+
+	void FramePacer::RetireOldestFrame(Clock::time_point completionTime)
+	{
+		const Frame& frame = m_Frames[m_FirstFrame];
+		m_LastLatency = std::chrono::duration<float>(completionTime - frame.InputTime).count();
+		m_Latency = m_Latency > 0.0f ? m_Latency + (m_LastLatency - m_Latency) * 0.1f : m_LastLatency;
+
+		m_FirstFrame = (m_FirstFrame + 1) % MaxFramesInFlight;
+		m_PendingFrames--;
+	}
+
+	void FramePacer::SleepUntil(Clock::time_point deadline)
+	{
+		// OS sleeps overshoot by up to a scheduler tick; the last stretch is spun instead
+#ifdef UT_PLATFORM_WINDOWS
+		constexpr auto spinTime = std::chrono::microseconds(1000);
+#else
+		constexpr auto spinTime = std::chrono::microseconds(250);
+#endif
+
+		const Clock::duration sleepTime = deadline - Clock::now() - spinTime;
+		if (sleepTime > Clock::duration::zero())
+		{
+#ifdef UT_PLATFORM_WINDOWS
+			LARGE_INTEGER dueTime;
+			// Relative, in 100 ns units
+			dueTime.QuadPart = -(LONGLONG)(std::chrono::duration_cast<std::chrono::nanoseconds>(sleepTime).count() / 100);
+			if (m_Timer && SetWaitableTimer((HANDLE)m_Timer, &dueTime, 0, nullptr, nullptr, FALSE))
+				WaitForSingleObject((HANDLE)m_Timer, INFINITE);
+			else
+				std::this_thread::sleep_for(sleepTime);
+#else
+			std::this_thread::sleep_for(sleepTime);
+#endif
+		}
+
+		while (Clock::now() < deadline)
+			std::this_thread::yield();
+	}
+
+}
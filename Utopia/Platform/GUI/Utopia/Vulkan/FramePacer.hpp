@@ -0,0 +1,85 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace Utopia {
+
+	// Limits how far the CPU runs ahead of the GPU and caps the frame rate.
+	//
+	// Every frame is followed by an empty queue submission with a fence of its own, which signals
+	// once all work of that frame has executed. BeginFrame() waits until fewer than the frames in
+	// flight limit are still executing, then sleeps off the rest of the frame-rate budget; input
+	// is polled right after, so a low limit means input is sampled as late as possible. 1 frame in
+	// flight gives the lowest latency, more frames smooth out CPU/GPU load at the cost of latency.
+	//
+	// Latency is measured from InputPolled() to the GPU finishing that frame. Completion is
+	// noticed at the next BeginFrame() at the latest, and presentation/compositor delay is not
+	// included, so it is an estimate of input-to-photon latency rather than the full value.
+	//
+	// Main thread only.
+	class FramePacer
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		static constexpr uint32_t MaxFramesInFlight = 4;
+
+	public:
+		void Init(VkDevice device, uint32_t framesInFlight, float targetFrameRate);
+		// The device must be idle
+		void Shutdown();
+
+		// Clamped to [1, MaxFramesInFlight]
+		void SetFramesInFlight(uint32_t framesInFlight);
+		uint32_t GetFramesInFlight() const { return m_FramesInFlight; }
+
+		// Frames per second, 0 for no limit
+		void SetTargetFrameRate(float framesPerSecond);
+		float GetTargetFrameRate() const { return m_TargetFrameRate; }
+
+		// Before input is polled for the next frame
+		void BeginFrame();
+		// Right after input has been polled, returns the frame's input time
+		Clock::time_point InputPolled();
+		// After everything of the frame has been submitted to queue. inputTime is what
+		// InputPolled() returned for it; frames may end after the next one has polled input.
+		void EndFrame(VkQueue queue, Clock::time_point inputTime);
+
+		// Smoothed and most recent input-to-GPU-completion time, in seconds
+		float GetLatency() const { return m_Latency; }
+		float GetLastLatency() const { return m_LastLatency; }
+
+	private:
+		struct Frame
+		{
+			VkFence Fence = nullptr;
+			Clock::time_point InputTime;
+		};
+
+		void RetireOldestFrame(Clock::time_point completionTime);
+		void SleepUntil(Clock::time_point deadline);
+
+	private:
+		VkDevice m_Device = nullptr;
+
+		// Ring of submitted frames, oldest at m_FirstFrame
+		std::array<Frame, MaxFramesInFlight> m_Frames;
+		uint32_t m_FirstFrame = 0;
+		uint32_t m_PendingFrames = 0;
+		uint32_t m_FramesInFlight = 2;
+
+		float m_TargetFrameRate = 0.0f;
+		Clock::time_point m_NextFrameTime;
+
+		float m_Latency = 0.0f;
+		float m_LastLatency = 0.0f;
+
+		// High resolution waitable timer on Windows, where Sleep() has scheduler tick granularity
+		void* m_Timer = nullptr;
+	};
+
+}
@@ -0,0 +1,143 @@
+#include "GpuProfiler.hpp"
+
+#include "Utopia/ApplicationGUI.hpp"
+#include "Utopia/Core/Log.hpp"
+
+#include <algorithm>
+
+namespace Utopia {
+
+	void GpuProfiler::Init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t frameCount)
+	{
+		m_Device = device;
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		uint32_t familyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+		const uint32_t validBits = queueFamily < familyCount ? families[queueFamily].timestampValidBits : 0;
+		if (validBits == 0 || properties.limits.timestampPeriod <= 0.0f)
+		{
+			UT_CORE_WARN_TAG("GpuProfiler", "Timestamp queries are not supported, GPU timings are unavailable");
+			return;
+		}
+
+		m_TimestampPeriod = properties.limits.timestampPeriod;
+		m_TimestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+		SetFrameCount(frameCount);
+	}
+
+	void GpuProfiler::Shutdown()
+	{
+		if (m_QueryPool)
+			vkDestroyQueryPool(m_Device, m_QueryPool, nullptr);
+
+		m_QueryPool = nullptr;
+		m_Frames.clear();
+		m_Results = {};
+	}
+
+	void GpuProfiler::SetFrameCount(uint32_t frameCount)
+	{
+		if (m_TimestampPeriod <= 0.0f)
+			return;
+
+		frameCount = std::max<uint32_t>(frameCount, 1);
+		if (m_QueryPool && frameCount == (uint32_t)m_Frames.size())
+			return;
+
+		if (m_QueryPool)
+			vkDestroyQueryPool(m_Device, m_QueryPool, nullptr);
+
+		VkQueryPoolCreateInfo info = {};
+		info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+		info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+		info.queryCount = frameCount * MaxScopes * 2;
+		VkResult err = vkCreateQueryPool(m_Device, &info, nullptr, &m_QueryPool);
+		check_vk_result(err);
+
+		m_Frames.assign(frameCount, Frame());
+		m_CurrentFrame = 0;
+	}
+
+	void GpuProfiler::BeginFrame(uint32_t frameSlot, VkCommandBuffer commandBuffer, uint32_t layerCount)
+	{
+		if (!m_QueryPool)
+			return;
+
+		m_CurrentFrame = frameSlot % (uint32_t)m_Frames.size();
+		CollectResults(m_CurrentFrame);
+
+		Frame& frame = m_Frames[m_CurrentFrame];
+		frame.Written = true;
+		frame.ScopeCount = FirstLayerScope + std::min(layerCount, MaxTimedLayers);
+
+		vkCmdResetQueryPool(commandBuffer, m_QueryPool, GetQuery(m_CurrentFrame, 0, false), MaxScopes * 2);
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, GetQuery(m_CurrentFrame, FrameScope, false));
+	}
+
+	void GpuProfiler::EndFrame(VkCommandBuffer commandBuffer)
+	{
+		if (!m_QueryPool)
+			return;
+
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPool, GetQuery(m_CurrentFrame, FrameScope, true));
+	}
+
+	void GpuProfiler::BeginScope(VkCommandBuffer commandBuffer, uint32_t scope)
+	{
+		if (!m_QueryPool || scope >= m_Frames[m_CurrentFrame].ScopeCount)
+			return;
+
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, GetQuery(m_CurrentFrame, scope, false));
+	}
+
+	void GpuProfiler::EndScope(VkCommandBuffer commandBuffer, uint32_t scope)
+	{
+		if (!m_QueryPool || scope >= m_Frames[m_CurrentFrame].ScopeCount)
+			return;
+
+		vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPool, GetQuery(m_CurrentFrame, scope, true));
+	}
+
+	void GpuProfiler::CollectResults(uint32_t frameSlot)
+	{
+		Frame& frame = m_Frames[frameSlot];
+		if (!frame.Written)
+			return;
+
+		// Without VK_QUERY_RESULT_WAIT_BIT, so a scope that was skipped (e.g. a layer removed
+		// mid-frame) is reported unavailable instead of blocking
+		const uint32_t queryCount = frame.ScopeCount * 2;
+		m_QueryData.resize(queryCount * 2);
+		VkResult err = vkGetQueryPoolResults(m_Device, m_QueryPool, GetQuery(frameSlot, 0, false), queryCount, m_QueryData.size() * sizeof(uint64_t), m_QueryData.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+		if (err != VK_SUCCESS && err != VK_NOT_READY)
+		{
+			check_vk_result(err);
+			return;
+		}
+
+		auto getTime = [this](uint32_t scope) -> float
+		{
+			const uint64_t* begin = &m_QueryData[scope * 4];
+			const uint64_t* end = begin + 2;
+			if (!begin[1] || !end[1])
+				return 0.0f;
+
+			const uint64_t ticks = (end[0] - begin[0]) & m_TimestampMask;
+			return (float)((double)ticks * m_TimestampPeriod / 1'000'000.0);
+		};
+
+		m_Results.FrameTime = getTime(FrameScope);
+		m_Results.ImGuiTime = getTime(ImGuiScope);
+		m_Results.LayerTimes.resize(frame.ScopeCount - FirstLayerScope);
+		for (uint32_t i = 0; i < (uint32_t)m_Results.LayerTimes.size(); i++)
+			m_Results.LayerTimes[i] = getTime(FirstLayerScope + i);
+	}
+
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace Utopia {
+
+	// GPU timings of the frame render pass from timestamp queries.
+	//
+	// Every frame slot (swapchain image) owns a fixed range of one query pool, two queries per
+	// scope: the whole frame, the ImGui draw and each layer's OnRender. Results are collected
+	// when the slot comes around again, after its fence has been waited on, so they trail the
+	// CPU by at least a frame and reading them never stalls. Scopes whose queries are not
+	// available yet are reported as 0.
+	//
+	// Devices or queues without timestamp support turn every call into a no-op, IsSupported()
+	// is false and the results stay empty.
+	class GpuProfiler
+	{
+	public:
+		static constexpr uint32_t FrameScope = 0;
+		static constexpr uint32_t ImGuiScope = 1;
+		static constexpr uint32_t FirstLayerScope = 2;
+		static constexpr uint32_t MaxScopes = 64;
+		// Layers past this are not timed
+		static constexpr uint32_t MaxTimedLayers = MaxScopes - FirstLayerScope;
+
+		// Milliseconds
+		struct Results
+		{
+			float FrameTime = 0.0f;
+			float ImGuiTime = 0.0f;
+			// In layer stack order
+			std::vector<float> LayerTimes;
+		};
+
+	public:
+		void Init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamily, uint32_t frameCount);
+		// The device must be idle
+		void Shutdown();
+
+		// Swapchain image count can change when the swapchain is rebuilt. The device must be idle;
+		// results of frames still in the pool are dropped.
+		void SetFrameCount(uint32_t frameCount);
+
+		bool IsSupported() const { return m_QueryPool != nullptr; }
+
+		// On the frame's primary command buffer, outside the render pass, once the previous
+		// submission of frameSlot has completed. Collects its results, resets the slot's queries
+		// and writes the frame begin timestamp.
+		void BeginFrame(uint32_t frameSlot, VkCommandBuffer commandBuffer, uint32_t layerCount);
+		// After the render pass has ended
+		void EndFrame(VkCommandBuffer commandBuffer);
+
+		// Any thread, on a command buffer of the current frame; each scope once per frame
+		void BeginScope(VkCommandBuffer commandBuffer, uint32_t scope);
+		void EndScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+		// Most recently collected frame
+		const Results& GetResults() const { return m_Results; }
+
+	private:
+		struct Frame
+		{
+			bool Written = false;
+			uint32_t ScopeCount = 0;
+		};
+
+		void CollectResults(uint32_t frameSlot);
+		uint32_t GetQuery(uint32_t frameSlot, uint32_t scope, bool end) const { return frameSlot * MaxScopes * 2 + scope * 2 + (end ? 1 : 0); }
+
+	private:
+		VkDevice m_Device = nullptr;
+		VkQueryPool m_QueryPool = nullptr;
+		// Nanoseconds per tick
+		float m_TimestampPeriod = 0.0f;
+		uint64_t m_TimestampMask = 0;
+
+		std::vector<Frame> m_Frames;
+		uint32_t m_CurrentFrame = 0;
+
+		Results m_Results;
+		// (value, availability) pairs, reused between collections
+		std::vector<uint64_t> m_QueryData;
+	};
+
+}
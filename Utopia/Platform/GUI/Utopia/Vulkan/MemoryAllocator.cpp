@@ -0,0 +1,452 @@
+#include "MemoryAllocator.hpp"
+
+#include "Utopia/ApplicationGUI.hpp"
+
+#include <algorithm>
+
+namespace Utopia {
+
+	struct MemoryBlock
+	{
+		struct Range
+		{
+			VkDeviceSize Offset;
+			VkDeviceSize Size;
+		};
+
+		VkDeviceMemory Memory = nullptr;
+		VkDeviceSize Size = 0;
+		VkDeviceSize Used = 0;
+		uint32_t MemoryType = 0;
+		MemoryAllocator::Tiling Tiling = MemoryAllocator::Tiling::Optimal;
+		void* Mapped = nullptr;
+
+		// Sorted by offset, adjacent ranges are always merged
+		std::vector<Range> FreeRanges;
+		std::vector<MemoryAllocation*> Allocations;
+	};
+
+	namespace Utils {
+
+		static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return (value + alignment - 1) / alignment * alignment;
+		}
+
+		// First fit. Alignment padding in front of the allocation stays a free range.
+		static bool AllocateFromBlock(MemoryBlock& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& outOffset)
+		{
+			for (size_t i = 0; i < block.FreeRanges.size(); i++)
+			{
+				const MemoryBlock::Range range = block.FreeRanges[i];
+				const VkDeviceSize offset = AlignUp(range.Offset, alignment);
+				const VkDeviceSize padding = offset - range.Offset;
+				if (padding + size > range.Size)
+					continue;
+
+				const MemoryBlock::Range tail = { offset + size, range.Size - padding - size };
+				if (padding > 0)
+				{
+					block.FreeRanges[i].Size = padding;
+					if (tail.Size > 0)
+						block.FreeRanges.insert(block.FreeRanges.begin() + i + 1, tail);
+				}
+				else if (tail.Size > 0)
+				{
+					block.FreeRanges[i] = tail;
+				}
+				else
+				{
+					block.FreeRanges.erase(block.FreeRanges.begin() + i);
+				}
+
+				block.Used += size;
+				outOffset = offset;
+				return true;
+			}
+
+			return false;
+		}
+
+		static void FreeToBlock(MemoryBlock& block, VkDeviceSize offset, VkDeviceSize size)
+		{
+			auto next = std::lower_bound(block.FreeRanges.begin(), block.FreeRanges.end(), offset,
+				[](const MemoryBlock::Range& range, VkDeviceSize offset) { return range.Offset < offset; });
+
+			const bool mergePrev = next != block.FreeRanges.begin() && std::prev(next)->Offset + std::prev(next)->Size == offset;
+			const bool mergeNext = next != block.FreeRanges.end() && offset + size == next->Offset;
+
+			if (mergePrev && mergeNext)
+			{
+				std::prev(next)->Size += size + next->Size;
+				block.FreeRanges.erase(next);
+			}
+			else if (mergePrev)
+			{
+				std::prev(next)->Size += size;
+			}
+			else if (mergeNext)
+			{
+				next->Offset = offset;
+				next->Size += size;
+			}
+			else
+			{
+				block.FreeRanges.insert(next, { offset, size });
+			}
+
+			block.Used -= size;
+		}
+
+	}
+
+	MemoryAllocator::MemoryAllocator() = default;
+	MemoryAllocator::~MemoryAllocator() = default;
+
+	void MemoryAllocator::Init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize preferredBlockSize)
+	{
+		m_PhysicalDevice = physicalDevice;
+		m_Device = device;
+		m_PreferredBlockSize = preferredBlockSize;
+
+		vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &m_MemoryProperties);
+	}
+
+	void MemoryAllocator::Shutdown()
+	{
+		std::scoped_lock<std::mutex> lock(m_Mutex);
+
+		for (Pool& pool : m_Pools)
+		{
+			for (auto& block : pool.Blocks)
+			{
+				IM_ASSERT(block->Allocations.empty() && "Device memory allocations leaked");
+				for (MemoryAllocation* allocation : block->Allocations)
+					delete allocation;
+
+				DestroyBlock(block.get());
+			}
+			pool.Blocks.clear();
+		}
+
+		m_Statistics = {};
+	}
+
+	MemoryAllocation* MemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, Tiling tiling)
+	{
+		const uint32_t memoryType = FindMemoryType(requirements.memoryTypeBits, properties);
+		if (memoryType == 0xffffffff)
+			return nullptr;
+
+		std::scoped_lock<std::mutex> lock(m_Mutex);
+
+		if (requirements.size > GetBlockSize(memoryType) / 2)
+			return AllocateDedicated(requirements.size, memoryType);
+
+		Pool& pool = GetPool(memoryType, tiling);
+		if (MemoryAllocation* allocation = AllocateFromPool(pool, requirements.size, requirements.alignment, nullptr))
+			return allocation;
+
+		MemoryBlock* block = CreateBlock(pool, memoryType, tiling);
+		if (!block)
+			return nullptr;
+
+		return AllocateFromPool(pool, requirements.size, requirements.alignment, nullptr);
+	}
+
+	void MemoryAllocator::Free(MemoryAllocation* allocation)
+	{
+		if (!allocation)
+			return;
+
+		std::scoped_lock<std::mutex> lock(m_Mutex);
+		if (allocation->Pinned)
+		{
+			// Defragment() is moving it, see MemoryAllocation::Pinned
+			allocation->FreePending = true;
+			return;
+		}
+
+		FreeLocked(allocation);
+	}
+
+	void* MemoryAllocator::Map(MemoryAllocation* allocation)
+	{
+		if (allocation->Mapped)
+			return allocation->Mapped;
+
+		IM_ASSERT(m_MemoryProperties.memoryTypes[allocation->MemoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+
+		std::scoped_lock<std::mutex> lock(m_Mutex);
+
+		VkResult err;
+		if (MemoryBlock* block = allocation->Block)
+		{
+			// A block can only be mapped once, so it is mapped as a whole and shared
+			if (!block->Mapped)
+			{
+				err = vkMapMemory(m_Device, block->Memory, 0, VK_WHOLE_SIZE, 0, &block->Mapped);
+				check_vk_result(err);
+			}
+			allocation->Mapped = (uint8_t*)block->Mapped + allocation->Offset;
+		}
+		else
+		{
+			err = vkMapMemory(m_Device, allocation->Memory, 0, VK_WHOLE_SIZE, 0, &allocation->Mapped);
+			check_vk_result(err);
+		}
+
+		return allocation->Mapped;
+	}
+
+	uint32_t MemoryAllocator::Defragment(const MoveCallback& callback, uint32_t maxMoves)
+	{
+		uint32_t moves = 0;
+
+		for (Pool& pool : m_Pools)
+		{
+			std::vector<MemoryAllocation*> candidates;
+			MemoryBlock* source = nullptr;
+			{
+				std::scoped_lock<std::mutex> lock(m_Mutex);
+				if (pool.Blocks.size() < 2)
+					continue;
+
+				// Least used block that still has something to move
+				for (auto& block : pool.Blocks)
+				{
+					if (block->Used > 0 && (!source || block->Used < source->Used))
+						source = block.get();
+				}
+				if (!source)
+					continue;
+
+				candidates = source->Allocations;
+			}
+
+			// The callback may take the lock itself (Free, Map), so it runs unlocked with the
+			// allocation pinned. Candidates are only compared, never dereferenced, until they
+			// are found in the source block again under the lock.
+			for (MemoryAllocation* allocation : candidates)
+			{
+				if (moves == maxMoves)
+					return moves;
+
+				MemoryAllocation* destination = nullptr;
+				{
+					std::scoped_lock<std::mutex> lock(m_Mutex);
+
+					// Emptied and destroyed in the meantime
+					const bool sourceAlive = std::any_of(pool.Blocks.begin(), pool.Blocks.end(), [source](const auto& block) { return block.get() == source; });
+					if (!sourceAlive)
+						break;
+
+					// Freed in the meantime
+					if (std::find(source->Allocations.begin(), source->Allocations.end(), allocation) == source->Allocations.end())
+						continue;
+
+					destination = AllocateFromPool(pool, allocation->Size, allocation->Alignment, source);
+
+					// No room elsewhere for this one, smaller ones may still fit
+					if (!destination)
+						continue;
+
+					allocation->Pinned = true;
+				}
+
+				const bool moved = callback(allocation, destination);
+
+				std::scoped_lock<std::mutex> lock(m_Mutex);
+				allocation->Pinned = false;
+				if (allocation->FreePending)
+					FreeLocked(allocation);
+
+				if (moved)
+					moves++;
+				else
+					FreeLocked(destination);
+			}
+		}
+
+		return moves;
+	}
+
+	MemoryAllocator::Statistics MemoryAllocator::GetStatistics()
+	{
+		std::scoped_lock<std::mutex> lock(m_Mutex);
+
+		Statistics total;
+		for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+		{
+			const Statistics& stats = m_Statistics[i];
+			total.BlockCount += stats.BlockCount;
+			total.AllocationCount += stats.AllocationCount;
+			total.DedicatedAllocationCount += stats.DedicatedAllocationCount;
+			total.ReservedBytes += stats.ReservedBytes;
+			total.UsedBytes += stats.UsedBytes;
+		}
+
+		return total;
+	}
+
+	MemoryAllocator::Statistics MemoryAllocator::GetStatistics(uint32_t memoryType)
+	{
+		std::scoped_lock<std::mutex> lock(m_Mutex);
+		return m_Statistics[memoryType];
+	}
+
+	uint32_t MemoryAllocator::FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const
+	{
+		for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; i++)
+		{
+			if ((m_MemoryProperties.memoryTypes[i].propertyFlags & properties) == properties && typeBits & (1 << i))
+				return i;
+		}
+
+		return 0xffffffff;
+	}
+
+	VkDeviceSize MemoryAllocator::GetBlockSize(uint32_t memoryType) const
+	{
+		// Small heaps (e.g. the 256MB device local + host visible heap) get proportionally smaller blocks
+		const uint32_t heapIndex = m_MemoryProperties.memoryTypes[memoryType].heapIndex;
+		const VkDeviceSize heapSize = m_MemoryProperties.memoryHeaps[heapIndex].size;
+		return std::min(m_PreferredBlockSize, heapSize / 8);
+	}
+
+	MemoryAllocation* MemoryAllocator::AllocateDedicated(VkDeviceSize size, uint32_t memoryType)
+	{
+		VkMemoryAllocateInfo info = {};
+		info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		info.allocationSize = size;
+		info.memoryTypeIndex = memoryType;
+
+		VkDeviceMemory memory = nullptr;
+		VkResult err = vkAllocateMemory(m_Device, &info, nullptr, &memory);
+		if (err != VK_SUCCESS)
+			return nullptr;
+
+		MemoryAllocation* allocation = new MemoryAllocation();
+		allocation->Memory = memory;
+		allocation->Size = size;
+		allocation->MemoryType = memoryType;
+
+		Statistics& stats = m_Statistics[memoryType];
+		stats.AllocationCount++;
+		stats.DedicatedAllocationCount++;
+		stats.ReservedBytes += size;
+		stats.UsedBytes += size;
+
+		return allocation;
+	}
+
+	MemoryAllocation* MemoryAllocator::AllocateFromPool(Pool& pool, VkDeviceSize size, VkDeviceSize alignment, const MemoryBlock* exclude)
+	{
+		for (auto& block : pool.Blocks)
+		{
+			if (block.get() == exclude || block->Size - block->Used < size)
+				continue;
+
+			VkDeviceSize offset;
+			if (!Utils::AllocateFromBlock(*block, size, alignment, offset))
+				continue;
+
+			MemoryAllocation* allocation = new MemoryAllocation();
+			allocation->Memory = block->Memory;
+			allocation->Offset = offset;
+			allocation->Size = size;
+			allocation->Alignment = alignment;
+			allocation->MemoryType = block->MemoryType;
+			allocation->Block = block.get();
+			if (block->Mapped)
+				allocation->Mapped = (uint8_t*)block->Mapped + offset;
+			block->Allocations.push_back(allocation);
+
+			Statistics& stats = m_Statistics[block->MemoryType];
+			stats.AllocationCount++;
+			stats.UsedBytes += size;
+
+			return allocation;
+		}
+
+		return nullptr;
+	}
+
+	MemoryBlock* MemoryAllocator::CreateBlock(Pool& pool, uint32_t memoryType, Tiling tiling)
+	{
+		const VkDeviceSize size = GetBlockSize(memoryType);
+
+		VkMemoryAllocateInfo info = {};
+		info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		info.allocationSize = size;
+		info.memoryTypeIndex = memoryType;
+
+		VkDeviceMemory memory = nullptr;
+		VkResult err = vkAllocateMemory(m_Device, &info, nullptr, &memory);
+		if (err != VK_SUCCESS)
+			return nullptr;
+
+		auto block = std::make_unique<MemoryBlock>();
+		block->Memory = memory;
+		block->Size = size;
+		block->MemoryType = memoryType;
+		block->Tiling = tiling;
+		block->FreeRanges.push_back({ 0, size });
+
+		Statistics& stats = m_Statistics[memoryType];
+		stats.BlockCount++;
+		stats.ReservedBytes += size;
+
+		return pool.Blocks.emplace_back(std::move(block)).get();
+	}
+
+	void MemoryAllocator::FreeLocked(MemoryAllocation* allocation)
+	{
+		Statistics& stats = m_Statistics[allocation->MemoryType];
+		stats.AllocationCount--;
+		stats.UsedBytes -= allocation->Size;
+
+		MemoryBlock* block = allocation->Block;
+		if (!block)
+		{
+			// Freeing also unmaps
+			vkFreeMemory(m_Device, allocation->Memory, nullptr);
+			stats.DedicatedAllocationCount--;
+			stats.ReservedBytes -= allocation->Size;
+			delete allocation;
+			return;
+		}
+
+		Utils::FreeToBlock(*block, allocation->Offset, allocation->Size);
+
+		auto it = std::find(block->Allocations.begin(), block->Allocations.end(), allocation);
+		*it = block->Allocations.back();
+		block->Allocations.pop_back();
+		delete allocation;
+
+		if (block->Used > 0)
+			return;
+
+		// Keep one empty block per pool around so a single image coming and going doesn't
+		// allocate and free a whole block every time
+		Pool& pool = GetPool(block->MemoryType, block->Tiling);
+		const bool otherEmptyBlock = std::any_of(pool.Blocks.begin(), pool.Blocks.end(),
+			[block](const auto& other) { return other.get() != block && other->Used == 0; });
+		if (!otherEmptyBlock)
+			return;
+
+		auto blockIt = std::find_if(pool.Blocks.begin(), pool.Blocks.end(), [block](const auto& other) { return other.get() == block; });
+		DestroyBlock(block);
+		pool.Blocks.erase(blockIt);
+	}
+
+	void MemoryAllocator::DestroyBlock(MemoryBlock* block)
+	{
+		vkFreeMemory(m_Device, block->Memory, nullptr);
+
+		Statistics& stats = m_Statistics[block->MemoryType];
+		stats.BlockCount--;
+		stats.ReservedBytes -= block->Size;
+	}
+
+}
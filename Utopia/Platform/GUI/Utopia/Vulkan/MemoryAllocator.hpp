@@ -0,0 +1,119 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include "Utopia/Core/InplaceFunction.hpp"
+
+#include <array>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Utopia {
+
+	struct MemoryBlock;
+
+	struct MemoryAllocation
+	{
+		VkDeviceMemory Memory = nullptr;
+		VkDeviceSize Offset = 0;
+		VkDeviceSize Size = 0;
+		VkDeviceSize Alignment = 1;
+		uint32_t MemoryType = 0;
+
+		// Owning block, nullptr for dedicated allocations
+		MemoryBlock* Block = nullptr;
+		// Host pointer to Offset, set by MemoryAllocator::Map()
+		void* Mapped = nullptr;
+
+		// Set while Defragment() hands the allocation to its callback; a Free() in the meantime
+		// only marks it and Defragment() frees it once the callback has returned
+		bool Pinned = false;
+		bool FreePending = false;
+	};
+
+	// Pools device memory in large blocks per memory type and hands out sub-allocations,
+	// so thousands of images cost a handful of vkAllocateMemory calls instead of one each.
+	//
+	// Linear (buffers) and optimal tiling (images) resources are kept in separate blocks, which
+	// sidesteps bufferImageGranularity. Requests larger than half a block get a dedicated
+	// allocation. Allocations are freed immediately; release ones that may still be in use by
+	// the GPU through the DeletionQueue. Thread-safe.
+	class MemoryAllocator
+	{
+	public:
+		enum class Tiling : uint8_t
+		{
+			Linear = 0,
+			Optimal
+		};
+
+		struct Statistics
+		{
+			uint32_t BlockCount = 0;
+			uint32_t AllocationCount = 0;
+			uint32_t DedicatedAllocationCount = 0;
+			// Bytes obtained from the driver / bytes handed out to allocations
+			VkDeviceSize ReservedBytes = 0;
+			VkDeviceSize UsedBytes = 0;
+		};
+
+		// Called for an allocation picked for relocation with a freshly allocated destination. The
+		// callee copies the resource into destination, rebinds it, and frees the old allocation
+		// once the GPU no longer uses it (usually through the DeletionQueue). Returning false
+		// leaves the resource where it is and the destination is freed again.
+		using MoveCallback = InplaceFunction<bool(MemoryAllocation* allocation, MemoryAllocation* destination)>;
+
+	public:
+		// Out of line, MemoryBlock is only defined in the implementation
+		MemoryAllocator();
+		~MemoryAllocator();
+
+		void Init(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize preferredBlockSize = 64 * 1024 * 1024);
+		// Frees every block. Outstanding allocations are reported as leaks in debug builds.
+		void Shutdown();
+
+		// Returns nullptr if no memory type satisfies both requirements and properties
+		MemoryAllocation* Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, Tiling tiling);
+		void Free(MemoryAllocation* allocation);
+
+		// Memory must be host visible. The block stays mapped until it is freed.
+		void* Map(MemoryAllocation* allocation);
+
+		// Defragmentation hook: empties the least used block of every memory pool into free space
+		// of the other blocks of that pool, at most maxMoves moves in total. Returns the number
+		// of completed moves. Allocations may be freed concurrently or from within the callback.
+		uint32_t Defragment(const MoveCallback& callback, uint32_t maxMoves = 64);
+
+		Statistics GetStatistics();
+		Statistics GetStatistics(uint32_t memoryType);
+
+	private:
+		struct Pool
+		{
+			std::vector<std::unique_ptr<MemoryBlock>> Blocks;
+		};
+
+		Pool& GetPool(uint32_t memoryType, Tiling tiling) { return m_Pools[memoryType * 2 + (uint32_t)tiling]; }
+
+		uint32_t FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const;
+		VkDeviceSize GetBlockSize(uint32_t memoryType) const;
+
+		MemoryAllocation* AllocateDedicated(VkDeviceSize size, uint32_t memoryType);
+		MemoryAllocation* AllocateFromPool(Pool& pool, VkDeviceSize size, VkDeviceSize alignment, const MemoryBlock* exclude);
+		MemoryBlock* CreateBlock(Pool& pool, uint32_t memoryType, Tiling tiling);
+		void FreeLocked(MemoryAllocation* allocation);
+		void DestroyBlock(MemoryBlock* block);
+
+	private:
+		VkPhysicalDevice m_PhysicalDevice = nullptr;
+		VkDevice m_Device = nullptr;
+		VkPhysicalDeviceMemoryProperties m_MemoryProperties = {};
+		VkDeviceSize m_PreferredBlockSize = 0;
+
+		std::mutex m_Mutex;
+		std::array<Pool, VK_MAX_MEMORY_TYPES * 2> m_Pools;
+		std::array<Statistics, VK_MAX_MEMORY_TYPES> m_Statistics = {};
+	};
+
+}
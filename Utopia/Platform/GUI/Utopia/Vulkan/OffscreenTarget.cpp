@@ -0,0 +1,323 @@
+#include "OffscreenTarget.hpp"
+
+#include "Utopia/ApplicationGUI.hpp"
+#include "Utopia/Image.hpp"
+
+#include <cstring>
+
+namespace Utopia {
+
+	// Same format as ImageFormat::RGBA, and UNORM like the swapchain formats the window picks
+	static constexpr VkFormat OFFSCREEN_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+	void OffscreenTarget::Init(VkDevice device, uint32_t queueFamily, uint32_t width, uint32_t height)
+	{
+		m_Device = device;
+		m_Width = width;
+		m_Height = height;
+
+		VkResult err;
+
+		// Left in SHADER_READ_ONLY so the image can be sampled between frames; readback
+		// transitions it to TRANSFER_SRC and back
+		{
+			VkAttachmentDescription attachment = {};
+			attachment.format = OFFSCREEN_FORMAT;
+			attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+			attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+			attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+			attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+			attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+			attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+			attachment.finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+			VkAttachmentReference colorAttachment = {};
+			colorAttachment.attachment = 0;
+			colorAttachment.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+			VkSubpassDescription subpass = {};
+			subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+			subpass.colorAttachmentCount = 1;
+			subpass.pColorAttachments = &colorAttachment;
+
+			VkSubpassDependency dependencies[2] = {};
+			// Earlier reads (sampling, readback copies) finish before the clear
+			dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+			dependencies[0].dstSubpass = 0;
+			dependencies[0].srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+			dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			dependencies[0].srcAccessMask = 0;
+			dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			// Rendered pixels are visible to later sampling and copies
+			dependencies[1].srcSubpass = 0;
+			dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+			dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+			dependencies[1].dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+			dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+			dependencies[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+
+			VkRenderPassCreateInfo info = {};
+			info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+			info.attachmentCount = 1;
+			info.pAttachments = &attachment;
+			info.subpassCount = 1;
+			info.pSubpasses = &subpass;
+			info.dependencyCount = 2;
+			info.pDependencies = dependencies;
+			err = vkCreateRenderPass(m_Device, &info, nullptr, &m_RenderPass);
+			check_vk_result(err);
+		}
+
+		{
+			VkCommandPoolCreateInfo info = {};
+			info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			info.queueFamilyIndex = queueFamily;
+			err = vkCreateCommandPool(m_Device, &info, nullptr, &m_CommandPool);
+			check_vk_result(err);
+		}
+		{
+			VkCommandBufferAllocateInfo info = {};
+			info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			info.commandPool = m_CommandPool;
+			info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			info.commandBufferCount = 1;
+			err = vkAllocateCommandBuffers(m_Device, &info, &m_CommandBuffer);
+			check_vk_result(err);
+		}
+		{
+			VkFenceCreateInfo info = {};
+			info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+			err = vkCreateFence(m_Device, &info, nullptr, &m_Fence);
+			check_vk_result(err);
+		}
+	}
+
+	void OffscreenTarget::Shutdown()
+	{
+		Wait();
+
+		ReleaseReadbackBuffer();
+		m_Image.reset();
+
+		vkDestroyFramebuffer(m_Device, m_Framebuffer, nullptr);
+		vkDestroyRenderPass(m_Device, m_RenderPass, nullptr);
+		vkDestroyFence(m_Device, m_Fence, nullptr);
+		// Frees the command buffer as well
+		vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
+
+		m_Framebuffer = nullptr;
+		m_RenderPass = nullptr;
+		m_Fence = nullptr;
+		m_CommandPool = nullptr;
+		m_CommandBuffer = nullptr;
+		m_HasFrame = false;
+	}
+
+	void OffscreenTarget::Resize(uint32_t width, uint32_t height)
+	{
+		if (m_Width == width && m_Height == height)
+			return;
+
+		// Only the frame in flight can still use the framebuffer
+		Wait();
+
+		m_Width = width;
+		m_Height = height;
+
+		ReleaseReadbackBuffer();
+		if (m_Image)
+		{
+			vkDestroyFramebuffer(m_Device, m_Framebuffer, nullptr);
+			m_Image->Resize(m_Width, m_Height);
+			CreateFramebuffer();
+		}
+
+		m_HasFrame = false;
+	}
+
+	void OffscreenTarget::Wait()
+	{
+		if (!m_FrameInFlight)
+			return;
+
+		VkResult err = vkWaitForFences(m_Device, 1, &m_Fence, VK_TRUE, UINT64_MAX);
+		check_vk_result(err);
+		err = vkResetFences(m_Device, 1, &m_Fence);
+		check_vk_result(err);
+
+		m_FrameInFlight = false;
+	}
+
+	VkCommandBuffer OffscreenTarget::Begin()
+	{
+		IM_ASSERT(!m_FrameInFlight && "Previous offscreen frame has not been waited for");
+
+		// Images need the ImGui Vulkan backend for their descriptor set, and that in turn needs
+		// the render pass, so the image is only created with the first frame
+		if (!m_Image)
+		{
+			m_Image = Image::CreateRenderTarget(m_Width, m_Height);
+			CreateFramebuffer();
+		}
+
+		VkResult err = vkResetCommandPool(m_Device, m_CommandPool, 0);
+		check_vk_result(err);
+
+		{
+			VkCommandBufferBeginInfo info = {};
+			info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+			err = vkBeginCommandBuffer(m_CommandBuffer, &info);
+			check_vk_result(err);
+		}
+
+		return m_CommandBuffer;
+	}
+
+	void OffscreenTarget::BeginRenderPass(const VkClearValue& clearValue, VkSubpassContents contents)
+	{
+		VkRenderPassBeginInfo info = {};
+		info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+		info.renderPass = m_RenderPass;
+		info.framebuffer = m_Framebuffer;
+		info.renderArea.extent.width = m_Width;
+		info.renderArea.extent.height = m_Height;
+		info.clearValueCount = 1;
+		info.pClearValues = &clearValue;
+		vkCmdBeginRenderPass(m_CommandBuffer, &info, contents);
+	}
+
+	void OffscreenTarget::EndRenderPass()
+	{
+		vkCmdEndRenderPass(m_CommandBuffer);
+	}
+
+	void OffscreenTarget::Submit(VkQueue queue)
+	{
+		VkResult err = vkEndCommandBuffer(m_CommandBuffer);
+		check_vk_result(err);
+
+		VkSubmitInfo info = {};
+		info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		info.commandBufferCount = 1;
+		info.pCommandBuffers = &m_CommandBuffer;
+		err = vkQueueSubmit(queue, 1, &info, m_Fence);
+		check_vk_result(err);
+
+		m_FrameInFlight = true;
+		m_HasFrame = true;
+	}
+
+	bool OffscreenTarget::ReadPixels(std::vector<uint8_t>& outPixels)
+	{
+		if (!m_HasFrame)
+			return false;
+
+		const VkDeviceSize size = (VkDeviceSize)m_Width * m_Height * 4;
+
+		if (!m_ReadbackBuffer)
+		{
+			VkBufferCreateInfo info = {};
+			info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+			info.size = size;
+			info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			VkResult err = vkCreateBuffer(m_Device, &info, nullptr, &m_ReadbackBuffer);
+			check_vk_result(err);
+
+			VkMemoryRequirements req;
+			vkGetBufferMemoryRequirements(m_Device, m_ReadbackBuffer, &req);
+
+			// Cached memory makes the CPU reads fast; coherent saves invalidating sub-allocations
+			MemoryAllocator& allocator = Application::GetMemoryAllocator();
+			const VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+			m_ReadbackAllocation = allocator.Allocate(req, hostVisible | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, MemoryAllocator::Tiling::Linear);
+			if (!m_ReadbackAllocation)
+				m_ReadbackAllocation = allocator.Allocate(req, hostVisible, MemoryAllocator::Tiling::Linear);
+			IM_ASSERT(m_ReadbackAllocation && "No host visible memory for readback");
+
+			err = vkBindBufferMemory(m_Device, m_ReadbackBuffer, m_ReadbackAllocation->Memory, m_ReadbackAllocation->Offset);
+			check_vk_result(err);
+			allocator.Map(m_ReadbackAllocation);
+		}
+
+		// Submitted after the frame on the same queue, so the barriers below order against it
+		VkCommandBuffer commandBuffer = Application::GetCommandBuffer(true);
+		{
+			const VkImage image = m_Image->GetVulkanImage();
+
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = image;
+			barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			barrier.subresourceRange.levelCount = 1;
+			barrier.subresourceRange.layerCount = 1;
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+			VkBufferImageCopy region = {};
+			region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+			region.imageSubresource.layerCount = 1;
+			region.imageExtent.width = m_Width;
+			region.imageExtent.height = m_Height;
+			region.imageExtent.depth = 1;
+			vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, m_ReadbackBuffer, 1, &region);
+
+			barrier.srcAccessMask = 0;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+			VkBufferMemoryBarrier hostBarrier = {};
+			hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+			hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+			hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			hostBarrier.buffer = m_ReadbackBuffer;
+			hostBarrier.size = VK_WHOLE_SIZE;
+			vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &hostBarrier, 0, nullptr);
+		}
+		Application::FlushCommandBuffer(commandBuffer);
+
+		outPixels.resize(size);
+		memcpy(outPixels.data(), m_ReadbackAllocation->Mapped, size);
+		return true;
+	}
+
+	void OffscreenTarget::CreateFramebuffer()
+	{
+		VkImageView attachment = m_Image->GetImageView();
+
+		VkFramebufferCreateInfo info = {};
+		info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		info.renderPass = m_RenderPass;
+		info.attachmentCount = 1;
+		info.pAttachments = &attachment;
+		info.width = m_Width;
+		info.height = m_Height;
+		info.layers = 1;
+		VkResult err = vkCreateFramebuffer(m_Device, &info, nullptr, &m_Framebuffer);
+		check_vk_result(err);
+	}
+
+	void OffscreenTarget::ReleaseReadbackBuffer()
+	{
+		// Readback waits for its copy, so nothing on the GPU uses the buffer anymore
+		if (m_ReadbackBuffer)
+			vkDestroyBuffer(m_Device, m_ReadbackBuffer, nullptr);
+		if (m_ReadbackAllocation)
+			Application::GetMemoryAllocator().Free(m_ReadbackAllocation);
+
+		m_ReadbackBuffer = nullptr;
+		m_ReadbackAllocation = nullptr;
+	}
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include "MemoryAllocator.hpp"
+
+#include <memory>
+#include <vector>
+
+namespace Utopia {
+
+	class Image;
+
+	// Frame target for applications without a window (ApplicationSpecification::Offscreen).
+	//
+	// Stands in for the swapchain: a render pass over a single render target Image, with one
+	// command buffer and fence, so exactly one frame is in flight. No surface or presentation
+	// extension is involved, which keeps it usable on software drivers and display-less machines.
+	// Pixels are read back on request through a host visible buffer.
+	//
+	// Main thread only.
+	class OffscreenTarget
+	{
+	public:
+		void Init(VkDevice device, uint32_t queueFamily, uint32_t width, uint32_t height);
+		void Shutdown();
+
+		// Waits for the frame in flight, the old image is released through the DeletionQueue
+		void Resize(uint32_t width, uint32_t height);
+
+		// Blocks until the last submitted frame has executed
+		void Wait();
+		// Begins the frame command buffer. Wait() must have returned since the previous Submit().
+		VkCommandBuffer Begin();
+		void BeginRenderPass(const VkClearValue& clearValue, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+		void EndRenderPass();
+		// Ends the command buffer and submits the frame
+		void Submit(VkQueue queue);
+
+		// RGBA8 pixels of the last submitted frame, rows top to bottom, tightly packed. Blocks
+		// until the frame has executed. Returns false before the first frame.
+		bool ReadPixels(std::vector<uint8_t>& outPixels);
+
+		VkRenderPass GetRenderPass() const { return m_RenderPass; }
+		// nullptr until the first Begin()
+		VkFramebuffer GetFramebuffer() const { return m_Framebuffer; }
+		// nullptr until the first Begin()
+		const std::shared_ptr<Image>& GetImage() const { return m_Image; }
+		uint32_t GetWidth() const { return m_Width; }
+		uint32_t GetHeight() const { return m_Height; }
+
+	private:
+		void CreateFramebuffer();
+		void ReleaseReadbackBuffer();
+
+	private:
+		VkDevice m_Device = nullptr;
+		uint32_t m_Width = 0, m_Height = 0;
+
+		VkRenderPass m_RenderPass = nullptr;
+		VkFramebuffer m_Framebuffer = nullptr;
+		std::shared_ptr<Image> m_Image;
+
+		VkCommandPool m_CommandPool = nullptr;
+		VkCommandBuffer m_CommandBuffer = nullptr;
+		VkFence m_Fence = nullptr;
+		bool m_FrameInFlight = false;
+		bool m_HasFrame = false;
+
+		// Created on the first ReadPixels(), sized for the current extent
+		VkBuffer m_ReadbackBuffer = nullptr;
+		MemoryAllocation* m_ReadbackAllocation = nullptr;
+	};
+
+}
@@ -0,0 +1,176 @@
+#include "PipelineCache.hpp"
+
+#include "Utopia/ApplicationGUI.hpp"
+#include "Utopia/Core/Log.hpp"
+#include "Utopia/Core/Hash.hpp"
+#include "Utopia/Core/MappedFile.hpp"
+#include "Utopia/Serialization/BufferStream.hpp"
+#include "Utopia/Serialization/FileStream.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace Utopia {
+
+	namespace Utils {
+
+		static constexpr uint32_t PipelineCacheMagic = 0x43505455; // "UTPC"
+		static constexpr uint32_t PipelineCacheVersion = 1;
+
+	}
+
+	void PipelineCache::Init(VkPhysicalDevice physicalDevice, VkDevice device, const std::filesystem::path& path)
+	{
+		m_Device = device;
+		m_Path = path;
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		m_DeviceHeader.Magic = Utils::PipelineCacheMagic;
+		m_DeviceHeader.Version = Utils::PipelineCacheVersion;
+		m_DeviceHeader.VendorID = properties.vendorID;
+		m_DeviceHeader.DeviceID = properties.deviceID;
+		m_DeviceHeader.DriverVersion = properties.driverVersion;
+		memcpy(m_DeviceHeader.PipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+		// Tells apart identical GPUs in one machine; Vulkan 1.1 devices only
+		if (properties.apiVersion >= VK_API_VERSION_1_1)
+		{
+			VkPhysicalDeviceIDProperties idProperties = {};
+			idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+			VkPhysicalDeviceProperties2 properties2 = {};
+			properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			properties2.pNext = &idProperties;
+			vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+			memcpy(m_DeviceHeader.DeviceUUID, idProperties.deviceUUID, VK_UUID_SIZE);
+		}
+
+		// Stale or foreign files are ignored, the cache then starts out empty
+		MappedFile file;
+		const uint8_t* initialData = nullptr;
+		size_t initialSize = 0;
+		if (!m_Path.empty() && file.Open(m_Path) && file.GetSize() >= sizeof(Header))
+		{
+			Header header;
+			BufferStreamReader reader(Buffer(file.GetData(), file.GetSize()));
+			reader.ReadRaw(header);
+
+			const uint8_t* data = file.GetData() + sizeof(Header);
+			if (IsCompatible(header) && header.DataSize == file.GetSize() - sizeof(Header) && header.DataHash == Hash::FNV1a(data, header.DataSize))
+			{
+				initialData = data;
+				initialSize = header.DataSize;
+				m_SavedHash = header.DataHash;
+			}
+			else
+			{
+				UT_CORE_WARN_TAG("PipelineCache", "Discarding '{}', it was created for another device or driver or is damaged", m_Path.string());
+			}
+		}
+
+		VkPipelineCacheCreateInfo info = {};
+		info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+		info.initialDataSize = initialSize;
+		info.pInitialData = initialData;
+		VkResult err = vkCreatePipelineCache(m_Device, &info, nullptr, &m_Cache);
+		if (err != VK_SUCCESS && initialData)
+		{
+			// The driver refused the data after all; an empty cache still helps within this run
+			UT_CORE_WARN_TAG("PipelineCache", "Driver rejected '{}' (VkResult {})", m_Path.string(), (int)err);
+			info.initialDataSize = 0;
+			info.pInitialData = nullptr;
+			m_SavedHash = 0;
+			err = vkCreatePipelineCache(m_Device, &info, nullptr, &m_Cache);
+		}
+		check_vk_result(err);
+
+		if (initialData)
+			UT_CORE_INFO_TAG("PipelineCache", "Loaded {} bytes from '{}'", initialSize, m_Path.string());
+	}
+
+	void PipelineCache::Shutdown()
+	{
+		if (!m_Cache)
+			return;
+
+		Save();
+
+		vkDestroyPipelineCache(m_Device, m_Cache, nullptr);
+		m_Cache = nullptr;
+		m_Path.clear();
+		m_SavedHash = 0;
+	}
+
+	bool PipelineCache::Save()
+	{
+		if (!m_Cache || m_Path.empty())
+			return false;
+
+		size_t size = 0;
+		VkResult err = vkGetPipelineCacheData(m_Device, m_Cache, &size, nullptr);
+		check_vk_result(err);
+
+		std::vector<uint8_t> data(size);
+		if (size)
+		{
+			// The cache may have grown in between; VK_INCOMPLETE then returns a valid, shorter blob
+			err = vkGetPipelineCacheData(m_Device, m_Cache, &size, data.data());
+			if (err != VK_SUCCESS && err != VK_INCOMPLETE)
+			{
+				check_vk_result(err);
+				return false;
+			}
+			data.resize(size);
+		}
+
+		Header header = m_DeviceHeader;
+		header.DataSize = data.size();
+		header.DataHash = Hash::FNV1a(data.data(), data.size());
+		if (header.DataHash == m_SavedHash)
+			return true;
+
+		std::error_code error;
+		if (m_Path.has_parent_path())
+			std::filesystem::create_directories(m_Path.parent_path(), error);
+
+		// Renamed into place, so a crash while writing never leaves a damaged file behind
+		std::filesystem::path tempPath = m_Path;
+		tempPath += ".tmp";
+
+		bool written = false;
+		{
+			FileStreamWriter writer(tempPath);
+			if (writer)
+			{
+				writer.WriteRaw(header);
+				written = writer.WriteData((const char*)data.data(), data.size()) && writer.IsStreamGood();
+			}
+		}
+
+		if (written)
+			std::filesystem::rename(tempPath, m_Path, error);
+
+		if (!written || error)
+		{
+			UT_CORE_ERROR_TAG("PipelineCache", "Failed to write '{}'", m_Path.string());
+			std::filesystem::remove(tempPath, error);
+			return false;
+		}
+
+		m_SavedHash = header.DataHash;
+		return true;
+	}
+
+	bool PipelineCache::IsCompatible(const Header& header) const
+	{
+		return header.Magic == m_DeviceHeader.Magic
+			&& header.Version == m_DeviceHeader.Version
+			&& header.VendorID == m_DeviceHeader.VendorID
+			&& header.DeviceID == m_DeviceHeader.DeviceID
+			&& header.DriverVersion == m_DeviceHeader.DriverVersion
+			&& memcmp(header.DeviceUUID, m_DeviceHeader.DeviceUUID, VK_UUID_SIZE) == 0
+			&& memcmp(header.PipelineCacheUUID, m_DeviceHeader.PipelineCacheUUID, VK_UUID_SIZE) == 0;
+	}
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <cstdint>
+#include <filesystem>
+
+namespace Utopia {
+
+	// Application-wide VkPipelineCache, kept on disk across runs.
+	//
+	// The file is written with FileStreamWriter on shutdown and starts with a header that
+	// identifies the device and driver it was created with: vendor, device ID, device UUID,
+	// pipeline cache UUID and driver version. A file from another GPU or driver, or one that
+	// is damaged, is discarded on load and the cache starts out empty rather than handing
+	// foreign data to the driver, where some implementations validate it poorly.
+	//
+	// Pipeline creation with the handle is thread-safe as Vulkan allows; Init/Save/Shutdown are
+	// main thread only.
+	class PipelineCache
+	{
+	public:
+		// An empty path keeps the cache in memory for this run only
+		void Init(VkPhysicalDevice physicalDevice, VkDevice device, const std::filesystem::path& path);
+		// Saves first if a path was given
+		void Shutdown();
+
+		// Writes the current contents, skipped if nothing was added since the last load or save
+		bool Save();
+
+		VkPipelineCache GetHandle() const { return m_Cache; }
+
+	private:
+		struct Header
+		{
+			uint32_t Magic = 0;
+			uint32_t Version = 0;
+			uint32_t VendorID = 0;
+			uint32_t DeviceID = 0;
+			uint32_t DriverVersion = 0;
+			uint32_t Reserved = 0;
+			uint8_t DeviceUUID[VK_UUID_SIZE] = {};
+			uint8_t PipelineCacheUUID[VK_UUID_SIZE] = {};
+			uint64_t DataSize = 0;
+			uint64_t DataHash = 0;
+		};
+
+		bool IsCompatible(const Header& header) const;
+
+	private:
+		VkDevice m_Device = nullptr;
+		VkPipelineCache m_Cache = nullptr;
+		std::filesystem::path m_Path;
+
+		// Expected header of this device, without the data fields
+		Header m_DeviceHeader;
+		// Hash of the data as last loaded or saved
+		uint64_t m_SavedHash = 0;
+	};
+
+}
@@ -0,0 +1,126 @@
+#include "SecondaryCommandRecorder.hpp"
+
+#include "Utopia/ApplicationGUI.hpp"
+
+#include <algorithm>
+
+namespace Utopia {
+
+	void SecondaryCommandRecorder::Init(VkDevice device, uint32_t queueFamily, uint32_t frameCount)
+	{
+		m_Device = device;
+		m_QueueFamily = queueFamily;
+		m_Inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		SetFrameCount(frameCount);
+	}
+
+	void SecondaryCommandRecorder::Shutdown()
+	{
+		for (Frame& frame : m_Frames)
+			DestroyFrame(frame);
+
+		m_Frames.clear();
+		m_FreePools.clear();
+		m_CurrentFrame = 0;
+	}
+
+	void SecondaryCommandRecorder::SetFrameCount(uint32_t frameCount)
+	{
+		frameCount = std::max<uint32_t>(frameCount, 1);
+		for (uint32_t i = frameCount; i < (uint32_t)m_Frames.size(); i++)
+			DestroyFrame(m_Frames[i]);
+
+		m_Frames.resize(frameCount);
+		m_FreePools.clear();
+		m_CurrentFrame = 0;
+	}
+
+	void SecondaryCommandRecorder::BeginFrame(uint32_t frameSlot, VkRenderPass renderPass, VkFramebuffer framebuffer)
+	{
+		m_CurrentFrame = frameSlot % (uint32_t)m_Frames.size();
+		m_Inheritance.renderPass = renderPass;
+		m_Inheritance.subpass = 0;
+		m_Inheritance.framebuffer = framebuffer;
+
+		std::scoped_lock<std::mutex> lock(m_Mutex);
+		m_FreePools.clear();
+		for (auto& pool : m_Frames[m_CurrentFrame].Pools)
+		{
+			VkResult err = vkResetCommandPool(m_Device, pool->CommandPool, 0);
+			check_vk_result(err);
+			pool->UsedCount = 0;
+			m_FreePools.push_back(pool.get());
+		}
+	}
+
+	VkCommandBuffer SecondaryCommandRecorder::Record(const InplaceFunction<void(VkCommandBuffer)>& record)
+	{
+		Pool* pool = AcquirePool();
+
+		VkResult err;
+		if (pool->UsedCount == pool->CommandBuffers.size())
+		{
+			VkCommandBufferAllocateInfo info = {};
+			info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			info.commandPool = pool->CommandPool;
+			info.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			info.commandBufferCount = 1;
+			VkCommandBuffer commandBuffer;
+			err = vkAllocateCommandBuffers(m_Device, &info, &commandBuffer);
+			check_vk_result(err);
+			pool->CommandBuffers.push_back(commandBuffer);
+		}
+
+		VkCommandBuffer commandBuffer = pool->CommandBuffers[pool->UsedCount++];
+		{
+			VkCommandBufferBeginInfo info = {};
+			info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+			info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+			info.pInheritanceInfo = &m_Inheritance;
+			err = vkBeginCommandBuffer(commandBuffer, &info);
+			check_vk_result(err);
+		}
+
+		record(commandBuffer);
+
+		err = vkEndCommandBuffer(commandBuffer);
+		check_vk_result(err);
+
+		std::scoped_lock<std::mutex> lock(m_Mutex);
+		m_FreePools.push_back(pool);
+		return commandBuffer;
+	}
+
+	SecondaryCommandRecorder::Pool* SecondaryCommandRecorder::AcquirePool()
+	{
+		std::scoped_lock<std::mutex> lock(m_Mutex);
+		if (!m_FreePools.empty())
+		{
+			Pool* pool = m_FreePools.back();
+			m_FreePools.pop_back();
+			return pool;
+		}
+
+		// More threads recording at once than ever before in this frame slot
+		auto& pool = m_Frames[m_CurrentFrame].Pools.emplace_back(std::make_unique<Pool>());
+
+		VkCommandPoolCreateInfo info = {};
+		info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+		info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+		info.queueFamilyIndex = m_QueueFamily;
+		VkResult err = vkCreateCommandPool(m_Device, &info, nullptr, &pool->CommandPool);
+		check_vk_result(err);
+
+		return pool.get();
+	}
+
+	void SecondaryCommandRecorder::DestroyFrame(Frame& frame)
+	{
+		// Frees all command buffers allocated from them
+		for (auto& pool : frame.Pools)
+			vkDestroyCommandPool(m_Device, pool->CommandPool, nullptr);
+
+		frame.Pools.clear();
+	}
+
+}
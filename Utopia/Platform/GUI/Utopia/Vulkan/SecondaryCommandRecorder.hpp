@@ -0,0 +1,74 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include "Utopia/Core/InplaceFunction.hpp"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Utopia {
+
+	// Secondary command buffers for the frame render pass, recorded on any thread.
+	//
+	// Command pools are externally synchronized, so every recording takes a pool of its own
+	// from a free list and hands it back when it is done. A frame ends up with as many pools as
+	// it had concurrent recordings, i.e. one per recording thread. Pools are kept per frame
+	// slot (swapchain image) and reset wholesale when that slot comes around again, which
+	// leaves their command buffers ready for reuse.
+	//
+	// Typical use, once per frame:
+	//
+	//     recorder.BeginFrame(slot, renderPass, framebuffer); // slot's fence has been waited on
+	//     ... any thread:
+	//     VkCommandBuffer cmd = recorder.Record([](VkCommandBuffer cmd) { ... });
+	//     ... then, on the thread that owns the primary command buffer:
+	//     vkCmdExecuteCommands(primary, count, commandBuffers);
+	class SecondaryCommandRecorder
+	{
+	public:
+		void Init(VkDevice device, uint32_t queueFamily, uint32_t frameCount);
+		// The device must be idle
+		void Shutdown();
+
+		// Swapchain image count can change when the swapchain is rebuilt. The device must be idle.
+		void SetFrameCount(uint32_t frameCount);
+
+		// Resets the pools of frameSlot; its previous submission must have completed. Secondaries
+		// recorded until the next BeginFrame() continue subpass 0 of renderPass on framebuffer.
+		void BeginFrame(uint32_t frameSlot, VkRenderPass renderPass, VkFramebuffer framebuffer);
+
+		// Thread-safe. Returns a secondary command buffer that record() has recorded into.
+		VkCommandBuffer Record(const InplaceFunction<void(VkCommandBuffer)>& record);
+
+	private:
+		struct Pool
+		{
+			VkCommandPool CommandPool = nullptr;
+			std::vector<VkCommandBuffer> CommandBuffers;
+			uint32_t UsedCount = 0;
+		};
+
+		struct Frame
+		{
+			std::vector<std::unique_ptr<Pool>> Pools;
+		};
+
+		Pool* AcquirePool();
+		void DestroyFrame(Frame& frame);
+
+	private:
+		VkDevice m_Device = nullptr;
+		uint32_t m_QueueFamily = 0;
+
+		std::vector<Frame> m_Frames;
+		uint32_t m_CurrentFrame = 0;
+		VkCommandBufferInheritanceInfo m_Inheritance = {};
+
+		// Guards the free list and pool creation
+		std::mutex m_Mutex;
+		std::vector<Pool*> m_FreePools;
+	};
+
+}
@@ -0,0 +1,216 @@
+#include "StagingRing.hpp"
+
+#include "Utopia/ApplicationGUI.hpp"
+
+#include <algorithm>
+
+namespace Utopia {
+
+	namespace Utils {
+
+		static VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+		{
+			return (value + alignment - 1) & ~(alignment - 1);
+		}
+
+		static VkDeviceSize NextPowerOfTwo(VkDeviceSize value)
+		{
+			VkDeviceSize result = 1;
+			while (result < value)
+				result <<= 1;
+			return result;
+		}
+
+	}
+
+	void StagingRing::Init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t framesInFlight, VkDeviceSize capacity)
+	{
+		m_PhysicalDevice = physicalDevice;
+		m_Device = device;
+		m_FramesInFlight = framesInFlight;
+
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(m_PhysicalDevice, &properties);
+		m_NonCoherentAtomSize = std::max<VkDeviceSize>(properties.limits.nonCoherentAtomSize, 1);
+
+		// Power of two keeps every aligned offset aligned after wrapping
+		m_Capacity = Utils::NextPowerOfTwo(std::max(capacity, m_NonCoherentAtomSize));
+		m_Ring = CreateBlock(m_Capacity);
+
+		m_Head = 0;
+		m_Tail = 0;
+		m_FrameNumber = 0;
+		m_FrameMarkers.clear();
+	}
+
+	void StagingRing::Shutdown()
+	{
+		// Device is idle at this point
+		DestroyBlock(m_Ring);
+		for (LargeBlock& largeBlock : m_LargeBlocks)
+			DestroyBlock(largeBlock.Memory);
+		m_LargeBlocks.clear();
+
+		m_FrameMarkers.clear();
+		m_Capacity = 0;
+		m_Device = nullptr;
+	}
+
+	StagingRing::Allocation StagingRing::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+	{
+		if (size > m_Capacity / 2)
+			return AllocateLarge(size);
+
+		VkDeviceSize offset = Utils::AlignUp(m_Head, alignment);
+
+		// Allocations never straddle the end of the ring
+		if (offset % m_Capacity + size > m_Capacity)
+			offset = (offset / m_Capacity + 1) * m_Capacity;
+
+		if (offset + size - m_Tail > m_Capacity)
+		{
+			// Out of space before the frames in flight have retired. Every copy out of the ring
+			// goes through the upload context, so once its last submission has executed the
+			// whole ring is free again.
+			UploadContext& uploadContext = Application::GetUploadContext();
+			uploadContext.Wait(uploadContext.SubmitBatch());
+
+			m_FrameMarkers.clear();
+			m_Head = 0;
+			m_Tail = 0;
+			offset = 0;
+		}
+
+		m_Head = offset + size;
+
+		const VkDeviceSize position = offset % m_Capacity;
+		return { m_Ring.Buffer, position, size, (uint8_t*)m_Ring.Data + position, m_Ring.Memory, m_Ring.Coherent };
+	}
+
+	StagingRing::Allocation StagingRing::AllocateLarge(VkDeviceSize size)
+	{
+		// Smallest block that fits and whose last allocation has retired
+		LargeBlock* best = nullptr;
+		for (LargeBlock& largeBlock : m_LargeBlocks)
+		{
+			if (largeBlock.Memory.Size < size || largeBlock.LastUsedFrame + m_FramesInFlight > m_FrameNumber)
+				continue;
+
+			if (!best || largeBlock.Memory.Size < best->Memory.Size)
+				best = &largeBlock;
+		}
+
+		if (!best)
+		{
+			// Power-of-two sizes let uploads of similar size share blocks
+			best = &m_LargeBlocks.emplace_back();
+			best->Memory = CreateBlock(Utils::NextPowerOfTwo(Utils::AlignUp(size, m_NonCoherentAtomSize)));
+		}
+
+		best->LastUsedFrame = m_FrameNumber;
+
+		const Block& block = best->Memory;
+		return { block.Buffer, 0, size, block.Data, block.Memory, block.Coherent };
+	}
+
+	void StagingRing::Flush(const Allocation& allocation)
+	{
+		if (allocation.Coherent)
+			return;
+
+		// Blocks are sized in whole atoms, so the rounded range never runs past the end
+		VkMappedMemoryRange range = {};
+		range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+		range.memory = allocation.Memory;
+		range.offset = allocation.Offset & ~(m_NonCoherentAtomSize - 1);
+		range.size = Utils::AlignUp(allocation.Offset + allocation.Size, m_NonCoherentAtomSize) - range.offset;
+		VkResult err = vkFlushMappedMemoryRanges(m_Device, 1, &range);
+		check_vk_result(err);
+	}
+
+	void StagingRing::BeginFrame()
+	{
+		m_FrameMarkers.push_back({ m_FrameNumber, m_Head });
+		m_FrameNumber++;
+
+		while (!m_FrameMarkers.empty() && m_FrameMarkers.front().Frame + m_FramesInFlight <= m_FrameNumber)
+		{
+			m_Tail = m_FrameMarkers.front().End;
+			m_FrameMarkers.pop_front();
+		}
+
+		// Idle for far longer than any frame stays in flight, so the GPU is done with them
+		std::erase_if(m_LargeBlocks, [this](LargeBlock& largeBlock)
+		{
+			if (largeBlock.LastUsedFrame + LargeBlockIdleFrames > m_FrameNumber)
+				return false;
+
+			DestroyBlock(largeBlock.Memory);
+			return true;
+		});
+	}
+
+	void StagingRing::SetFramesInFlight(uint32_t framesInFlight)
+	{
+		m_FramesInFlight = framesInFlight;
+	}
+
+	StagingRing::Block StagingRing::CreateBlock(VkDeviceSize size)
+	{
+		Block block;
+		block.Size = size;
+		VkResult err;
+
+		VkBufferCreateInfo bufferInfo = {};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = size;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+		bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+		err = vkCreateBuffer(m_Device, &bufferInfo, nullptr, &block.Buffer);
+		check_vk_result(err);
+
+		VkMemoryRequirements req;
+		vkGetBufferMemoryRequirements(m_Device, block.Buffer, &req);
+
+		// Prefer coherent memory so uploads need no explicit flush
+		VkPhysicalDeviceMemoryProperties memoryProperties;
+		vkGetPhysicalDeviceMemoryProperties(m_PhysicalDevice, &memoryProperties);
+		uint32_t memoryType = 0xffffffff;
+		for (VkMemoryPropertyFlags flags : { VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, (VkMemoryPropertyFlags)VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT })
+		{
+			for (uint32_t i = 0; i < memoryProperties.memoryTypeCount && memoryType == 0xffffffff; i++)
+			{
+				if ((memoryProperties.memoryTypes[i].propertyFlags & flags) == flags && req.memoryTypeBits & (1 << i))
+					memoryType = i;
+			}
+
+			if (memoryType != 0xffffffff)
+				break;
+		}
+		block.Coherent = memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+		VkMemoryAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+		allocInfo.allocationSize = req.size;
+		allocInfo.memoryTypeIndex = memoryType;
+		err = vkAllocateMemory(m_Device, &allocInfo, nullptr, &block.Memory);
+		check_vk_result(err);
+		err = vkBindBufferMemory(m_Device, block.Buffer, block.Memory, 0);
+		check_vk_result(err);
+
+		// Stays mapped for the lifetime of the block
+		err = vkMapMemory(m_Device, block.Memory, 0, VK_WHOLE_SIZE, 0, &block.Data);
+		check_vk_result(err);
+
+		return block;
+	}
+
+	void StagingRing::DestroyBlock(Block& block)
+	{
+		// Freeing the memory also unmaps it
+		vkDestroyBuffer(m_Device, block.Buffer, nullptr);
+		vkFreeMemory(m_Device, block.Memory, nullptr);
+		block = {};
+	}
+
+}
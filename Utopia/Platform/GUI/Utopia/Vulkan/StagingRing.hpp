@@ -0,0 +1,103 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include <deque>
+#include <vector>
+
+namespace Utopia {
+
+	// Persistently mapped, host visible ring buffer that all CPU -> GPU uploads stage through.
+	//
+	// Allocations are linear and never freed individually: at the end of every frame the
+	// current write position is recorded, and once that frame can no longer be executing on
+	// the GPU (same framesInFlight rule as DeletionQueue) everything allocated up to it is
+	// reclaimed. Copies out of the ring must be submitted through the UploadContext
+	// (FlushCommandBuffer() or the upload batch) and recorded before the next Allocate().
+	//
+	// If the ring runs full within the frames in flight, the upload context is drained and the
+	// ring starts over. Requests larger than half the ring get a dedicated block, sized to the next
+	// power of two and reused by later large requests once its frame has retired. Blocks that sit
+	// unused for LargeBlockIdleFrames are freed.
+	//
+	// Main thread only.
+	class StagingRing
+	{
+	public:
+		struct Allocation
+		{
+			VkBuffer Buffer = nullptr;
+			VkDeviceSize Offset = 0;
+			VkDeviceSize Size = 0;
+			void* Data = nullptr;
+
+			VkDeviceMemory Memory = nullptr;
+			bool Coherent = false;
+		};
+
+		static constexpr uint64_t LargeBlockIdleFrames = 120;
+
+	public:
+		void Init(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t framesInFlight, VkDeviceSize capacity = 32 * 1024 * 1024);
+		void Shutdown();
+
+		// alignment must be a power of two. Data stays valid until the end of the frame.
+		Allocation Allocate(VkDeviceSize size, VkDeviceSize alignment = 16);
+		// Makes CPU writes visible to the device. No-op on host coherent memory.
+		void Flush(const Allocation& allocation);
+
+		// Main thread, once per frame after waiting on that frame's fence
+		void BeginFrame();
+		void SetFramesInFlight(uint32_t framesInFlight);
+
+		VkDeviceSize GetCapacity() const { return m_Capacity; }
+		VkDeviceSize GetUsedSize() const { return m_Head - m_Tail; }
+
+	private:
+		struct Block
+		{
+			VkBuffer Buffer = nullptr;
+			VkDeviceMemory Memory = nullptr;
+			void* Data = nullptr;
+			VkDeviceSize Size = 0;
+			bool Coherent = false;
+		};
+
+		struct LargeBlock
+		{
+			Block Memory;
+			// Frame number of the last allocation from it
+			uint64_t LastUsedFrame = 0;
+		};
+
+		struct FrameMarker
+		{
+			uint64_t Frame;
+			VkDeviceSize End;
+		};
+
+		Block CreateBlock(VkDeviceSize size);
+		void DestroyBlock(Block& block);
+		Allocation AllocateLarge(VkDeviceSize size);
+
+	private:
+		VkPhysicalDevice m_PhysicalDevice = nullptr;
+		VkDevice m_Device = nullptr;
+		uint32_t m_FramesInFlight = 0;
+
+		VkDeviceSize m_NonCoherentAtomSize = 1;
+
+		Block m_Ring;
+		VkDeviceSize m_Capacity = 0;
+
+		// Monotonically increasing byte positions, wrapped by m_Capacity
+		VkDeviceSize m_Head = 0;
+		VkDeviceSize m_Tail = 0;
+
+		uint64_t m_FrameNumber = 0;
+		std::deque<FrameMarker> m_FrameMarkers;
+
+		std::vector<LargeBlock> m_LargeBlocks;
+	};
+
+}
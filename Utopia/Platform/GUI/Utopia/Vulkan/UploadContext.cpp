@@ -0,0 +1,317 @@
+#include "UploadContext.hpp"
+
+#include "Utopia/ApplicationGUI.hpp"
+#include "Utopia/Core/Log.hpp"
+
+#include <algorithm>
+
+namespace Utopia {
+
+	static constexpr uint64_t DEFAULT_FENCE_TIMEOUT = 100000000000;
+
+	void UploadContext::Init(VkDevice device, VkQueue queue, uint32_t queueFamily, bool useTimelineSemaphore, std::mutex* queueMutex)
+	{
+		m_Device = device;
+		m_Queue = queue;
+		m_QueueMutex = queueMutex;
+
+		VkResult err;
+
+		{
+			VkCommandPoolCreateInfo info = {};
+			info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+			info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+			info.queueFamilyIndex = queueFamily;
+			err = vkCreateCommandPool(m_Device, &info, nullptr, &m_CommandPool);
+			check_vk_result(err);
+		}
+
+		if (useTimelineSemaphore)
+		{
+			VkSemaphoreTypeCreateInfo typeInfo = {};
+			typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+			typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+			typeInfo.initialValue = 0;
+
+			VkSemaphoreCreateInfo info = {};
+			info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+			info.pNext = &typeInfo;
+			err = vkCreateSemaphore(m_Device, &info, nullptr, &m_TimelineSemaphore);
+			check_vk_result(err);
+		}
+	}
+
+	void UploadContext::Shutdown()
+	{
+		// Device is idle at this point, so everything in flight is done
+		auto destroyFence = [this](const Entry& entry) { if (entry.Fence) vkDestroyFence(m_Device, entry.Fence, nullptr); };
+		std::for_each(m_Free.begin(), m_Free.end(), destroyFence);
+		std::for_each(m_Recording.begin(), m_Recording.end(), destroyFence);
+		std::for_each(m_InFlight.begin(), m_InFlight.end(), destroyFence);
+		m_Free.clear();
+		m_Recording.clear();
+		m_InFlight.clear();
+		m_Batch = nullptr;
+		m_BatchSubmitCallback = nullptr;
+
+		// Frees all command buffers allocated from it
+		vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
+		m_CommandPool = nullptr;
+
+		if (m_TimelineSemaphore)
+		{
+			vkDestroySemaphore(m_Device, m_TimelineSemaphore, nullptr);
+			m_TimelineSemaphore = nullptr;
+		}
+	}
+
+	VkCommandBuffer UploadContext::Allocate()
+	{
+		Entry entry = AcquireEntry();
+		m_Recording.push_back(entry);
+		return entry.CommandBuffer;
+	}
+
+	uint64_t UploadContext::Submit(VkCommandBuffer commandBuffer)
+	{
+		// Keep the open batch ahead of any other submission so its ticket is known up front (see GetBatchTicket)
+		if (m_Batch && commandBuffer != m_Batch)
+			SubmitBatch();
+
+		if (commandBuffer == m_Batch)
+		{
+			if (m_BatchSubmitCallback)
+				m_BatchSubmitCallback(m_Batch);
+			m_Batch = nullptr;
+		}
+
+		return SubmitEntry(TakeRecording(commandBuffer));
+	}
+
+	void UploadContext::Flush(VkCommandBuffer commandBuffer)
+	{
+		Wait(Submit(commandBuffer));
+	}
+
+	VkCommandBuffer UploadContext::BeginBatch()
+	{
+		if (!m_Batch)
+			m_Batch = Allocate();
+
+		return m_Batch;
+	}
+
+	uint64_t UploadContext::SubmitBatch()
+	{
+		if (!m_Batch)
+			return GetLastSubmittedTicket();
+
+		return Submit(m_Batch);
+	}
+
+	bool UploadContext::IsComplete(uint64_t ticket)
+	{
+		if (ticket <= m_CompletedTicket)
+			return true;
+
+		// Not submitted yet (open batch)
+		if (ticket >= m_NextTicket)
+		{
+			IM_ASSERT(ticket == m_NextTicket && "Polling a ticket that was never handed out");
+			return false;
+		}
+
+		if (m_TimelineSemaphore)
+		{
+			uint64_t value = 0;
+			VkResult err = vkGetSemaphoreCounterValue(m_Device, m_TimelineSemaphore, &value);
+			check_vk_result(err);
+			m_CompletedTicket = std::max(m_CompletedTicket, value);
+			return ticket <= m_CompletedTicket;
+		}
+
+		// Submitted tickets past m_CompletedTicket that are no longer in flight were recycled
+		auto it = std::find_if(m_InFlight.begin(), m_InFlight.end(), [ticket](const Entry& entry) { return entry.Ticket == ticket; });
+		return it == m_InFlight.end() || IsEntryComplete(*it);
+	}
+
+	void UploadContext::Wait(uint64_t ticket)
+	{
+		if (ticket <= m_CompletedTicket)
+			return;
+
+		if (ticket >= m_NextTicket)
+		{
+			IM_ASSERT(m_Batch && ticket == m_NextTicket && "Waiting on a ticket that was never handed out");
+			SubmitBatch();
+		}
+
+		VkFence fence = nullptr;
+		if (!m_TimelineSemaphore)
+		{
+			auto it = std::find_if(m_InFlight.begin(), m_InFlight.end(), [ticket](const Entry& entry) { return entry.Ticket == ticket; });
+			if (it != m_InFlight.end())
+				fence = it->Fence;
+		}
+
+		// Callers reuse the staging memory right after, so returning early is not an option; a lost
+		// device ends the wait with an error instead
+		VkResult err = VK_SUCCESS;
+		do
+		{
+			if (err == VK_TIMEOUT)
+				UT_CORE_WARN_TAG("UploadContext", "Upload {} has not completed after {} seconds, still waiting", ticket, DEFAULT_FENCE_TIMEOUT / 1'000'000'000);
+
+			if (m_TimelineSemaphore)
+			{
+				VkSemaphoreWaitInfo info = {};
+				info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+				info.semaphoreCount = 1;
+				info.pSemaphores = &m_TimelineSemaphore;
+				info.pValues = &ticket;
+				err = vkWaitSemaphores(m_Device, &info, DEFAULT_FENCE_TIMEOUT);
+			}
+			else if (fence)
+			{
+				err = vkWaitForFences(m_Device, 1, &fence, VK_TRUE, DEFAULT_FENCE_TIMEOUT);
+			}
+		} while (err == VK_TIMEOUT);
+		check_vk_result(err);
+
+		Recycle();
+	}
+
+	void UploadContext::Recycle()
+	{
+		if (m_InFlight.empty())
+			return;
+
+		if (m_TimelineSemaphore)
+		{
+			uint64_t value = 0;
+			VkResult err = vkGetSemaphoreCounterValue(m_Device, m_TimelineSemaphore, &value);
+			check_vk_result(err);
+			m_CompletedTicket = std::max(m_CompletedTicket, value);
+		}
+
+		for (auto it = m_InFlight.begin(); it != m_InFlight.end();)
+		{
+			if (!IsEntryComplete(*it))
+			{
+				++it;
+				continue;
+			}
+
+			VkResult err = vkResetCommandBuffer(it->CommandBuffer, 0);
+			check_vk_result(err);
+			if (it->Fence)
+			{
+				err = vkResetFences(m_Device, 1, &it->Fence);
+				check_vk_result(err);
+			}
+
+			it->Ticket = 0;
+			m_Free.push_back(*it);
+			it = m_InFlight.erase(it);
+		}
+
+		// Fences can be seen signalled out of submission order, so only tickets below the oldest
+		// one still in flight are known to be complete
+		if (!m_TimelineSemaphore)
+			m_CompletedTicket = m_InFlight.empty() ? GetLastSubmittedTicket() : m_InFlight.front().Ticket - 1;
+	}
+
+	UploadContext::Entry UploadContext::AcquireEntry()
+	{
+		Entry entry;
+		VkResult err;
+
+		if (!m_Free.empty())
+		{
+			entry = m_Free.back();
+			m_Free.pop_back();
+		}
+		else
+		{
+			VkCommandBufferAllocateInfo allocInfo = {};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = m_CommandPool;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+			allocInfo.commandBufferCount = 1;
+			err = vkAllocateCommandBuffers(m_Device, &allocInfo, &entry.CommandBuffer);
+			check_vk_result(err);
+
+			if (!m_TimelineSemaphore)
+			{
+				VkFenceCreateInfo fenceInfo = {};
+				fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+				err = vkCreateFence(m_Device, &fenceInfo, nullptr, &entry.Fence);
+				check_vk_result(err);
+			}
+		}
+
+		VkCommandBufferBeginInfo beginInfo = {};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags |= VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+		err = vkBeginCommandBuffer(entry.CommandBuffer, &beginInfo);
+		check_vk_result(err);
+
+		return entry;
+	}
+
+	UploadContext::Entry UploadContext::TakeRecording(VkCommandBuffer commandBuffer)
+	{
+		auto it = std::find_if(m_Recording.begin(), m_Recording.end(), [commandBuffer](const Entry& entry) { return entry.CommandBuffer == commandBuffer; });
+		IM_ASSERT(it != m_Recording.end() && "Command buffer was not allocated by this UploadContext");
+
+		Entry entry = *it;
+		m_Recording.erase(it);
+		return entry;
+	}
+
+	uint64_t UploadContext::SubmitEntry(Entry entry)
+	{
+		VkResult err = vkEndCommandBuffer(entry.CommandBuffer);
+		check_vk_result(err);
+
+		entry.Ticket = m_NextTicket++;
+
+		VkSubmitInfo info = {};
+		info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		info.commandBufferCount = 1;
+		info.pCommandBuffers = &entry.CommandBuffer;
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+		if (m_TimelineSemaphore)
+		{
+			timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+			timelineInfo.signalSemaphoreValueCount = 1;
+			timelineInfo.pSignalSemaphoreValues = &entry.Ticket;
+
+			info.pNext = &timelineInfo;
+			info.signalSemaphoreCount = 1;
+			info.pSignalSemaphores = &m_TimelineSemaphore;
+		}
+
+		{
+			std::unique_lock<std::mutex> queueLock;
+			if (m_QueueMutex)
+				queueLock = std::unique_lock<std::mutex>(*m_QueueMutex);
+
+			err = vkQueueSubmit(m_Queue, 1, &info, entry.Fence);
+			check_vk_result(err);
+		}
+
+		m_InFlight.push_back(entry);
+		return entry.Ticket;
+	}
+
+	bool UploadContext::IsEntryComplete(const Entry& entry)
+	{
+		if (m_TimelineSemaphore)
+			return entry.Ticket <= m_CompletedTicket;
+
+		return vkGetFenceStatus(m_Device, entry.Fence) == VK_SUCCESS;
+	}
+
+}
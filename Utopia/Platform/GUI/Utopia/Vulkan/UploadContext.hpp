@@ -0,0 +1,101 @@
+#pragma once
+
+#include "vulkan/vulkan.h"
+
+#include "Utopia/Core/InplaceFunction.hpp"
+
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace Utopia {
+
+	// Pool of recyclable one-off command buffers for transfer work outside the frame.
+	//
+	// Command buffers come from a dedicated pool that is never reset wholesale, and are
+	// recycled once the GPU is done with them. Every submission is identified by a ticket:
+	// with timeline semaphores (Vulkan 1.2) the ticket is the value the submission signals
+	// on a single semaphore, otherwise each pooled command buffer carries its own reusable fence.
+	//
+	// Typical batched use - many copies, one submission:
+	//
+	//     VkCommandBuffer cmd = uploads.BeginBatch();
+	//     ... record copies into cmd ...
+	//     uint64_t ticket = uploads.SubmitBatch();
+	//     ...
+	//     uploads.Wait(ticket); // or poll IsComplete(ticket)
+	//
+	// Main thread only. If other threads submit to the same queue, pass the mutex they lock
+	// around their submissions to Init().
+	class UploadContext
+	{
+	public:
+		void Init(VkDevice device, VkQueue queue, uint32_t queueFamily, bool useTimelineSemaphore, std::mutex* queueMutex = nullptr);
+		void Shutdown();
+
+		// Returns a begun command buffer that is submitted by its own Flush()/Submit()
+		VkCommandBuffer Allocate();
+		// Submits a command buffer from Allocate() and returns its ticket
+		uint64_t Submit(VkCommandBuffer commandBuffer);
+		// Submits a command buffer from Allocate() and blocks until it has executed
+		void Flush(VkCommandBuffer commandBuffer);
+
+		// Shared batch: every caller records into the same command buffer until SubmitBatch()
+		VkCommandBuffer BeginBatch();
+		uint64_t SubmitBatch();
+		bool HasOpenBatch() const { return m_Batch != nullptr; }
+		// Ticket the open batch will signal. Any other submission flushes the batch first,
+		// so this stays valid until the batch is submitted.
+		uint64_t GetBatchTicket() const { return m_NextTicket; }
+		// Runs right before the batch is submitted, for work that is staged early but recorded
+		// as late as possible (see Image::SetSubData)
+		void SetBatchSubmitCallback(InplaceFunction<void(VkCommandBuffer)> callback) { m_BatchSubmitCallback = std::move(callback); }
+
+		// Tickets complete in submission order. The open batch's ticket is not complete until the
+		// batch has been submitted and executed.
+		bool IsComplete(uint64_t ticket);
+		// Submits the open batch first if ticket is its own. Blocks past the fence timeout, with a
+		// warning, since callers reuse the uploaded memory right after.
+		void Wait(uint64_t ticket);
+
+		// Returns finished command buffers to the pool. Called once per frame.
+		void Recycle();
+
+		// Ticket of the most recent submission (0 if nothing was submitted yet)
+		uint64_t GetLastSubmittedTicket() const { return m_NextTicket - 1; }
+
+		// Timeline semaphore signalled with each ticket, VK_NULL_HANDLE if unsupported
+		VkSemaphore GetTimelineSemaphore() const { return m_TimelineSemaphore; }
+
+	private:
+		struct Entry
+		{
+			VkCommandBuffer CommandBuffer = nullptr;
+			VkFence Fence = nullptr; // Only used without timeline semaphores
+			uint64_t Ticket = 0;
+		};
+
+		Entry AcquireEntry();
+		Entry TakeRecording(VkCommandBuffer commandBuffer);
+		uint64_t SubmitEntry(Entry entry);
+		bool IsEntryComplete(const Entry& entry);
+
+	private:
+		VkDevice m_Device = nullptr;
+		VkQueue m_Queue = nullptr;
+		std::mutex* m_QueueMutex = nullptr;
+		VkCommandPool m_CommandPool = nullptr;
+		VkSemaphore m_TimelineSemaphore = nullptr;
+
+		uint64_t m_NextTicket = 1;
+		uint64_t m_CompletedTicket = 0;
+
+		std::vector<Entry> m_Free;
+		std::vector<Entry> m_Recording;
+		std::deque<Entry> m_InFlight;
+
+		VkCommandBuffer m_Batch = nullptr;
+		InplaceFunction<void(VkCommandBuffer)> m_BatchSubmitCallback;
+	};
+
+}
@@ -14,7 +14,7 @@ static Utopia::Application* s_Instance = nullptr;
 namespace Utopia {
 
     Application::Application(const ApplicationSpecification& specification)
-        : m_Specification(specification)
+        : m_Specification(specification), m_MainThreadID(std::this_thread::get_id())
     {
         s_Instance = this;
         Init();
@@ -46,6 +46,14 @@ namespace Utopia {
 
         m_LayerStack.clear();
 
+        // One last round for what is still queued, so suspended coroutines finish and captured
+        // resources are released while this Application exists. Whatever that posts is dropped.
+        m_EventQueue.Drain([](InplaceFunction<void()>& func) { func(); });
+        m_EventQueue.Clear();
+
+        // Coroutines still waiting on a Delay() never resume, free their frames
+        m_DelayedCoroutines.Clear();
+
         // Mark global running state as false
         g_ApplicationRunning = false;
 
@@ -59,6 +67,10 @@ namespace Utopia {
 
         while (m_Running)
         {
+            // Process custom event queue
+            m_EventQueue.Drain([](InplaceFunction<void()>& func) { func(); });
+            m_DelayedCoroutines.ResumeReady();
+
             // Update each layer
             for (auto& layer : m_LayerStack)
                 layer->OnUpdate(m_TimeStep);
@@ -2,10 +2,15 @@
 
 #include "Utopia/Layer.hpp"
 #include "Utopia/Timer.hpp"
+#include "Utopia/Core/MPSCQueue.hpp"
+#include "Utopia/Core/InplaceFunction.hpp"
+#include "Utopia/Core/CoroutineScheduler.hpp"
 
 #include <string>
 #include <vector>
 #include <memory>
+#include <thread>
+#include <coroutine>
 #include <functional>
 
 namespace Utopia {
@@ -33,7 +38,7 @@ namespace Utopia {
         void Run();
 
         // No menubar for headless apps, so this is a no-op
-        inline void SetMenubarCallback(const std::function<void()>&) {}
+        inline void SetMenubarCallback(InplaceFunction<void()>) {}
 
         template<typename T>
         void PushLayer()
@@ -56,6 +61,27 @@ namespace Utopia {
         // Returns elapsed time (in seconds) since the application started
         float GetTime();
 
+        // Thread-safe; func is executed on the main thread at the start of the next frame
+        template<typename Func>
+        void QueueEvent(Func&& func)
+        {
+            m_EventQueue.Push(std::forward<Func>(func));
+        }
+
+        bool IsMainThread() const { return std::this_thread::get_id() == m_MainThreadID; }
+
+        // Coroutine awaitables (see Utopia/Core/Task.hpp and Utopia/Core/CoroutineScheduler.hpp)
+        using NextFrameAwaiter = Detail::NextFrameAwaiter<Application>;
+        using DelayAwaiter = Detail::DelayAwaiter<Application>;
+        using MainThreadAwaiter = Detail::MainThreadAwaiter<Application>;
+
+        // co_await Application::NextFrame();
+        static NextFrameAwaiter NextFrame() { return {}; }
+        // co_await Application::Delay(500);
+        static DelayAwaiter Delay(uint32_t milliseconds) { return { std::chrono::milliseconds(milliseconds) }; }
+        // co_await Application::SwitchToMainThread(); - no-op when already on the main thread
+        static MainThreadAwaiter SwitchToMainThread() { return {}; }
+
     private:
         void Init();
         void Shutdown();
@@ -70,6 +96,14 @@ namespace Utopia {
 
         std::vector<std::shared_ptr<Layer>> m_LayerStack;
         Timer m_AppTimer;
+
+        MPSCQueue<InplaceFunction<void()>> m_EventQueue;
+
+        // Coroutines suspended on Delay(), main thread only
+        DelayedCoroutineQueue m_DelayedCoroutines;
+        template<typename> friend struct Detail::DelayAwaiter;
+
+        std::thread::id m_MainThreadID;
     };
 
     // Implemented by the client (the user of this framework)
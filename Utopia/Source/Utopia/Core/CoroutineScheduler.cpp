@@ -0,0 +1,79 @@
+#include "CoroutineScheduler.hpp"
+#include "Task.hpp"
+
+#include "Utopia/Core/Log.hpp"
+
+#include <algorithm>
+
+namespace Utopia {
+
+    DelayedCoroutineQueue::~DelayedCoroutineQueue()
+    {
+        Clear();
+    }
+
+    void DelayedCoroutineQueue::Push(Clock::time_point resumeTime, std::coroutine_handle<> handle)
+    {
+        m_Entries.push_back({ resumeTime, handle });
+    }
+
+    void DelayedCoroutineQueue::ResumeReady()
+    {
+        if (m_Entries.empty())
+            return;
+
+        const Clock::time_point now = Clock::now();
+
+        // Split out the ready ones first; resumed coroutines may schedule new delays
+        auto ready = std::partition(m_Entries.begin(), m_Entries.end(),
+            [now](const Entry& entry) { return entry.ResumeTime > now; });
+
+        std::vector<Entry> readyEntries(ready, m_Entries.end());
+        m_Entries.erase(ready, m_Entries.end());
+
+        for (Entry& entry : readyEntries)
+            entry.Handle.resume();
+    }
+
+    void DelayedCoroutineQueue::Clear()
+    {
+        // Destroying a frame runs the destructors of its locals, which may reach back into this
+        // queue, so take the list out first
+        std::vector<Entry> entries = std::move(m_Entries);
+        m_Entries.clear();
+
+        for (Entry& entry : entries)
+            entry.Handle.destroy();
+    }
+
+    std::optional<DelayedCoroutineQueue::Clock::time_point> DelayedCoroutineQueue::GetNextResumeTime() const
+    {
+        if (m_Entries.empty())
+            return std::nullopt;
+
+        auto next = std::min_element(m_Entries.begin(), m_Entries.end(),
+            [](const Entry& a, const Entry& b) { return a.ResumeTime < b.ResumeTime; });
+        return next->ResumeTime;
+    }
+
+    namespace Detail {
+
+        void ReportUnobservedTaskException(std::exception_ptr exception) noexcept
+        {
+            try
+            {
+                std::rethrow_exception(exception);
+            }
+            catch (const std::exception& e)
+            {
+                UT_CORE_ERROR_TAG("Task", "Unhandled exception in detached task: {}", e.what());
+            }
+            catch (...)
+            {
+                UT_CORE_ERROR_TAG("Task", "Unhandled exception of unknown type in detached task");
+            }
+        }
+
+    } // namespace Detail
+
+} // namespace Utopia
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <coroutine>
+#include <optional>
+#include <vector>
+
+namespace Utopia {
+
+    // Coroutines suspended on Application::Delay(), resumed by the main loop once their time has
+    // come. Owned by the Application and only touched on the main thread; Delay() reaches it
+    // through Application::QueueEvent().
+    class DelayedCoroutineQueue
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        DelayedCoroutineQueue() = default;
+        ~DelayedCoroutineQueue();
+
+        DelayedCoroutineQueue(const DelayedCoroutineQueue&) = delete;
+        DelayedCoroutineQueue& operator=(const DelayedCoroutineQueue&) = delete;
+
+        void Push(Clock::time_point resumeTime, std::coroutine_handle<> handle);
+
+        // Coroutines delayed again while being resumed wait for the next call
+        void ResumeReady();
+
+        // Destroys the frames of the coroutines still waiting. Only valid while nothing else will
+        // resume or destroy them, i.e. detached Tasks at shutdown.
+        void Clear();
+
+        bool IsEmpty() const { return m_Entries.empty(); }
+        std::optional<Clock::time_point> GetNextResumeTime() const;
+
+    private:
+        struct Entry
+        {
+            Clock::time_point ResumeTime;
+            std::coroutine_handle<> Handle;
+        };
+
+        std::vector<Entry> m_Entries;
+    };
+
+    namespace Detail {
+
+        // Awaiters behind Application::NextFrame(), Delay() and SwitchToMainThread(), for both the
+        // GUI and the headless Application. All of them resume on the main thread from the event
+        // queue drain at the start of a frame.
+
+        template<typename App>
+        struct NextFrameAwaiter
+        {
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { App::Get().QueueEvent([handle]() { handle.resume(); }); }
+            void await_resume() const noexcept {}
+        };
+
+        template<typename App>
+        struct DelayAwaiter
+        {
+            DelayedCoroutineQueue::Clock::duration Duration;
+
+            bool await_ready() const { return Duration <= DelayedCoroutineQueue::Clock::duration::zero() && App::Get().IsMainThread(); }
+
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                // The clock is safe to read from any thread, the queue itself is only touched on the main thread
+                const auto resumeTime = DelayedCoroutineQueue::Clock::now() + Duration;
+                App& app = App::Get();
+                app.QueueEvent([&app, resumeTime, handle]() { app.m_DelayedCoroutines.Push(resumeTime, handle); });
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        template<typename App>
+        struct MainThreadAwaiter
+        {
+            bool await_ready() const { return App::Get().IsMainThread(); }
+            void await_suspend(std::coroutine_handle<> handle) { App::Get().QueueEvent([handle]() { handle.resume(); }); }
+            void await_resume() const noexcept {}
+        };
+
+    } // namespace Detail
+
+} // namespace Utopia
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Utopia::Hash {
+
+    constexpr uint64_t FNV1aOffsetBasis = 0xcbf29ce484222325ull;
+    constexpr uint64_t FNV1aPrime = 0x100000001b3ull;
+
+    // 64-bit FNV-1a. Pass the previous result as seed to hash data that arrives in pieces.
+    inline uint64_t FNV1a(const void* data, size_t size, uint64_t seed = FNV1aOffsetBasis)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        uint64_t hash = seed;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= FNV1aPrime;
+        }
+        return hash;
+    }
+
+} // namespace Utopia::Hash
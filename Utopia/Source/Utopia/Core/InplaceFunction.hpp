@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Utopia {
+
+    template<typename Signature, size_t Capacity = 64>
+    class InplaceFunction;
+
+    // Move-only replacement for std::function with Capacity bytes of inline storage.
+    //
+    // Callables that fit in the inline buffer (and are nothrow-movable) are stored in place,
+    // so constructing, moving and destroying one never touches the heap. Larger callables
+    // still work but fall back to a single heap allocation, same as std::function.
+    template<typename R, typename... Args, size_t Capacity>
+    class InplaceFunction<R(Args...), Capacity>
+    {
+    public:
+        InplaceFunction() noexcept = default;
+        InplaceFunction(std::nullptr_t) noexcept {}
+
+        template<typename Func, typename = std::enable_if_t<
+            !std::is_same_v<std::decay_t<Func>, InplaceFunction> && std::is_invocable_r_v<R, std::decay_t<Func>&, Args...>>>
+        InplaceFunction(Func&& func)
+        {
+            using Callable = std::decay_t<Func>;
+
+            if constexpr (std::is_pointer_v<std::remove_reference_t<Func>> || std::is_member_pointer_v<std::remove_reference_t<Func>>)
+            {
+                if (!func)
+                    return;
+            }
+
+            if constexpr (FitsInline<Callable>())
+            {
+                ::new (static_cast<void*>(m_Storage)) Callable(std::forward<Func>(func));
+                m_VTable = &s_InlineVTable<Callable>;
+            }
+            else
+            {
+                *reinterpret_cast<Callable**>(m_Storage) = new Callable(std::forward<Func>(func));
+                m_VTable = &s_HeapVTable<Callable>;
+            }
+        }
+
+        InplaceFunction(const InplaceFunction&) = delete;
+        InplaceFunction& operator=(const InplaceFunction&) = delete;
+
+        InplaceFunction(InplaceFunction&& other) noexcept
+        {
+            MoveFrom(other);
+        }
+
+        InplaceFunction& operator=(InplaceFunction&& other) noexcept
+        {
+            if (this != &other)
+            {
+                Reset();
+                MoveFrom(other);
+            }
+            return *this;
+        }
+
+        InplaceFunction& operator=(std::nullptr_t) noexcept
+        {
+            Reset();
+            return *this;
+        }
+
+        ~InplaceFunction()
+        {
+            Reset();
+        }
+
+        R operator()(Args... args) const
+        {
+            return m_VTable->Invoke(const_cast<unsigned char*>(m_Storage), std::forward<Args>(args)...);
+        }
+
+        explicit operator bool() const noexcept { return m_VTable != nullptr; }
+
+        void Reset() noexcept
+        {
+            if (m_VTable)
+            {
+                m_VTable->Destroy(m_Storage);
+                m_VTable = nullptr;
+            }
+        }
+
+    private:
+        struct VTable
+        {
+            R (*Invoke)(void* storage, Args&&... args);
+            // Move-constructs into destination and destroys the source
+            void (*Relocate)(void* destination, void* source) noexcept;
+            void (*Destroy)(void* storage) noexcept;
+        };
+
+        template<typename Callable>
+        static constexpr bool FitsInline()
+        {
+            return sizeof(Callable) <= Capacity
+                && alignof(Callable) <= alignof(std::max_align_t)
+                && std::is_nothrow_move_constructible_v<Callable>;
+        }
+
+        template<typename Callable>
+        static inline constexpr VTable s_InlineVTable = {
+            [](void* storage, Args&&... args) -> R
+            {
+                return std::invoke(*std::launder(static_cast<Callable*>(storage)), std::forward<Args>(args)...);
+            },
+            [](void* destination, void* source) noexcept
+            {
+                Callable* callable = std::launder(static_cast<Callable*>(source));
+                ::new (destination) Callable(std::move(*callable));
+                callable->~Callable();
+            },
+            [](void* storage) noexcept
+            {
+                std::launder(static_cast<Callable*>(storage))->~Callable();
+            }
+        };
+
+        template<typename Callable>
+        static inline constexpr VTable s_HeapVTable = {
+            [](void* storage, Args&&... args) -> R
+            {
+                return std::invoke(**static_cast<Callable**>(storage), std::forward<Args>(args)...);
+            },
+            [](void* destination, void* source) noexcept
+            {
+                *static_cast<Callable**>(destination) = *static_cast<Callable**>(source);
+            },
+            [](void* storage) noexcept
+            {
+                delete *static_cast<Callable**>(storage);
+            }
+        };
+
+        void MoveFrom(InplaceFunction& other) noexcept
+        {
+            if (other.m_VTable)
+            {
+                other.m_VTable->Relocate(m_Storage, other.m_Storage);
+                m_VTable = std::exchange(other.m_VTable, nullptr);
+            }
+        }
+
+    private:
+        static_assert(Capacity >= sizeof(void*), "InplaceFunction capacity must be able to hold a pointer");
+
+        alignas(std::max_align_t) unsigned char m_Storage[Capacity];
+        const VTable* m_VTable = nullptr;
+    };
+
+} // namespace Utopia
@@ -3,6 +3,7 @@
 #include <spdlog/sinks/stdout_color_sinks.h>
 #include <spdlog/sinks/basic_file_sink.h>
 
+#include <algorithm>
 #include <filesystem>
 
 #if !defined(UT_HAS_CONSOLE)
@@ -65,6 +66,28 @@ namespace Utopia {
         spdlog::drop_all();
     }
 
+    void Log::AddSink(const spdlog::sink_ptr& sink)
+    {
+        std::lock_guard<std::mutex> lock(s_Mutex);
+
+        for (const auto& logger : { s_CoreLogger, s_ClientLogger })
+        {
+            if (logger)
+                logger->sinks().push_back(sink);
+        }
+    }
+
+    void Log::RemoveSink(const spdlog::sink_ptr& sink)
+    {
+        std::lock_guard<std::mutex> lock(s_Mutex);
+
+        for (const auto& logger : { s_CoreLogger, s_ClientLogger })
+        {
+            if (logger)
+                std::erase(logger->sinks(), sink);
+        }
+    }
+
     void Log::PrintMessageTag(Type type, Level level, std::string_view tag, std::string_view message)
     {
         std::lock_guard<std::mutex> lock(s_Mutex);
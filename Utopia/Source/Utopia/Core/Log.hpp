@@ -58,6 +58,11 @@ namespace Utopia {
         [[nodiscard]] static std::shared_ptr<spdlog::logger>& GetCoreLogger() { return s_CoreLogger; }
         [[nodiscard]] static std::shared_ptr<spdlog::logger>& GetClientLogger() { return s_ClientLogger; }
 
+        // Adds a sink to (or removes it from) both loggers, e.g. UI::ConsoleSink. The sink must be
+        // thread-safe; only logging through the macros is synchronized with these.
+        static void AddSink(const spdlog::sink_ptr& sink);
+        static void RemoveSink(const spdlog::sink_ptr& sink);
+
         // Tag management
         [[nodiscard]] static bool HasTag(const std::string& tag) { return s_EnabledTags.find(tag) != s_EnabledTags.end(); }
         [[nodiscard]] static std::map<std::string, TagDetails>& EnabledTags() { return s_EnabledTags; }
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <new>
+#include <utility>
+
+namespace Utopia {
+
+    // Lock-free multi-producer/single-consumer queue.
+    //
+    // Producers push onto an atomic singly-linked list with a single CAS, so they
+    // never block each other or the consumer. The consumer takes ownership of
+    // everything queued so far with one atomic exchange and then processes it
+    // in FIFO order without touching shared state, so long-running callbacks
+    // never stall producers. Items pushed while a drain is in progress are
+    // picked up by the next Drain() call.
+    //
+    // Nodes are recycled: Drain() hands the processed ones back to a free list in
+    // one push, and a producer takes that whole list with one exchange into a
+    // cache of its thread (shared by all queues of the same T). Taking the list as
+    // a whole sidesteps the ABA problem of popping single nodes, and once the
+    // queue has seen its peak load, pushing allocates nothing beyond what T's own
+    // constructor does.
+    template<typename T>
+    class MPSCQueue
+    {
+    public:
+        MPSCQueue() = default;
+        MPSCQueue(const MPSCQueue&) = delete;
+        MPSCQueue(MPSCQueue&&) = delete;
+        MPSCQueue& operator=(const MPSCQueue&) = delete;
+        MPSCQueue& operator=(MPSCQueue&&) = delete;
+
+        ~MPSCQueue()
+        {
+            Clear();
+            DeleteNodes(m_FreeList.exchange(nullptr, std::memory_order_acquire));
+        }
+
+        // Safe to call from any thread
+        template<typename... Args>
+        void Push(Args&&... args)
+        {
+            Node* node = AcquireNode();
+            try
+            {
+                new (node->Storage) T(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                s_ThreadCache.Put(node);
+                throw;
+            }
+
+            node->Next = m_Head.load(std::memory_order_relaxed);
+            while (!m_Head.compare_exchange_weak(node->Next, node, std::memory_order_release, std::memory_order_relaxed))
+                ;
+        }
+
+        // Consumer thread only. Invokes func(T&) for every item queued before the call,
+        // in the order they were pushed. Returns the number of items processed.
+        // If func throws, the exception propagates and the items after the throwing one
+        // are destroyed without being invoked.
+        template<typename Func>
+        uint32_t Drain(Func&& func)
+        {
+            // Owns the items not processed yet, so they are freed on unwind, and collects the
+            // processed nodes for the free list
+            struct Remaining
+            {
+                MPSCQueue* Queue;
+                Node* Head;
+                Node* Processed = nullptr;
+                Node* ProcessedTail = nullptr;
+
+                ~Remaining()
+                {
+                    while (Head)
+                    {
+                        Node* node = Head;
+                        Head = node->Next;
+                        node->Value().~T();
+                        Collect(node);
+                    }
+                    Queue->Recycle(Processed, ProcessedTail);
+                }
+
+                void Collect(Node* node)
+                {
+                    node->Next = Processed;
+                    Processed = node;
+                    if (!ProcessedTail)
+                        ProcessedTail = node;
+                }
+            } remaining{ this, Reverse(m_Head.exchange(nullptr, std::memory_order_acquire)) };
+
+            uint32_t count = 0;
+            while (remaining.Head)
+            {
+                Node* node = remaining.Head;
+                func(node->Value());
+                remaining.Head = node->Next;
+                node->Value().~T();
+                remaining.Collect(node);
+                count++;
+            }
+
+            return count;
+        }
+
+        // Consumer thread only. Destroys all queued items without invoking them.
+        void Clear()
+        {
+            Node* node = m_Head.exchange(nullptr, std::memory_order_acquire);
+            while (node)
+            {
+                Node* next = node->Next;
+                node->Value().~T();
+                delete node;
+                node = next;
+            }
+        }
+
+        [[nodiscard]] bool IsEmpty() const
+        {
+            return m_Head.load(std::memory_order_relaxed) == nullptr;
+        }
+
+    private:
+        struct Node
+        {
+            Node* Next;
+            alignas(T) unsigned char Storage[sizeof(T)];
+
+            T& Value() { return *std::launder(reinterpret_cast<T*>(Storage)); }
+        };
+
+        // Free nodes of the calling thread, freed when the thread exits
+        struct ThreadCache
+        {
+            Node* Head = nullptr;
+
+            ~ThreadCache() { DeleteNodes(Head); }
+
+            Node* Take()
+            {
+                Node* node = Head;
+                if (node)
+                    Head = node->Next;
+                return node;
+            }
+
+            void Put(Node* node)
+            {
+                node->Next = Head;
+                Head = node;
+            }
+        };
+
+        Node* AcquireNode()
+        {
+            if (Node* node = s_ThreadCache.Take())
+                return node;
+
+            // Only ever taken as a whole, so no other thread can pop a node from under us
+            if (Node* list = m_FreeList.exchange(nullptr, std::memory_order_acquire))
+            {
+                s_ThreadCache.Head = list->Next;
+                return list;
+            }
+
+            return new Node;
+        }
+
+        // Pushes the chain [first, last] onto the free list
+        void Recycle(Node* first, Node* last)
+        {
+            if (!first)
+                return;
+
+            last->Next = m_FreeList.load(std::memory_order_relaxed);
+            while (!m_FreeList.compare_exchange_weak(last->Next, first, std::memory_order_release, std::memory_order_relaxed))
+                ;
+        }
+
+        // Nodes without a value
+        static void DeleteNodes(Node* node)
+        {
+            while (node)
+            {
+                Node* next = node->Next;
+                delete node;
+                node = next;
+            }
+        }
+
+        // The list is built newest-first; flip it so items run in submission order
+        static Node* Reverse(Node* node)
+        {
+            Node* reversed = nullptr;
+            while (node)
+            {
+                Node* next = node->Next;
+                node->Next = reversed;
+                reversed = node;
+                node = next;
+            }
+            return reversed;
+        }
+
+    private:
+        std::atomic<Node*> m_Head{ nullptr };
+        // Nodes drained by the consumer, waiting to be reused by producers
+        std::atomic<Node*> m_FreeList{ nullptr };
+
+        static inline thread_local ThreadCache s_ThreadCache;
+    };
+
+} // namespace Utopia
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace Utopia {
+
+    // Read-only memory mapping of a whole file. Pages are faulted in on first access, so
+    // opening is cheap no matter the file size.
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+        explicit MappedFile(const std::filesystem::path& path) { Open(path); }
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+        ~MappedFile() noexcept;
+
+        // Closes any previous mapping. Empty files can't be mapped and fail to open.
+        bool Open(const std::filesystem::path& path);
+        void Close();
+
+        [[nodiscard]] bool IsOpen() const { return m_Data != nullptr; }
+        [[nodiscard]] const uint8_t* GetData() const { return m_Data; }
+        [[nodiscard]] size_t GetSize() const { return m_Size; }
+
+    private:
+        const uint8_t* m_Data = nullptr;
+        size_t m_Size = 0;
+    #ifdef UT_PLATFORM_WINDOWS
+        void* m_Mapping = nullptr;
+    #endif
+    };
+
+} // namespace Utopia
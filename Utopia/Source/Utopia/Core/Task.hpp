@@ -0,0 +1,223 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace Utopia {
+
+    // Eagerly started C++20 coroutine task.
+    //
+    // The coroutine begins running as soon as it is called and can suspend on any awaitable
+    // (Application::NextFrame(), Application::Delay(), ThreadPool::Schedule(), another Task, ...).
+    // A Task can be co_awaited to get its result. If the Task object is dropped before the
+    // coroutine finishes, the coroutine keeps running detached and cleans itself up when done,
+    // so fire-and-forget calls such as `LoadAssets();` are safe. An exception nobody awaits the
+    // Task for is logged when the coroutine frame is destroyed.
+    template<typename T = void>
+    class Task;
+
+    namespace Detail {
+
+        // Logs an exception of a task frame destroyed without anyone having taken its result.
+        // Defined in CoroutineScheduler.cpp, so this header doesn't pull in the logger.
+        void ReportUnobservedTaskException(std::exception_ptr exception) noexcept;
+
+        enum class TaskState : uint8_t
+        {
+            Running = 0,
+            Awaited,   // Someone is suspended on the task and must be resumed on completion
+            Detached,  // Task object is gone, the coroutine frame destroys itself on completion
+            Completed
+        };
+
+        class TaskPromiseBase
+        {
+        public:
+            std::suspend_never initial_suspend() const noexcept { return {}; }
+
+            struct FinalAwaiter
+            {
+                bool await_ready() const noexcept { return false; }
+
+                template<typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+                {
+                    TaskPromiseBase& promise = handle.promise();
+                    TaskState previous = promise.m_State.exchange(TaskState::Completed, std::memory_order_acq_rel);
+
+                    if (previous == TaskState::Detached)
+                    {
+                        promise.ReportUnobservedException();
+                        handle.destroy();
+                        return std::noop_coroutine();
+                    }
+
+                    if (previous == TaskState::Awaited)
+                        return promise.m_Continuation;
+
+                    return std::noop_coroutine();
+                }
+
+                void await_resume() const noexcept {}
+            };
+
+            FinalAwaiter final_suspend() const noexcept { return {}; }
+
+            void unhandled_exception() noexcept { m_Exception = std::current_exception(); }
+
+            // Returns false if the task already completed and the caller should not suspend
+            bool TrySetContinuation(std::coroutine_handle<> continuation) noexcept
+            {
+                m_Continuation = continuation;
+                TaskState expected = TaskState::Running;
+                return m_State.compare_exchange_strong(expected, TaskState::Awaited, std::memory_order_acq_rel);
+            }
+
+            // Returns true if the coroutine already completed and the caller now owns the frame
+            bool Detach() noexcept
+            {
+                return m_State.exchange(TaskState::Detached, std::memory_order_acq_rel) == TaskState::Completed;
+            }
+
+            bool IsCompleted() const noexcept { return m_State.load(std::memory_order_acquire) == TaskState::Completed; }
+
+            void RethrowIfFailed()
+            {
+                if (m_Exception)
+                    std::rethrow_exception(std::exchange(m_Exception, nullptr));
+            }
+
+            // For frames destroyed without anyone having taken the result
+            void ReportUnobservedException() noexcept
+            {
+                if (m_Exception)
+                    ReportUnobservedTaskException(std::exchange(m_Exception, nullptr));
+            }
+
+        private:
+            std::atomic<TaskState> m_State = TaskState::Running;
+            std::coroutine_handle<> m_Continuation;
+            std::exception_ptr m_Exception;
+        };
+
+        template<typename T>
+        class TaskPromise : public TaskPromiseBase
+        {
+        public:
+            Task<T> get_return_object() noexcept;
+
+            template<typename U>
+            void return_value(U&& value) { m_Value.emplace(std::forward<U>(value)); }
+
+            T TakeResult()
+            {
+                RethrowIfFailed();
+                return std::move(*m_Value);
+            }
+
+        private:
+            std::optional<T> m_Value;
+        };
+
+        template<>
+        class TaskPromise<void> : public TaskPromiseBase
+        {
+        public:
+            Task<void> get_return_object() noexcept;
+
+            void return_void() noexcept {}
+
+            void TakeResult() { RethrowIfFailed(); }
+        };
+
+    } // namespace Detail
+
+    template<typename T>
+    class Task
+    {
+    public:
+        using promise_type = Detail::TaskPromise<T>;
+        using HandleType = std::coroutine_handle<promise_type>;
+
+        Task() = default;
+        explicit Task(HandleType handle) noexcept
+            : m_Handle(handle)
+        {
+        }
+
+        Task(const Task&) = delete;
+        Task& operator=(const Task&) = delete;
+
+        Task(Task&& other) noexcept
+            : m_Handle(std::exchange(other.m_Handle, nullptr))
+        {
+        }
+
+        Task& operator=(Task&& other) noexcept
+        {
+            if (this != &other)
+            {
+                Release();
+                m_Handle = std::exchange(other.m_Handle, nullptr);
+            }
+            return *this;
+        }
+
+        ~Task()
+        {
+            Release();
+        }
+
+        [[nodiscard]] bool IsValid() const noexcept { return (bool)m_Handle; }
+        [[nodiscard]] bool IsReady() const noexcept { return m_Handle && m_Handle.promise().IsCompleted(); }
+
+        auto operator co_await() noexcept
+        {
+            struct Awaiter
+            {
+                HandleType Handle;
+
+                bool await_ready() const noexcept { return Handle.promise().IsCompleted(); }
+                bool await_suspend(std::coroutine_handle<> continuation) noexcept { return Handle.promise().TrySetContinuation(continuation); }
+                decltype(auto) await_resume() { return Handle.promise().TakeResult(); }
+            };
+
+            return Awaiter{ m_Handle };
+        }
+
+    private:
+        void Release() noexcept
+        {
+            if (m_Handle && m_Handle.promise().Detach())
+            {
+                m_Handle.promise().ReportUnobservedException();
+                m_Handle.destroy();
+            }
+
+            m_Handle = nullptr;
+        }
+
+    private:
+        HandleType m_Handle = nullptr;
+    };
+
+    namespace Detail {
+
+        template<typename T>
+        Task<T> TaskPromise<T>::get_return_object() noexcept
+        {
+            return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+        }
+
+        inline Task<void> TaskPromise<void>::get_return_object() noexcept
+        {
+            return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+        }
+
+    } // namespace Detail
+
+} // namespace Utopia
@@ -0,0 +1,73 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+namespace Utopia {
+
+    ThreadPool::ThreadPool(uint32_t threadCount)
+    {
+        if (threadCount == 0)
+            threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+        m_Threads.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; i++)
+            m_Threads.emplace_back(&ThreadPool::WorkerThread, this);
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Stopping = true;
+        }
+        m_JobAvailable.notify_all();
+
+        for (auto& thread : m_Threads)
+            thread.join();
+    }
+
+    void ThreadPool::Submit(Job&& job)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Jobs.emplace_back(std::move(job));
+        }
+        m_JobAvailable.notify_one();
+    }
+
+    void ThreadPool::WaitIdle()
+    {
+        std::unique_lock<std::mutex> lock(m_Mutex);
+        m_Idle.wait(lock, [this]() { return m_Jobs.empty() && m_ActiveJobs == 0; });
+    }
+
+    void ThreadPool::WorkerThread()
+    {
+        while (true)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_JobAvailable.wait(lock, [this]() { return m_Stopping || !m_Jobs.empty(); });
+
+                // Drain remaining work before exiting so no coroutine is left suspended forever
+                if (m_Jobs.empty())
+                    return;
+
+                job = std::move(m_Jobs.front());
+                m_Jobs.pop_front();
+                m_ActiveJobs++;
+            }
+
+            job();
+
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_ActiveJobs--;
+                if (m_Jobs.empty() && m_ActiveJobs == 0)
+                    m_Idle.notify_all();
+            }
+        }
+    }
+
+} // namespace Utopia
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "InplaceFunction.hpp"
+
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Utopia {
+
+    class ThreadPool
+    {
+    public:
+        using Job = InplaceFunction<void()>;
+
+    public:
+        // threadCount == 0 uses one thread per hardware thread, minus one for the main thread
+        explicit ThreadPool(uint32_t threadCount = 0);
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool(ThreadPool&&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+        ThreadPool& operator=(ThreadPool&&) = delete;
+
+        // Finishes all queued jobs before joining the workers
+        ~ThreadPool();
+
+        void Submit(Job&& job);
+
+        // Blocks until the queue is empty and no job is running
+        void WaitIdle();
+
+        [[nodiscard]] uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_Threads.size()); }
+
+        // co_await threadPool.Schedule() continues the coroutine on one of the worker threads
+        auto Schedule()
+        {
+            struct Awaiter
+            {
+                ThreadPool& Pool;
+
+                bool await_ready() const noexcept { return false; }
+                void await_suspend(std::coroutine_handle<> handle) { Pool.Submit([handle]() { handle.resume(); }); }
+                void await_resume() const noexcept {}
+            };
+
+            return Awaiter{ *this };
+        }
+
+    private:
+        void WorkerThread();
+
+    private:
+        std::vector<std::thread> m_Threads;
+
+        std::mutex m_Mutex;
+        std::condition_variable m_JobAvailable;
+        std::condition_variable m_Idle;
+        std::deque<Job> m_Jobs;
+        uint32_t m_ActiveJobs = 0;
+        bool m_Stopping = false;
+    };
+
+} // namespace Utopia
@@ -13,6 +13,16 @@ namespace Utopia {
         virtual void OnUpdate(float /*ts*/) {}
         virtual void OnRender() {}
         virtual void OnUIRender() {}
+        // Called every frame after OnUIRender, before OnRender draws the frame. With pipelined
+        // rendering OnRender runs on the render thread for the previous frame, and this is the
+        // point where both threads are in sync: copy whatever OnRender reads here.
+        virtual void OnSnapshot() {}
+
+        // Opts in to OnRender being called on a thread pool worker, concurrently with the other
+        // layers' OnRender. It records into a secondary command buffer of its own (the active
+        // command buffer on that thread), which is executed in layer order. OnRender must not touch
+        // main thread state such as the upload context then.
+        virtual bool WantsParallelRender() const { return false; }
     };
 
 } // namespace Utopia
@@ -0,0 +1,178 @@
+#include "Compression.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Utopia::Utils {
+
+    // Each sequence is a token (literal length in the high nibble, match length - MinMatch in the
+    // low one), extra literal length bytes, the literals, a 16-bit little endian match offset and
+    // extra match length bytes. A nibble of 15 means more length bytes follow, each adding up to
+    // 255. The last sequence ends after its literals.
+
+    namespace {
+
+        constexpr size_t MinMatch = 4;
+        constexpr size_t MaxOffset = 65535;
+        constexpr uint32_t HashBits = 16;
+
+        uint32_t Read32(const uint8_t* p)
+        {
+            uint32_t value;
+            memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        uint32_t HashSequence(uint32_t sequence)
+        {
+            return (sequence * 2654435761u) >> (32 - HashBits);
+        }
+
+        void WriteLength(std::vector<uint8_t>& out, size_t length)
+        {
+            for (; length >= 255; length -= 255)
+                out.push_back(255);
+            out.push_back((uint8_t)length);
+        }
+
+        bool ReadLength(const uint8_t*& src, const uint8_t* srcEnd, size_t& length)
+        {
+            uint8_t byte;
+            do
+            {
+                if (src == srcEnd)
+                    return false;
+                byte = *src++;
+                length += byte;
+            } while (byte == 255);
+            return true;
+        }
+
+    } // namespace
+
+    size_t CompressLZ(const void* src, size_t size, std::vector<uint8_t>& outData)
+    {
+        const uint8_t* input = static_cast<const uint8_t*>(src);
+        const size_t start = outData.size();
+        outData.reserve(start + size + size / 255 + 16);
+
+        // Positions + 1, so zero is "empty"
+        std::vector<uint32_t> table(size_t(1) << HashBits, 0);
+
+        auto emitSequence = [&](size_t literalStart, size_t literalLength, size_t offset, size_t matchLength)
+        {
+            const size_t tokenIndex = outData.size();
+            outData.push_back(0);
+
+            uint8_t token = (uint8_t)((literalLength < 15 ? literalLength : 15) << 4);
+            if (literalLength >= 15)
+                WriteLength(outData, literalLength - 15);
+            outData.insert(outData.end(), input + literalStart, input + literalStart + literalLength);
+
+            if (matchLength)
+            {
+                outData.push_back((uint8_t)(offset & 0xff));
+                outData.push_back((uint8_t)(offset >> 8));
+
+                const size_t code = matchLength - MinMatch;
+                token |= (uint8_t)(code < 15 ? code : 15);
+                if (code >= 15)
+                    WriteLength(outData, code - 15);
+            }
+
+            outData[tokenIndex] = token;
+        };
+
+        size_t anchor = 0;
+        size_t i = 0;
+        while (size >= MinMatch && i + MinMatch <= size)
+        {
+            const uint32_t sequence = Read32(input + i);
+            uint32_t& slot = table[HashSequence(sequence)];
+            const size_t candidate = slot;
+            slot = (uint32_t)(i + 1);
+
+            if (candidate == 0 || i + 1 - candidate > MaxOffset || Read32(input + candidate - 1) != sequence)
+            {
+                i++;
+                continue;
+            }
+
+            const size_t matchStart = candidate - 1;
+            size_t matchLength = MinMatch;
+            while (i + matchLength < size && input[matchStart + matchLength] == input[i + matchLength])
+                matchLength++;
+
+            emitSequence(anchor, i - anchor, i - matchStart, matchLength);
+            i += matchLength;
+            anchor = i;
+        }
+
+        emitSequence(anchor, size - anchor, 0, 0);
+        return outData.size() - start;
+    }
+
+    bool DecompressLZ(const void* src, size_t srcSize, void* dst, size_t dstSize)
+    {
+        const uint8_t* input = static_cast<const uint8_t*>(src);
+        const uint8_t* inputEnd = input + srcSize;
+        uint8_t* output = static_cast<uint8_t*>(dst);
+        uint8_t* const outputStart = output;
+        uint8_t* const outputEnd = output + dstSize;
+
+        while (input < inputEnd)
+        {
+            const uint8_t token = *input++;
+
+            size_t literalLength = token >> 4;
+            if (literalLength == 15 && !ReadLength(input, inputEnd, literalLength))
+                return false;
+            if (literalLength > (size_t)(inputEnd - input) || literalLength > (size_t)(outputEnd - output))
+                return false;
+
+            if (literalLength)
+                memcpy(output, input, literalLength);
+            input += literalLength;
+            output += literalLength;
+
+            // Last sequence
+            if (input == inputEnd)
+                break;
+
+            if (inputEnd - input < 2)
+                return false;
+            const size_t offset = (size_t)input[0] | ((size_t)input[1] << 8);
+            input += 2;
+
+            size_t matchLength = token & 15;
+            if (matchLength == 15 && !ReadLength(input, inputEnd, matchLength))
+                return false;
+            matchLength += MinMatch;
+
+            if (offset == 0 || offset > (size_t)(output - outputStart) || matchLength > (size_t)(outputEnd - output))
+                return false;
+
+            const uint8_t* match = output - offset;
+            if (offset >= matchLength)
+            {
+                memcpy(output, match, matchLength);
+                output += matchLength;
+            }
+            else
+            {
+                // Overlapping: the output repeats with a period of offset bytes, so every chunk
+                // can be twice as long as the previous one without source and destination overlapping
+                for (size_t remaining = matchLength; remaining;)
+                {
+                    const size_t chunk = std::min(remaining, (size_t)(output - match));
+                    memcpy(output, match, chunk);
+                    output += chunk;
+                    remaining -= chunk;
+                }
+            }
+        }
+
+        return output == outputEnd;
+    }
+
+} // namespace Utopia::Utils
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Utopia::Utils {
+
+    // Byte oriented LZ77 in the style of LZ4: greedy single-probe matching on compression and
+    // a branch-light decoder that runs at close to memcpy speed. Meant for data that is written
+    // once and read often (caches), not for archival ratios.
+    //
+    // Appends the compressed form of src to outData and returns its size.
+    size_t CompressLZ(const void* src, size_t size, std::vector<uint8_t>& outData);
+
+    // dstSize must be the exact uncompressed size. Returns false on malformed input, never
+    // reading or writing out of bounds.
+    bool DecompressLZ(const void* src, size_t srcSize, void* dst, size_t dstSize);
+
+} // namespace Utopia::Utils
@@ -0,0 +1,18 @@
+#include "FileUtils.hpp"
+
+#include <fstream>
+
+namespace Utopia::Utils {
+
+    bool ReadFile(const std::filesystem::path& path, std::vector<uint8_t>& outData)
+    {
+        std::ifstream stream(path, std::ios::binary | std::ios::ate);
+        if (!stream)
+            return false;
+
+        outData.resize((size_t)stream.tellg());
+        stream.seekg(0, std::ios::beg);
+        return (bool)stream.read((char*)outData.data(), outData.size());
+    }
+
+} // namespace Utopia::Utils
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+namespace Utopia::Utils {
+
+    // Reads the whole file into outData. Returns false if it can't be opened or read.
+    bool ReadFile(const std::filesystem::path& path, std::vector<uint8_t>& outData);
+
+} // namespace Utopia::Utils
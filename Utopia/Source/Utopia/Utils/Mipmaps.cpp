@@ -0,0 +1,160 @@
+#include "Mipmaps.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace Utopia::Utils {
+
+    namespace {
+
+        struct UNorm8Component
+        {
+            using Type = uint8_t;
+            static float Load(uint8_t value) { return (float)value; }
+            static uint8_t Store(float value) { return (uint8_t)(value + 0.5f); }
+        };
+
+        struct Float16Component
+        {
+            using Type = uint16_t;
+            static float Load(uint16_t value) { return HalfToFloat(value); }
+            static uint16_t Store(float value) { return FloatToHalf(value); }
+        };
+
+        struct Float32Component
+        {
+            using Type = float;
+            static float Load(float value) { return value; }
+            static float Store(float value) { return value; }
+        };
+
+        template<typename Component>
+        void Downsample(const void* src, uint32_t srcWidth, uint32_t srcHeight, void* dst,
+            uint32_t channels, uint32_t firstRow, uint32_t rowCount)
+        {
+            using T = typename Component::Type;
+
+            const uint32_t dstWidth = MipLevelExtent(srcWidth, 1);
+            const size_t srcStride = (size_t)srcWidth * channels;
+            const size_t dstStride = (size_t)dstWidth * channels;
+
+            const T* source = static_cast<const T*>(src);
+            T* destination = static_cast<T*>(dst);
+
+            for (uint32_t y = firstRow; y < firstRow + rowCount; y++)
+            {
+                const T* row0 = source + std::min(y * 2, srcHeight - 1) * srcStride;
+                const T* row1 = source + std::min(y * 2 + 1, srcHeight - 1) * srcStride;
+                T* out = destination + y * dstStride;
+
+                for (uint32_t x = 0; x < dstWidth; x++)
+                {
+                    const size_t x0 = (size_t)std::min(x * 2, srcWidth - 1) * channels;
+                    const size_t x1 = (size_t)std::min(x * 2 + 1, srcWidth - 1) * channels;
+
+                    for (uint32_t c = 0; c < channels; c++)
+                    {
+                        const float sum = Component::Load(row0[x0 + c]) + Component::Load(row0[x1 + c]) +
+                            Component::Load(row1[x0 + c]) + Component::Load(row1[x1 + c]);
+                        out[x * channels + c] = Component::Store(sum * 0.25f);
+                    }
+                }
+            }
+        }
+
+    } // namespace
+
+    uint32_t CalculateMipLevelCount(uint32_t width, uint32_t height)
+    {
+        uint32_t levels = 1;
+        for (uint32_t extent = std::max(width, height); extent > 1; extent >>= 1)
+            levels++;
+        return levels;
+    }
+
+    void DownsampleMipLevel(const void* src, uint32_t srcWidth, uint32_t srcHeight, void* dst,
+        uint32_t channels, MipComponentType type, uint32_t firstRow, uint32_t rowCount)
+    {
+        switch (type)
+        {
+            case MipComponentType::UNorm8:  Downsample<UNorm8Component>(src, srcWidth, srcHeight, dst, channels, firstRow, rowCount); return;
+            case MipComponentType::Float16: Downsample<Float16Component>(src, srcWidth, srcHeight, dst, channels, firstRow, rowCount); return;
+            case MipComponentType::Float32: Downsample<Float32Component>(src, srcWidth, srcHeight, dst, channels, firstRow, rowCount); return;
+        }
+    }
+
+    float HalfToFloat(uint16_t value)
+    {
+        const uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+        uint32_t exponent = (value >> 10) & 0x1f;
+        uint32_t mantissa = value & 0x3ff;
+
+        uint32_t bits;
+        if (exponent == 0x1f)
+        {
+            // Inf/NaN
+            bits = sign | 0x7f800000 | (mantissa << 13);
+        }
+        else if (exponent != 0)
+        {
+            bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        }
+        else if (mantissa == 0)
+        {
+            bits = sign;
+        }
+        else
+        {
+            // Denormal, normalize
+            exponent = 113;
+            while (!(mantissa & 0x400))
+            {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+
+        float result;
+        memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+    uint16_t FloatToHalf(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+
+        const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+        const uint32_t mantissa = bits & 0x7fffff;
+        const int32_t exponent = (int32_t)((bits >> 23) & 0xff) - 127 + 15;
+
+        if ((bits & 0x7fffffff) >= 0x7f800000)
+            return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+        if (exponent >= 0x1f)
+            return sign | 0x7c00;
+
+        // Round to nearest even; a carry out of the mantissa correctly bumps the exponent
+        if (exponent <= 0)
+        {
+            if (exponent < -10)
+                return sign;
+
+            const uint32_t full = mantissa | 0x800000;
+            const uint32_t shift = (uint32_t)(14 - exponent);
+            uint32_t half = full >> shift;
+            const uint32_t remainder = full & ((1u << shift) - 1);
+            const uint32_t midpoint = 1u << (shift - 1);
+            if (remainder > midpoint || (remainder == midpoint && (half & 1)))
+                half++;
+            return sign | (uint16_t)half;
+        }
+
+        uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+        const uint32_t remainder = mantissa & 0x1fff;
+        if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+            half++;
+        return sign | (uint16_t)half;
+    }
+
+} // namespace Utopia::Utils
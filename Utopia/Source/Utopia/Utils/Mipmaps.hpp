@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Utopia::Utils {
+
+    enum class MipComponentType : uint8_t
+    {
+        UNorm8 = 0,
+        Float16,
+        Float32
+    };
+
+    // Full chain down to 1x1
+    uint32_t CalculateMipLevelCount(uint32_t width, uint32_t height);
+
+    // Size of the given level: half the previous one, rounded down, at least 1
+    inline uint32_t MipLevelExtent(uint32_t extent, uint32_t level)
+    {
+        const uint32_t result = extent >> level;
+        return result ? result : 1;
+    }
+
+    // 2x2 box filter from one tightly packed level into the next. Only the destination rows
+    // [firstRow, firstRow + rowCount) are written, so a level can be split across threads.
+    // Odd source sizes clamp at the last row/column.
+    void DownsampleMipLevel(const void* src, uint32_t srcWidth, uint32_t srcHeight, void* dst,
+        uint32_t channels, MipComponentType type, uint32_t firstRow, uint32_t rowCount);
+
+    float HalfToFloat(uint16_t value);
+    uint16_t FloatToHalf(float value);
+
+} // namespace Utopia::Utils
@@ -0,0 +1,215 @@
+#include "PixelConversion.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define UT_PIXEL_CONVERSION_X86 1
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #endif
+#else
+    #define UT_PIXEL_CONVERSION_X86 0
+#endif
+
+// GCC/Clang only emit SSSE3/AVX2 instructions in functions that ask for them, so the rest of
+// the library keeps building for the baseline ISA. MSVC allows the intrinsics anywhere.
+#if defined(__GNUC__) || defined(__clang__)
+    #define UT_TARGET(isa) __attribute__((target(isa)))
+#else
+    #define UT_TARGET(isa)
+#endif
+
+namespace Utopia::Utils {
+
+    namespace {
+
+        // Byte order of a 24-bit source pixel in RGBA output order
+        struct RGBOrder { static constexpr int R = 0, G = 1, B = 2; };
+        struct BGROrder { static constexpr int R = 2, G = 1, B = 0; };
+
+        template<typename Order>
+        void Convert24To32Scalar(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+        {
+            for (size_t i = 0; i < pixelCount; i++, src += 3, dst += 4)
+            {
+                dst[0] = src[Order::R];
+                dst[1] = src[Order::G];
+                dst[2] = src[Order::B];
+                dst[3] = 255;
+            }
+        }
+
+#if UT_PIXEL_CONVERSION_X86
+
+        // pshufb mask moving four packed 24-bit pixels into the low three bytes of four 32-bit lanes.
+        // 0x80 zeroes the alpha byte, which is then set with an OR.
+        template<typename Order>
+        UT_TARGET("ssse3") __m128i ShuffleMask128()
+        {
+            return _mm_setr_epi8(
+                Order::R + 0, Order::G + 0, Order::B + 0, (char)0x80,
+                Order::R + 3, Order::G + 3, Order::B + 3, (char)0x80,
+                Order::R + 6, Order::G + 6, Order::B + 6, (char)0x80,
+                Order::R + 9, Order::G + 9, Order::B + 9, (char)0x80);
+        }
+
+        // 16 pixels (48 bytes in, 64 out) per iteration without reading past the source
+        template<typename Order>
+        UT_TARGET("ssse3") void Convert24To32SSSE3(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+        {
+            const __m128i mask = ShuffleMask128<Order>();
+            const __m128i alpha = _mm_set1_epi32((int)0xff000000);
+
+            size_t i = 0;
+            for (; i + 16 <= pixelCount; i += 16, src += 48, dst += 64)
+            {
+                const __m128i a = _mm_loadu_si128((const __m128i*)(src + 0));
+                const __m128i b = _mm_loadu_si128((const __m128i*)(src + 16));
+                const __m128i c = _mm_loadu_si128((const __m128i*)(src + 32));
+
+                // Pixels start at byte 0, 12, 24 and 36
+                const __m128i p0 = a;
+                const __m128i p1 = _mm_alignr_epi8(b, a, 12);
+                const __m128i p2 = _mm_alignr_epi8(c, b, 8);
+                const __m128i p3 = _mm_srli_si128(c, 4);
+
+                _mm_storeu_si128((__m128i*)(dst + 0),  _mm_or_si128(_mm_shuffle_epi8(p0, mask), alpha));
+                _mm_storeu_si128((__m128i*)(dst + 16), _mm_or_si128(_mm_shuffle_epi8(p1, mask), alpha));
+                _mm_storeu_si128((__m128i*)(dst + 32), _mm_or_si128(_mm_shuffle_epi8(p2, mask), alpha));
+                _mm_storeu_si128((__m128i*)(dst + 48), _mm_or_si128(_mm_shuffle_epi8(p3, mask), alpha));
+            }
+
+            Convert24To32Scalar<Order>(src, dst, pixelCount - i);
+        }
+
+        // Pixels 0-3 into the low lane, pixels 4-7 into the high lane
+        UT_TARGET("avx2") inline __m256i Load8Pixels(const uint8_t* p)
+        {
+            return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)p)),
+                _mm_loadu_si128((const __m128i*)(p + 12)), 1);
+        }
+
+        // 32 pixels per iteration. vpshufb works per 128-bit lane, so each lane is loaded with the
+        // 12 bytes of four pixels; the last load of an iteration reads 4 bytes past its pixels,
+        // hence the loop leaves at least two pixels of slack.
+        template<typename Order>
+        UT_TARGET("avx2") void Convert24To32AVX2(const uint8_t* src, uint8_t* dst, size_t pixelCount)
+        {
+            const __m256i mask = _mm256_broadcastsi128_si256(ShuffleMask128<Order>());
+            const __m256i alpha = _mm256_set1_epi32((int)0xff000000);
+
+            size_t i = 0;
+            for (; i + 34 <= pixelCount; i += 32, src += 96, dst += 128)
+            {
+                const __m256i p0 = Load8Pixels(src + 0);
+                const __m256i p1 = Load8Pixels(src + 24);
+                const __m256i p2 = Load8Pixels(src + 48);
+                const __m256i p3 = Load8Pixels(src + 72);
+
+                _mm256_storeu_si256((__m256i*)(dst + 0),  _mm256_or_si256(_mm256_shuffle_epi8(p0, mask), alpha));
+                _mm256_storeu_si256((__m256i*)(dst + 32), _mm256_or_si256(_mm256_shuffle_epi8(p1, mask), alpha));
+                _mm256_storeu_si256((__m256i*)(dst + 64), _mm256_or_si256(_mm256_shuffle_epi8(p2, mask), alpha));
+                _mm256_storeu_si256((__m256i*)(dst + 96), _mm256_or_si256(_mm256_shuffle_epi8(p3, mask), alpha));
+            }
+
+            Convert24To32SSSE3<Order>(src, dst, pixelCount - i);
+        }
+
+        SimdLevel DetectSimdLevel()
+        {
+    #if defined(_MSC_VER) && !defined(__clang__)
+            int info[4];
+            __cpuid(info, 0);
+            const int maxLeaf = info[0];
+
+            __cpuid(info, 1);
+            const bool ssse3 = (info[2] & (1 << 9)) != 0;
+            const bool osxsave = (info[2] & (1 << 27)) != 0;
+
+            bool avx2 = false;
+            if (maxLeaf >= 7 && osxsave && (_xgetbv(0) & 0x6) == 0x6)
+            {
+                __cpuidex(info, 7, 0);
+                avx2 = (info[1] & (1 << 5)) != 0;
+            }
+    #else
+            __builtin_cpu_init();
+            const bool ssse3 = __builtin_cpu_supports("ssse3");
+            const bool avx2 = __builtin_cpu_supports("avx2");
+    #endif
+
+            if (avx2)
+                return SimdLevel::AVX2;
+            if (ssse3)
+                return SimdLevel::SSSE3;
+            return SimdLevel::Scalar;
+        }
+
+#else
+
+        SimdLevel DetectSimdLevel()
+        {
+            return SimdLevel::Scalar;
+        }
+
+#endif
+
+        template<typename Order>
+        void Convert24To32(const void* src, void* dst, size_t pixelCount, SimdLevel level)
+        {
+            const uint8_t* s = static_cast<const uint8_t*>(src);
+            uint8_t* d = static_cast<uint8_t*>(dst);
+
+            // Never run a kernel the CPU doesn't have, even if asked to
+            if (level > GetSupportedSimdLevel())
+                level = GetSupportedSimdLevel();
+
+            switch (level)
+            {
+#if UT_PIXEL_CONVERSION_X86
+                case SimdLevel::AVX2:  Convert24To32AVX2<Order>(s, d, pixelCount); return;
+                case SimdLevel::SSSE3: Convert24To32SSSE3<Order>(s, d, pixelCount); return;
+#endif
+                default:               Convert24To32Scalar<Order>(s, d, pixelCount); return;
+            }
+        }
+
+    } // namespace
+
+    SimdLevel GetSupportedSimdLevel()
+    {
+        static const SimdLevel s_Level = DetectSimdLevel();
+        return s_Level;
+    }
+
+    const char* SimdLevelToString(SimdLevel level)
+    {
+        switch (level)
+        {
+            case SimdLevel::Scalar: return "Scalar";
+            case SimdLevel::SSSE3:  return "SSSE3";
+            case SimdLevel::AVX2:   return "AVX2";
+        }
+        return "Unknown";
+    }
+
+    void ConvertRGB8ToRGBA8(const void* src, void* dst, size_t pixelCount)
+    {
+        Convert24To32<RGBOrder>(src, dst, pixelCount, GetSupportedSimdLevel());
+    }
+
+    void ConvertRGB8ToRGBA8(const void* src, void* dst, size_t pixelCount, SimdLevel level)
+    {
+        Convert24To32<RGBOrder>(src, dst, pixelCount, level);
+    }
+
+    void ConvertBGR8ToRGBA8(const void* src, void* dst, size_t pixelCount)
+    {
+        Convert24To32<BGROrder>(src, dst, pixelCount, GetSupportedSimdLevel());
+    }
+
+    void ConvertBGR8ToRGBA8(const void* src, void* dst, size_t pixelCount, SimdLevel level)
+    {
+        Convert24To32<BGROrder>(src, dst, pixelCount, level);
+    }
+
+} // namespace Utopia::Utils
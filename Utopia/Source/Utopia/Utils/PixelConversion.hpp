@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Utopia::Utils {
+
+    // Instruction set used by the pixel conversion kernels. The overloads without a level pick
+    // the best one the CPU supports; the explicit ones exist for benchmarking and testing.
+    enum class SimdLevel : uint8_t
+    {
+        Scalar = 0,
+        SSSE3,
+        AVX2
+    };
+
+    SimdLevel GetSupportedSimdLevel();
+    const char* SimdLevelToString(SimdLevel level);
+
+    // Tightly packed 24-bit pixels to 32-bit RGBA with alpha 255. src and dst must not overlap.
+    void ConvertRGB8ToRGBA8(const void* src, void* dst, size_t pixelCount);
+    void ConvertRGB8ToRGBA8(const void* src, void* dst, size_t pixelCount, SimdLevel level);
+
+    void ConvertBGR8ToRGBA8(const void* src, void* dst, size_t pixelCount);
+    void ConvertBGR8ToRGBA8(const void* src, void* dst, size_t pixelCount, SimdLevel level);
+
+} // namespace Utopia::Utils
@@ -0,0 +1,55 @@
+-- Utopia-Benchmarks.lua
+-- Standalone CPU benchmarks. Only pulls in the sources under test, so no Vulkan SDK is needed.
+project "UtopiaBenchmarks"
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++20"
+   targetdir "bin/%{cfg.buildcfg}"
+   staticruntime "off"
+
+   files
+   {
+      "Source/**.h",
+      "Source/**.hpp",
+      "Source/**.cpp",
+
+      "../Utopia/Source/Utopia/Utils/PixelConversion.hpp",
+      "../Utopia/Source/Utopia/Utils/PixelConversion.cpp",
+      "../Utopia/Platform/GUI/Utopia/UI/ConsoleSearch.hpp",
+      "../Utopia/Platform/GUI/Utopia/UI/ConsoleSearch.cpp",
+   }
+
+   includedirs
+   {
+      "../Utopia/Source",
+      "../Utopia/Platform/GUI",
+
+      -- Log.hpp, for Log::Level
+      "%{IncludeDir.glm}",
+      "%{IncludeDir.spdlog}",
+   }
+
+   targetdir ("../bin/" .. outputdir .. "/%{prj.name}")
+   objdir ("../bin-int/" .. outputdir .. "/%{prj.name}")
+
+   filter "system:windows"
+      systemversion "latest"
+      defines { "UT_PLATFORM_WINDOWS" }
+      buildoptions { "/utf-8" }
+
+   filter "configurations:Debug"
+      defines { "UT_DEBUG" }
+      runtime "Debug"
+      symbols "On"
+
+   filter "configurations:Release"
+      defines { "UT_RELEASE" }
+      runtime "Release"
+      optimize "On"
+      symbols "On"
+
+   filter "configurations:Dist"
+      defines { "UT_DIST" }
+      runtime "Release"
+      optimize "On"
+      symbols "Off"
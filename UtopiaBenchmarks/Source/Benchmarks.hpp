@@ -0,0 +1,6 @@
+#pragma once
+
+// Returns false if a kernel disagrees with the scalar reference
+bool RunPixelConversionBenchmarks();
+
+void RunConsoleSearchBenchmarks();
@@ -0,0 +1,161 @@
+// Console search index: how full the per-block trigram filters get and how many blocks a query
+// still has to scan, for templated log lines and for varied text. Also times a search with and
+// without the index.
+
+#include "Benchmarks.hpp"
+
+#include "Utopia/UI/ConsoleSearch.hpp"
+
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace Utopia;
+using namespace Utopia::UI;
+
+struct Message
+{
+    std::string Tag;
+    std::string Text;
+    Log::Level Level;
+};
+
+template<typename... Args>
+static std::string Format(const char* format, Args... args)
+{
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), format, args...);
+    return buffer;
+}
+
+// What an application typically logs: a handful of templates with paths, ids and timings
+static std::vector<Message> GenerateLogLines(size_t count, std::mt19937& random)
+{
+    static const char* dirs[] = { "assets/textures", "assets/models", "shaders", "levels/forest", "levels/desert", "ui/icons" };
+    static const char* extensions[] = { "png", "jpg", "glb", "spv", "ktx2" };
+    static const char* words[] = { "player", "enemy", "door", "light", "camera", "terrain", "water", "sky", "grass", "rock",
+                                   "tree", "ui", "button", "panel", "font", "sound", "music", "particle", "shadow", "bloom" };
+    static const char* tags[] = { "Renderer", "Assets", "Network", "Scene" };
+
+    auto word = [&]() { return words[random() % std::size(words)]; };
+    auto path = [&]() { return Format("%s/%s_%s%u.%s", dirs[random() % std::size(dirs)], word(), word(), (unsigned)(random() % 100), extensions[random() % std::size(extensions)]); };
+    auto value = [&](uint32_t range, double scale) { return (double)(random() % range) * scale; };
+
+    std::vector<Message> messages;
+    messages.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        Message& message = messages.emplace_back();
+        message.Tag = tags[random() % std::size(tags)];
+        message.Level = random() % 16 == 0 ? Log::Level::Warn : Log::Level::Info;
+
+        switch (random() % 8)
+        {
+            case 0: message.Text = Format("Loaded image '%s' (%ux%u, RGBA) in %.2f ms", path().c_str(), 16u << (random() % 8), 16u << (random() % 8), value(10000, 0.01)); break;
+            case 1: message.Text = Format("Frame %u: cpu %.3f ms, gpu %.3f ms, %u draw calls", (unsigned)(random() % 1000000), value(2000, 0.01), value(2000, 0.01), (unsigned)(random() % 5000)); break;
+            case 2: message.Text = Format("Failed to open '%s': No such file or directory", path().c_str()); break;
+            case 3: message.Text = Format("Entity %u '%s' moved to (%.2f, %.2f, %.2f)", (unsigned)(random() % 100000), word(), value(20000, 0.1) - 1000.0, value(20000, 0.1) - 1000.0, value(20000, 0.1) - 1000.0); break;
+            case 4: message.Text = Format("Allocated %u KB for %s buffer 0x%08x%08x", (unsigned)(random() % 65536), word(), (unsigned)random(), (unsigned)random()); break;
+            case 5: message.Text = Format("Pipeline cache hit for shader %s.spv (hash %08x)", word(), (unsigned)random()); break;
+            case 6: message.Text = Format("Connection %u from 192.168.%u.%u:%u accepted", (unsigned)(random() % 10000), (unsigned)(random() % 256), (unsigned)(random() % 256), (unsigned)(1024 + random() % 60000)); break;
+            default: message.Text = Format("Compiled %u shaders in %.1f ms", (unsigned)(random() % 50), value(100000, 0.1)); break;
+        }
+    }
+
+    return messages;
+}
+
+// Worst case for the filters: ~100 characters of unrelated words and numbers per message
+static std::vector<Message> GenerateVariedText(size_t count, std::mt19937& random)
+{
+    std::vector<std::string> vocabulary(5000);
+    for (std::string& word : vocabulary)
+    {
+        const size_t length = 3 + random() % 8;
+        for (size_t i = 0; i < length; i++)
+            word += (char)('a' + random() % 26);
+    }
+
+    std::vector<Message> messages(count);
+    for (Message& message : messages)
+    {
+        message.Level = Log::Level::Info;
+        while (message.Text.size() < 100)
+        {
+            message.Text += random() % 4 == 0 ? std::to_string(random() % 100000) : vocabulary[random() % vocabulary.size()];
+            message.Text += ' ';
+        }
+    }
+
+    return messages;
+}
+
+static void Run(const char* name, const std::vector<Message>& messages)
+{
+    constexpr uint64_t blockSize = ConsoleSearchIndex::BlockSize;
+
+    ConsoleSearchIndex index;
+    for (size_t i = 0; i < messages.size(); i++)
+        index.Add(i, messages[i].Tag, messages[i].Text, messages[i].Level);
+
+    const size_t blockCount = (messages.size() + blockSize - 1) / blockSize;
+    double fill = 0.0;
+    for (size_t block = 0; block < blockCount; block++)
+    {
+        uint32_t bits = 0;
+        for (uint64_t word : index.GetBlock(block * blockSize)->Trigrams)
+            bits += (uint32_t)std::popcount(word);
+        fill += (double)bits / ConsoleSearchIndex::TrigramBits;
+    }
+
+    printf("%s: %zu messages, %zu blocks of %u, %.1f bytes/message, filters %.0f%% full\n", name, messages.size(), blockCount,
+        (unsigned)blockSize, (double)sizeof(ConsoleSearchIndex::Summary) / blockSize, 100.0 * fill / blockCount);
+
+    // Words that never appear, short and long, and ones that appear in a few messages
+    static const char* queries[] = { "gpu", "fps", "timeout", "overflow", "0xdeadbeef", "connection 42 ", "sky_door7", "tag:network level:error" };
+
+    for (const char* text : queries)
+    {
+        const ConsoleQuery query = ConsoleQuery::Parse(text);
+
+        size_t scannedBlocks = 0, matches = 0;
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t block = 0; block < blockCount; block++)
+        {
+            if (!query.MayMatch(*index.GetBlock(block * blockSize)))
+                continue;
+
+            scannedBlocks++;
+            const size_t end = std::min(messages.size(), (block + 1) * blockSize);
+            for (size_t i = block * blockSize; i < end; i++)
+                matches += query.Matches(messages[i].Tag, messages[i].Text, messages[i].Level);
+        }
+        auto indexedEnd = std::chrono::high_resolution_clock::now();
+
+        size_t scanMatches = 0;
+        for (const Message& message : messages)
+            scanMatches += query.Matches(message.Tag, message.Text, message.Level);
+        auto scanEnd = std::chrono::high_resolution_clock::now();
+
+        if (matches != scanMatches)
+            printf("  FAILED: '%s' found %zu messages with the index, %zu without\n", text, matches, scanMatches);
+
+        printf("  %-26s %6zu matches %5.1f%% of blocks scanned %8.3f ms indexed %8.3f ms full scan\n", text, matches,
+            100.0 * scannedBlocks / blockCount,
+            std::chrono::duration<double, std::milli>(indexedEnd - start).count(),
+            std::chrono::duration<double, std::milli>(scanEnd - indexedEnd).count());
+    }
+}
+
+void RunConsoleSearchBenchmarks()
+{
+    // The Console's default history capacity
+    constexpr size_t messageCount = 100000;
+
+    std::mt19937 random(42);
+    Run("Log lines", GenerateLogLines(messageCount, random));
+    Run("Varied text", GenerateVariedText(messageCount, random));
+}
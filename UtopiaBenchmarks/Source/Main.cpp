@@ -0,0 +1,15 @@
+// Standalone CPU benchmarks. Returns non-zero if a correctness check failed.
+
+#include "Benchmarks.hpp"
+
+#include <cstdio>
+
+int main()
+{
+    if (!RunPixelConversionBenchmarks())
+        return 1;
+
+    printf("\n");
+    RunConsoleSearchBenchmarks();
+    return 0;
+}
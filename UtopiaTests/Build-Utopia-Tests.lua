@@ -0,0 +1,53 @@
+-- Utopia-Tests.lua
+-- Unit and smoke tests. GPU tests render offscreen, so they need a Vulkan driver but no display
+-- (lavapipe works: point VK_ICD_FILENAMES at its lvp_icd json).
+project "UtopiaTests"
+   kind "ConsoleApp"
+   language "C++"
+   cppdialect "C++20"
+   targetdir "bin/%{cfg.buildcfg}"
+   staticruntime "off"
+
+   files { "Source/**.h", "Source/**.hpp", "Source/**.cpp" }
+
+   includedirs
+   {
+      "../vendor/imgui",
+      "../vendor/glfw/include",
+
+      "../Utopia/Source",
+      "../Utopia/Platform/GUI",
+
+      "%{IncludeDir.VulkanSDK}",
+      "%{IncludeDir.glm}",
+   }
+
+    links
+    {
+        "Utopia"
+    }
+
+   targetdir ("../bin/" .. outputdir .. "/%{prj.name}")
+   objdir ("../bin-int/" .. outputdir .. "/%{prj.name}")
+
+   filter "system:windows"
+      systemversion "latest"
+      defines { "UT_PLATFORM_WINDOWS" }
+      buildoptions { "/utf-8" }
+
+   filter "configurations:Debug"
+      defines { "UT_DEBUG" }
+      runtime "Debug"
+      symbols "On"
+
+   filter "configurations:Release"
+      defines { "UT_RELEASE" }
+      runtime "Release"
+      optimize "On"
+      symbols "On"
+
+   filter "configurations:Dist"
+      defines { "UT_DIST" }
+      runtime "Release"
+      optimize "On"
+      symbols "Off"
\ No newline at end of file
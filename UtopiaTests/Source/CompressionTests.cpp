@@ -0,0 +1,131 @@
+#include "Test.hpp"
+
+#include "Utopia/Utils/Compression.hpp"
+
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace Utopia::Tests {
+
+    static bool RoundTrips(const std::vector<uint8_t>& data)
+    {
+        std::vector<uint8_t> compressed;
+        const size_t compressedSize = Utils::CompressLZ(data.data(), data.size(), compressed);
+        if (compressedSize != compressed.size())
+            return false;
+
+        std::vector<uint8_t> decompressed(data.size());
+        if (!Utils::DecompressLZ(compressed.data(), compressed.size(), decompressed.data(), decompressed.size()))
+            return false;
+
+        return decompressed == data;
+    }
+
+    void TestCompressLZRoundTrip()
+    {
+        std::mt19937 random(1234);
+
+        UT_TEST_CHECK(RoundTrips({}));
+        UT_TEST_CHECK(RoundTrips({ 42 }));
+        UT_TEST_CHECK(RoundTrips({ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13 }));
+
+        // Incompressible
+        std::vector<uint8_t> noise(100000);
+        for (uint8_t& byte : noise)
+            byte = (uint8_t)random();
+        UT_TEST_CHECK(RoundTrips(noise));
+
+        // Long runs and overlapping matches
+        UT_TEST_CHECK(RoundTrips(std::vector<uint8_t>(100000, 7)));
+
+        // Image-like data: repeated rows with some variation, the cache's actual workload
+        std::vector<uint8_t> pixels(256 * 256 * 4);
+        for (size_t i = 0; i < pixels.size(); i++)
+            pixels[i] = (uint8_t)((i % 1024) / 16 + (random() % 8 == 0 ? random() % 4 : 0));
+        UT_TEST_CHECK(RoundTrips(pixels));
+
+        // Every size around the block and match length edges
+        for (size_t size = 0; size < 300; size++)
+        {
+            std::vector<uint8_t> data(size);
+            for (size_t i = 0; i < size; i++)
+                data[i] = (uint8_t)(i % 5 == 0 ? random() : i % 13);
+            UT_TEST_CHECK(RoundTrips(data));
+        }
+
+        // Appends to what is already there
+        std::vector<uint8_t> compressed = { 0xAB };
+        const size_t compressedSize = Utils::CompressLZ(pixels.data(), pixels.size(), compressed);
+        UT_TEST_CHECK(compressed.size() == compressedSize + 1 && compressed[0] == 0xAB);
+        UT_TEST_CHECK(compressedSize < pixels.size());
+    }
+
+    void TestDecompressLZCorruptInput()
+    {
+        std::mt19937 random(5678);
+
+        std::vector<uint8_t> data(64 * 1024);
+        for (size_t i = 0; i < data.size(); i++)
+            data[i] = (uint8_t)((i % 300) / 3 + (random() % 16 == 0 ? random() % 8 : 0));
+
+        std::vector<uint8_t> compressed;
+        Utils::CompressLZ(data.data(), data.size(), compressed);
+
+        // Checked with a guard zone, so writes past dstSize show up even without a sanitizer
+        constexpr size_t GuardSize = 64;
+        constexpr uint8_t GuardByte = 0xCD;
+        std::vector<uint8_t> output;
+        auto decompress = [&](const uint8_t* src, size_t srcSize, size_t dstSize)
+        {
+            output.assign(dstSize + GuardSize, GuardByte);
+            const bool result = Utils::DecompressLZ(src, srcSize, output.data(), dstSize);
+            for (size_t i = dstSize; i < output.size(); i++)
+            {
+                if (output[i] != GuardByte)
+                {
+                    UT_TEST_CHECK(!"DecompressLZ wrote past dstSize");
+                    break;
+                }
+            }
+            return result;
+        };
+
+        UT_TEST_CHECK(decompress(compressed.data(), compressed.size(), data.size()));
+
+        // Wrong output size
+        UT_TEST_CHECK(!decompress(compressed.data(), compressed.size(), data.size() - 1));
+        UT_TEST_CHECK(!decompress(compressed.data(), compressed.size(), data.size() + 1));
+        UT_TEST_CHECK(!decompress(compressed.data(), compressed.size(), 0));
+
+        // Truncated, copied into an exactly sized buffer so reads past the end are caught too.
+        // Dropping the empty literal run that ends a stream still leaves all of the data, so
+        // anything that decodes has to decode to the original.
+        for (size_t size = 0; size < compressed.size(); size += 1 + size / 8)
+        {
+            std::vector<uint8_t> truncated(compressed.begin(), compressed.begin() + size);
+            if (decompress(truncated.data(), truncated.size(), data.size()))
+                UT_TEST_CHECK(size + 1 == compressed.size() && std::memcmp(output.data(), data.data(), data.size()) == 0);
+        }
+
+        // Flipped bytes may still decode to something, but must stay in bounds
+        for (int i = 0; i < 2000; i++)
+        {
+            std::vector<uint8_t> corrupt = compressed;
+            const int flips = 1 + random() % 4;
+            for (int flip = 0; flip < flips; flip++)
+                corrupt[random() % corrupt.size()] ^= (uint8_t)(1 + random() % 255);
+            decompress(corrupt.data(), corrupt.size(), data.size());
+        }
+
+        // Garbage
+        for (int i = 0; i < 500; i++)
+        {
+            std::vector<uint8_t> garbage(1 + random() % 512);
+            for (uint8_t& byte : garbage)
+                byte = (uint8_t)random();
+            decompress(garbage.data(), garbage.size(), 1 + random() % 4096);
+        }
+    }
+
+} // namespace Utopia::Tests
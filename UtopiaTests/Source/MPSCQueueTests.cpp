@@ -0,0 +1,96 @@
+#include "Test.hpp"
+
+#include "Utopia/Core/MPSCQueue.hpp"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace Utopia::Tests {
+
+    void TestMPSCQueueOrder()
+    {
+        struct Item
+        {
+            uint32_t Producer;
+            uint32_t Index;
+        };
+
+        constexpr uint32_t producerCount = 4;
+        constexpr uint32_t itemsPerProducer = 50000;
+
+        MPSCQueue<Item> queue;
+        std::atomic<uint32_t> running = producerCount;
+        std::vector<std::thread> producers;
+        for (uint32_t producer = 0; producer < producerCount; producer++)
+        {
+            producers.emplace_back([&queue, &running, producer]()
+            {
+                for (uint32_t i = 0; i < itemsPerProducer; i++)
+                    queue.Push(Item{ producer, i });
+                running--;
+            });
+        }
+
+        // Every producer's items arrive in the order it pushed them, none lost or repeated
+        std::vector<uint32_t> next(producerCount, 0);
+        bool ordered = true;
+        auto consume = [&](Item& item)
+        {
+            ordered &= item.Index == next[item.Producer];
+            next[item.Producer] = item.Index + 1;
+        };
+
+        while (running > 0)
+            queue.Drain(consume);
+        queue.Drain(consume);
+
+        for (std::thread& thread : producers)
+            thread.join();
+
+        UT_TEST_CHECK(ordered);
+        for (uint32_t count : next)
+            UT_TEST_CHECK(count == itemsPerProducer);
+        UT_TEST_CHECK(queue.IsEmpty());
+    }
+
+    void TestMPSCQueueItemLifetime()
+    {
+        // Recycled nodes must not keep values alive, and throwing callbacks must not leak them
+        auto tracker = std::make_shared<int>(0);
+        MPSCQueue<std::shared_ptr<int>> queue;
+
+        for (int round = 0; round < 3; round++)
+        {
+            for (int i = 0; i < 10; i++)
+                queue.Push(tracker);
+            UT_TEST_CHECK(tracker.use_count() == 11);
+
+            UT_TEST_CHECK(queue.Drain([](std::shared_ptr<int>&) {}) == 10);
+            UT_TEST_CHECK(tracker.use_count() == 1);
+        }
+
+        for (int i = 0; i < 5; i++)
+            queue.Push(tracker);
+
+        bool thrown = false;
+        try
+        {
+            queue.Drain([](std::shared_ptr<int>&) { throw std::runtime_error("callback failed"); });
+        }
+        catch (const std::runtime_error&)
+        {
+            thrown = true;
+        }
+        UT_TEST_CHECK(thrown);
+        UT_TEST_CHECK(tracker.use_count() == 1);
+        UT_TEST_CHECK(queue.IsEmpty());
+
+        queue.Push(tracker);
+        queue.Clear();
+        UT_TEST_CHECK(tracker.use_count() == 1);
+    }
+
+} // namespace Utopia::Tests
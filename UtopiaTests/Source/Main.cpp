@@ -0,0 +1,71 @@
+// Utopia tests. Returns non-zero if any test failed.
+//
+// CPU tests run anywhere. GPU tests share one offscreen Application, which needs a Vulkan
+// driver but no display; on machines without a GPU use lavapipe, e.g.
+// VK_ICD_FILENAMES=/usr/share/vulkan/icd.d/lvp_icd.x86_64.json
+
+#include "Test.hpp"
+
+#include "Utopia/Application.hpp"
+
+#include <iterator>
+#include <memory>
+
+bool g_ApplicationRunning = true;
+
+using namespace Utopia;
+using namespace Utopia::Tests;
+
+struct TestCase
+{
+    const char* Name;
+    void (*Function)();
+};
+
+static int RunTests(const TestCase* tests, size_t count)
+{
+    int failedTests = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        s_FailedChecks = 0;
+        tests[i].Function();
+        printf("%-40s %s\n", tests[i].Name, s_FailedChecks ? "FAILED" : "passed");
+        failedTests += s_FailedChecks ? 1 : 0;
+    }
+    return failedTests;
+}
+
+int main()
+{
+    static const TestCase cpuTests[] =
+    {
+        { "CompressLZ round trip", TestCompressLZRoundTrip },
+        { "DecompressLZ corrupt input", TestDecompressLZCorruptInput },
+        { "MPSCQueue order", TestMPSCQueueOrder },
+        { "MPSCQueue item lifetime", TestMPSCQueueItemLifetime },
+    };
+
+    static const TestCase gpuTests[] =
+    {
+        { "UploadContext tickets", TestUploadContextTickets },
+        // Last, it leaves its layer on the stack
+        { "Offscreen frame", TestOffscreenFrame },
+    };
+
+    int failedTests = RunTests(cpuTests, std::size(cpuTests));
+
+    {
+        ApplicationSpecification specification;
+        specification.Name = "UtopiaTests";
+        specification.Width = 64;
+        specification.Height = 64;
+        specification.Offscreen = true;
+        specification.OffscreenFrameCount = 1;
+
+        auto application = std::make_unique<Application>(specification);
+        failedTests += RunTests(gpuTests, std::size(gpuTests));
+    }
+
+    printf("\n%d test(s) failed\n", failedTests);
+    return failedTests ? 1 : 0;
+}
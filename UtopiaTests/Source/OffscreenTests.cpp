@@ -0,0 +1,69 @@
+#include "Test.hpp"
+
+#include "Utopia/Application.hpp"
+#include "Utopia/Image.hpp"
+
+#include "imgui.h"
+
+#include <memory>
+#include <vector>
+
+namespace Utopia::Tests {
+
+    // Fills the left half of the frame with opaque red, on top of everything else ImGui draws.
+    // Red is exact in any 8-bit format, so the check doesn't depend on the driver's rounding.
+    class HalfRedLayer : public Layer
+    {
+    public:
+        void OnUIRender() override
+        {
+            const ImVec2 size = ImGui::GetIO().DisplaySize;
+            ImGui::GetForegroundDrawList()->AddRectFilled(ImVec2(0.0f, 0.0f), ImVec2(size.x * 0.5f, size.y), IM_COL32(255, 0, 0, 255));
+        }
+    };
+
+    static bool IsRed(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t x, uint32_t y)
+    {
+        const uint8_t* pixel = &pixels[((size_t)y * width + x) * 4];
+        return pixel[0] == 255 && pixel[1] == 0 && pixel[2] == 0 && pixel[3] == 255;
+    }
+
+    static void CheckFrame(Application& application, uint32_t width, uint32_t height)
+    {
+        // Renders OffscreenFrameCount frames and returns
+        application.Run();
+
+        const std::shared_ptr<Image> image = application.GetOffscreenImage();
+        UT_TEST_CHECK(image && image->GetWidth() == width && image->GetHeight() == height);
+
+        std::vector<uint8_t> pixels;
+        UT_TEST_CHECK(application.ReadOffscreenPixels(pixels));
+        UT_TEST_CHECK(pixels.size() == (size_t)width * height * 4);
+        if (pixels.size() != (size_t)width * height * 4)
+            return;
+
+        UT_TEST_CHECK(IsRed(pixels, width, 0, 0));
+        UT_TEST_CHECK(IsRed(pixels, width, width / 4, height - 1));
+        UT_TEST_CHECK(!IsRed(pixels, width, width - 1, 0));
+        UT_TEST_CHECK(!IsRed(pixels, width, width * 3 / 4, height - 1));
+    }
+
+    void TestOffscreenFrame()
+    {
+        Application& application = Application::Get();
+        UT_TEST_CHECK(application.IsOffscreen());
+
+        auto layer = std::make_shared<HalfRedLayer>();
+        application.PushLayer(layer);
+
+        // The size Main.cpp creates the application with
+        CheckFrame(application, 64, 64);
+
+        // A different aspect ratio, so swapped rows and columns would show
+        application.SetOffscreenSize(48, 32);
+        std::vector<uint8_t> pixels;
+        UT_TEST_CHECK(!application.ReadOffscreenPixels(pixels));
+        CheckFrame(application, 48, 32);
+    }
+
+} // namespace Utopia::Tests
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdio>
+
+namespace Utopia::Tests {
+
+    // Failed checks of the test that is currently running
+    inline int s_FailedChecks = 0;
+
+    // CPU tests
+    void TestCompressLZRoundTrip();
+    void TestDecompressLZCorruptInput();
+    void TestMPSCQueueOrder();
+    void TestMPSCQueueItemLifetime();
+
+    // GPU tests, run with an offscreen Application
+    void TestUploadContextTickets();
+    void TestOffscreenFrame();
+
+} // namespace Utopia::Tests
+
+// A failed check is reported and the test keeps going
+#define UT_TEST_CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            printf("  FAILED: %s (%s:%d)\n", #condition, __FILE__, __LINE__); \
+            ::Utopia::Tests::s_FailedChecks++; \
+        } \
+    } while (false)
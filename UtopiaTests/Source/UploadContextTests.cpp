@@ -0,0 +1,54 @@
+#include "Test.hpp"
+
+#include "Utopia/Application.hpp"
+
+namespace Utopia::Tests {
+
+    void TestUploadContextTickets()
+    {
+        UploadContext& uploads = Application::GetUploadContext();
+
+        // Start from an idle context, without a batch left open by the application
+        uploads.Wait(uploads.SubmitBatch());
+
+        const uint64_t previous = uploads.GetLastSubmittedTicket();
+        UT_TEST_CHECK(uploads.IsComplete(previous));
+
+        // Tickets follow submission order, not allocation order
+        VkCommandBuffer first = uploads.Allocate();
+        VkCommandBuffer second = uploads.Allocate();
+        const uint64_t secondTicket = uploads.Submit(second);
+        const uint64_t firstTicket = uploads.Submit(first);
+        UT_TEST_CHECK(secondTicket == previous + 1);
+        UT_TEST_CHECK(firstTicket == secondTicket + 1);
+        UT_TEST_CHECK(uploads.GetLastSubmittedTicket() == firstTicket);
+
+        // The open batch's ticket is handed out up front but can't complete before it is submitted
+        uploads.BeginBatch();
+        const uint64_t batchTicket = uploads.GetBatchTicket();
+        UT_TEST_CHECK(batchTicket == firstTicket + 1);
+        UT_TEST_CHECK(!uploads.IsComplete(batchTicket));
+
+        uploads.Wait(secondTicket);
+        uploads.Wait(firstTicket);
+        UT_TEST_CHECK(uploads.IsComplete(secondTicket));
+        UT_TEST_CHECK(uploads.IsComplete(firstTicket));
+        UT_TEST_CHECK(!uploads.IsComplete(batchTicket));
+
+        // Any other submission flushes the open batch first, keeping its ticket
+        VkCommandBuffer third = uploads.Allocate();
+        const uint64_t thirdTicket = uploads.Submit(third);
+        UT_TEST_CHECK(!uploads.HasOpenBatch());
+        UT_TEST_CHECK(thirdTicket == batchTicket + 1);
+
+        // Waiting on the last ticket completes everything before it
+        uploads.Wait(thirdTicket);
+        uploads.Wait(batchTicket);
+        UT_TEST_CHECK(uploads.IsComplete(batchTicket));
+        UT_TEST_CHECK(uploads.IsComplete(thirdTicket));
+
+        // Not handed out yet
+        UT_TEST_CHECK(!uploads.IsComplete(thirdTicket + 1));
+    }
+
+} // namespace Utopia::Tests